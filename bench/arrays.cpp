@@ -0,0 +1,51 @@
+// Parses a flat array of N integers and a run of N / 10 [[array.tables]] headers.
+// Appending to either should stay constant time, so the times should grow linearly with N.
+// usage: bench_arrays [largest N], to skip sizes that take too long on older builds
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "another_toml/another_toml.hpp"
+
+#include "bench.hpp"
+
+namespace toml = another_toml;
+
+int main(int argc, char** argv)
+{
+	const auto max_elements = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+	auto sum = std::int64_t{};
+	std::printf("%10s %14s %14s\n", "N", "flat array", "array tables");
+
+	for (const auto element_count : { 20'000, 100'000, 1'000'000 })
+	{
+		if (element_count > max_elements)
+			break;
+
+		auto flat_array = std::string{ "a = [" };
+		for (auto i = 0; i < element_count; ++i)
+			flat_array += std::to_string(i) + ",";
+		flat_array += "]\n";
+
+		auto array_tables = std::string{};
+		for (auto i = 0; i < element_count / 10; ++i)
+			array_tables += "[[array.tables]]\nid = " + std::to_string(i) + "\n";
+
+		const auto array_time = toml::bench::time_ms([&] {
+			const auto root = toml::parse(flat_array);
+			sum += root.find_child("a").get_first_child().as_integer();
+		});
+
+		const auto tables_time = toml::bench::time_ms([&] {
+			const auto root = toml::parse(array_tables);
+			sum += root.find_child("array").find_child("tables").get_first_child().find_child("id").as_integer();
+		});
+
+		std::printf("%10d %12.1fms %12.1fms\n", element_count, array_time, tables_time);
+	}
+
+	toml::bench::print_checksum(sum);
+	return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef ANOTHER_TOML_BENCH_HPP
+#define ANOTHER_TOML_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+// Helpers shared by the benchmarks in this directory.
+// Build them with ANOTHER_TOML_BENCHMARKS=ON in a release configuration.
+
+namespace another_toml::bench
+{
+	// Returns the fastest of repeat runs of f, in milliseconds
+	template<typename Func>
+	double time_ms(Func&& f, const int repeat = 3)
+	{
+		auto best = std::numeric_limits<double>::max();
+		for (auto i = 0; i < repeat; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			f();
+			const auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>{ end - start }.count());
+		}
+		return best;
+	}
+
+	// Prints the checksum of a benchmark's results,
+	// so the compiler can't remove the work that produced them
+	template<typename T>
+	void print_checksum(const T sum)
+	{
+		std::printf("(checksum %lld)\n", static_cast<long long>(sum));
+		return;
+	}
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef ANOTHER_TOML_BENCH_COUNT_ALLOCATIONS_HPP
+#define ANOTHER_TOML_BENCH_COUNT_ALLOCATIONS_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new to count allocations.
+// Defines the replacement functions, so include it from one source file per benchmark.
+
+namespace another_toml::bench
+{
+	inline std::size_t allocation_count = {};
+}
+
+void* operator new(std::size_t n)
+{
+	++another_toml::bench::allocation_count;
+	if (auto ptr = std::malloc(n))
+		return ptr;
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t n)
+{
+	return operator new(n);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+#endif
@@ -0,0 +1,45 @@
+// Parses N lines of deep dotted keys, eg. svc1.region.zone.host1.port = 1.
+// Each key resolves its dotted tables' parents, so this times parent lookups as N grows.
+// usage: bench_dotted_keys [largest N], to skip sizes that take too long on older builds
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "another_toml/another_toml.hpp"
+
+#include "bench.hpp"
+
+namespace toml = another_toml;
+
+int main(int argc, char** argv)
+{
+	const auto max_keys = argc > 1 ? std::atoi(argv[1]) : 100'000;
+	auto sum = std::int64_t{};
+	std::printf("%8s %12s\n", "keys", "parse");
+
+	for (const auto key_count : { 2'000, 10'000, 100'000 })
+	{
+		if (key_count > max_keys)
+			break;
+
+		auto doc = std::string{};
+		for (auto i = 0; i < key_count; ++i)
+		{
+			doc += "svc" + std::to_string(i % 100) + ".region.zone.host" + std::to_string(i) +
+				".port = " + std::to_string(i) + "\n";
+		}
+
+		const auto parse_time = toml::bench::time_ms([&] {
+			const auto root = toml::parse(doc);
+			sum += root.find_child("svc1").find_child("region").find_child("zone")
+				.find_child("host1").find_child("port").as_integer();
+		});
+
+		std::printf("%8d %10.1fms\n", key_count, parse_time);
+	}
+
+	toml::bench::print_checksum(sum);
+	return 0;
+}
@@ -0,0 +1,51 @@
+// Parses a flat table of N integer keys, then looks up every key with find_child.
+// Times both as N grows, which shows whether building and searching large tables stays linear.
+// usage: bench_large_table [largest N], to skip sizes that take too long on quadratic builds
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "another_toml/another_toml.hpp"
+
+#include "bench.hpp"
+
+namespace toml = another_toml;
+
+int main(int argc, char** argv)
+{
+	const auto max_keys = argc > 1 ? std::atoi(argv[1]) : 200'000;
+	auto sum = std::int64_t{};
+	std::printf("%8s %12s %12s\n", "keys", "parse", "lookup");
+
+	for (const auto key_count : { 1'000, 5'000, 50'000, 200'000 })
+	{
+		if (key_count > max_keys)
+			break;
+
+		auto keys = std::vector<std::string>{};
+		auto doc = std::string{};
+		for (auto i = 0; i < key_count; ++i)
+		{
+			keys.emplace_back("key" + std::to_string(i));
+			doc += keys.back() + " = " + std::to_string(i) + "\n";
+		}
+
+		auto root = toml::root_node{};
+		const auto parse_time = toml::bench::time_ms([&] {
+			root = toml::parse(doc);
+		});
+
+		const auto lookup_time = toml::bench::time_ms([&] {
+			for (const auto& key : keys)
+				sum += root.find_child(key).as_integer();
+		});
+
+		std::printf("%8d %10.1fms %10.1fms\n", key_count, parse_time, lookup_time);
+	}
+
+	toml::bench::print_checksum(sum);
+	return 0;
+}
@@ -0,0 +1,161 @@
+// Compares the hand written integer, float and date-time scanners in string_util
+// against the std::regex path they replaced.
+// That path built a new regex for every value, it's also timed with each regex built once.
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <string_view>
+
+#include "another_toml/string_util.hpp"
+
+#include "bench.hpp"
+
+namespace toml = another_toml;
+using namespace std::string_view_literals;
+
+namespace regex_lexer
+{
+	// The previous implementation, kept here for comparison
+	constexpr auto int_reg =
+		R"(^[\+\-]?[1-9]+(_?([\d])+)*$|^0x[\dA-Fa-f]+(_?[\dA-Fa-f]+)*|0b[01]+(_?[01]+)*|0o[0-7]+(_?([0-7])+)*|^[\+\-]?0$)";
+	constexpr auto float_reg =
+		R"(^[\+\-]?([1-9]+(_?([\d])+)*|0)(\.[\d]+(_?[\d])*)?([eE][\+\-]?[\d]+(_?[\d]+)?)?$)";
+	constexpr auto date_time_reg =
+		R"(^((\d{4})-(\d{2})-(\d{2}))?([Tt ])?((\d{2}):(\d{2}):(\d{2})(\.\d+)?)?(([zZ])|(([\+\-])(\d{2}):(\d{2})))?)";
+
+	static std::string remove_underscores(std::string_view str)
+	{
+		auto out = std::string{};
+		for (const auto ch : str)
+		{
+			if (ch != '_')
+				out.push_back(ch);
+		}
+		return out;
+	}
+
+	static std::int64_t parse_integer(std::string_view str, const std::regex& reg)
+	{
+		if (!std::regex_match(begin(str), end(str), reg))
+			return {};
+
+		auto string = remove_underscores(str);
+		if (!string.empty() && string.front() == '+')
+			string.erase(0, 1);
+
+		auto base = 10;
+		if (size(string) > 1)
+		{
+			const auto prefix = std::string_view{ string }.substr(0, 2);
+			if (prefix == "0x"sv)
+				base = 16;
+			else if (prefix == "0b"sv)
+				base = 2;
+			else if (prefix == "0o"sv)
+				base = 8;
+
+			if (base != 10)
+				string.erase(0, 2);
+		}
+
+		auto value = std::int64_t{};
+		std::from_chars(data(string), data(string) + size(string), value, base);
+		return value;
+	}
+
+	static double parse_float(std::string_view str, const std::regex& reg)
+	{
+		if (!std::regex_match(begin(str), end(str), reg))
+			return {};
+
+		const auto string = remove_underscores(str);
+		auto value = double{};
+		std::from_chars(data(string), data(string) + size(string), value);
+		return value;
+	}
+
+	static bool parse_date_time(std::string_view str, const std::regex& reg)
+	{
+		auto matches = std::match_results<std::string_view::iterator>{};
+		return std::regex_match(begin(str), end(str), matches, reg);
+	}
+}
+
+int main()
+{
+	constexpr auto integers = std::array{ "0"sv, "+17"sv, "-42"sv, "1_000_000"sv, "0xDEAD_beef"sv,
+		"0o755"sv, "0b1101"sv, "9223372036854775807"sv };
+	constexpr auto floats = std::array{ "3.14"sv, "-0.01"sv, "6.626e-34"sv, "1e1_0"sv,
+		"224_617.445_991"sv, "+1.5e3"sv, "0.0"sv, "5e+22"sv };
+	constexpr auto date_times = std::array{ "1979-05-27T07:32:00Z"sv, "1979-05-27 07:32:00.999-07:00"sv,
+		"1979-05-27T00:32:00.999999"sv, "1979-05-27"sv, "07:32:00"sv, "00:32:00.5"sv,
+		"1979-05-27t07:32:00+01:30"sv, "2000-01-01T00:00:00z"sv };
+
+	// building the regexes dominates, so this is kept small
+	constexpr auto count = 20'000;
+	auto sum = std::int64_t{};
+
+	const auto int_reg = std::regex{ regex_lexer::int_reg };
+	const auto float_reg = std::regex{ regex_lexer::float_reg };
+	const auto date_time_reg = std::regex{ regex_lexer::date_time_reg };
+
+	const auto integer_times = std::array{
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += regex_lexer::parse_integer(integers[i % size(integers)], std::regex{ regex_lexer::int_reg });
+		}),
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += regex_lexer::parse_integer(integers[i % size(integers)], int_reg);
+		}),
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += toml::parse_integer_string(integers[i % size(integers)]).value;
+		})
+	};
+
+	const auto float_times = std::array{
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += static_cast<std::int64_t>(regex_lexer::parse_float(floats[i % size(floats)], std::regex{ regex_lexer::float_reg }));
+		}),
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += static_cast<std::int64_t>(regex_lexer::parse_float(floats[i % size(floats)], float_reg));
+		}),
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += static_cast<std::int64_t>(toml::parse_float_string(floats[i % size(floats)]).value);
+		})
+	};
+
+	const auto date_time_times = std::array{
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += regex_lexer::parse_date_time(date_times[i % size(date_times)], std::regex{ regex_lexer::date_time_reg });
+		}),
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += regex_lexer::parse_date_time(date_times[i % size(date_times)], date_time_reg);
+		}),
+		toml::bench::time_ms([&] {
+			for (auto i = 0; i < count; ++i)
+				sum += static_cast<std::int64_t>(toml::parse_date_time(date_times[i % size(date_times)]).index());
+		})
+	};
+
+	std::printf("%d values of each kind, fastest of 3 runs\n", count);
+	std::printf("%-10s %16s %16s %12s\n", "", "regex per value", "regex reused", "scanner");
+	const auto print_row = [](const char* name, const std::array<double, 3>& times) {
+		std::printf("%-10s %14.1fms %14.1fms %10.1fms\n", name, times[0], times[1], times[2]);
+	};
+	print_row("integer", integer_times);
+	print_row("float", float_times);
+	print_row("date-time", date_time_times);
+	toml::bench::print_checksum(sum);
+	return 0;
+}
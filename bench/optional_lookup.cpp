@@ -0,0 +1,68 @@
+// Looks up keys that are missing from a 68 key table, the common case for optional config keys.
+// Compares get_value with a default, the no_throw overload and catching node_not_found,
+// counting the allocations each makes.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "another_toml/another_toml.hpp"
+#include "another_toml/except.hpp"
+
+#include "bench.hpp"
+#include "count_allocations.hpp"
+
+namespace toml = another_toml;
+
+int main()
+{
+	auto doc = std::string{ "[t]\n" };
+	for (auto i = 0; i < 64; ++i)
+		doc += "k" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+	doc += "f = 1.5\ns = \"str\"\narr = [1, 2, 3]\nmixed = [1, \"a\"]\n";
+
+	const auto root = toml::parse(doc);
+	const auto table = root["t"];
+
+	auto missing_keys = std::vector<std::string>{};
+	for (auto i = 0; i < 16; ++i)
+		missing_keys.emplace_back("missing" + std::to_string(i));
+
+	constexpr auto lookup_count = 1'000'000;
+	auto sum = std::int64_t{};
+
+	std::printf("%d lookups, fastest of 3 runs\n", lookup_count);
+	const auto run = [&](const char* name, auto&& lookup) {
+		const auto allocations = toml::bench::allocation_count;
+		const auto time = toml::bench::time_ms([&] {
+			for (auto i = 0; i < lookup_count; ++i)
+				sum += lookup(missing_keys[i % size(missing_keys)]);
+		});
+		// time_ms runs the loop 3 times
+		const auto allocs = (toml::bench::allocation_count - allocations) / 3;
+		std::printf("%-28s %10.1fms %10zu allocations\n", name, time, allocs);
+	};
+
+	run("get_value(key, default)", [&](const std::string& key) {
+		return table.get_value<std::int64_t>(key, std::int64_t{ 1 });
+	});
+
+	run("get_value(key, no_throw)", [&](const std::string& key) {
+		return table.get_value<std::int64_t>(key, toml::no_throw).value_or(1);
+	});
+
+	run("get_value(key) + catch", [&](const std::string& key) {
+		try
+		{
+			return table.get_value<std::int64_t>(key);
+		}
+		catch (const toml::node_not_found&)
+		{
+			return std::int64_t{ 1 };
+		}
+	});
+
+	toml::bench::print_checksum(sum);
+	return 0;
+}
@@ -0,0 +1,68 @@
+// Parses a ~27MB document of [[records]] array tables, and one of [section.N] tables,
+// with parser_options::threads set to 1, 2, 4 and 8.
+// No speedup has been shown yet: it has only been run on one core, where the extra threads only add work.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "another_toml/another_toml.hpp"
+
+#include "bench.hpp"
+
+namespace toml = another_toml;
+
+// Prints the time to parse doc at each thread count, and the speedup over one thread.
+// read takes something from the parsed document for the checksum.
+template<typename Read>
+static std::int64_t compare_threads(const std::string& doc, Read&& read)
+{
+	std::printf("%.1fMB document, %u hardware threads\n", static_cast<double>(size(doc)) / 1e6,
+		std::thread::hardware_concurrency());
+	std::printf("%8s %12s %8s\n", "threads", "parse", "speedup");
+
+	auto sum = std::int64_t{};
+	auto single_thread_time = double{};
+	for (const auto threads : { std::size_t{ 1 }, std::size_t{ 2 }, std::size_t{ 4 }, std::size_t{ 8 } })
+	{
+		auto opts = toml::parser_options{};
+		opts.threads = threads;
+
+		const auto parse_time = toml::bench::time_ms([&] {
+			const auto root = toml::parse(doc, opts);
+			sum += read(root);
+		});
+
+		if (threads == 1)
+			single_thread_time = parse_time;
+		std::printf("%8zu %10.1fms %7.2fx\n", threads, parse_time, single_thread_time / parse_time);
+	}
+
+	return sum;
+}
+
+int main()
+{
+	auto records = std::string{};
+	auto sections = std::string{};
+	for (auto i = 0; i < 200'000; ++i)
+	{
+		const auto id = std::to_string(i);
+		const auto body = "id = " + id + "\nname = \"record " + id + "\"\nscore = 1.25\n"
+			"tags = [\"a\", \"b\", \"c\"]\nwhen = 1979-05-27T07:32:00Z\nmeta = { x = 1, y = 2 }\n";
+		records += "[[records]]\n" + body;
+		sections += "[section." + id + "]\n" + body;
+	}
+
+	auto sum = compare_threads(records, [](const toml::root_node& root) {
+		return root.find_child("records").get_first_child().find_child("id").as_integer();
+	});
+	sum += compare_threads(sections, [](const toml::root_node& root) {
+		return root.find_child("section").get_first_child().find_child("id").as_integer();
+	});
+
+	toml::bench::print_checksum(sum);
+	return 0;
+}
@@ -0,0 +1,73 @@
+// Parses 100k documents of about 1KB each, first with parse() and then with one parser
+// that recycles each document's storage, counting the allocations made per document.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "another_toml/another_toml.hpp"
+
+#include "bench.hpp"
+#include "count_allocations.hpp"
+
+namespace toml = another_toml;
+
+int main()
+{
+	auto docs = std::vector<std::string>{};
+	for (auto d = 0; d < 64; ++d)
+	{
+		const auto n = std::to_string(d);
+		auto doc = "title = \"doc " + n + "\"\nid = " + n + "\n"
+			"[owner]\nname = \"Tom Preston-Werner\"\ndob = 1979-05-27T07:32:00-08:00\n"
+			"[database]\nenabled = true\nports = [ 8000, 8001, 8002 ]\ndata = [ [\"delta\", \"phi\"], [3.14] ]\n"
+			"temp_targets = { cpu = 79.5, case = 72.0 }\n"
+			"[servers.alpha]\nip = \"10.0.0.1\"\nrole = \"frontend\"\n"
+			"[servers.beta]\nip = \"10.0.0.2\"\nrole = \"backend\"\n";
+		for (auto k = 0; size(doc) < 1000; ++k)
+			doc += "[[products]]\nname = \"Hammer\"\nsku = " + std::to_string(738594937 + k) + "\ncolor = \"gray\"\n";
+		docs.emplace_back(std::move(doc));
+	}
+
+	constexpr auto doc_count = 100'000;
+	auto sum = std::int64_t{};
+	std::printf("%d documents of %zu bytes, fastest of 3 runs\n", doc_count, size(docs.front()));
+
+	for (const auto borrow : { false, true })
+	{
+		auto opts = toml::parser_options{};
+		opts.borrow_input = borrow;
+
+		auto allocations = toml::bench::allocation_count;
+		const auto parse_time = toml::bench::time_ms([&] {
+			for (auto i = 0; i < doc_count; ++i)
+				sum += toml::parse(docs[i % size(docs)], opts).size();
+		});
+		const auto parse_allocs = static_cast<double>(toml::bench::allocation_count - allocations) / (3 * doc_count);
+
+		auto p = toml::parser{ opts };
+		// warm up, so the buffers have grown to fit the largest document
+		for (const auto& doc : docs)
+			p.recycle(p.parse(doc));
+
+		allocations = toml::bench::allocation_count;
+		const auto reuse_time = toml::bench::time_ms([&] {
+			for (auto i = 0; i < doc_count; ++i)
+			{
+				auto root = p.parse(docs[i % size(docs)]);
+				sum += root.size();
+				p.recycle(std::move(root));
+			}
+		});
+		const auto reuse_allocs = static_cast<double>(toml::bench::allocation_count - allocations) / (3 * doc_count);
+
+		std::printf("borrow_input=%d\n", borrow);
+		std::printf("  %-20s %10.1fms %6.1f allocations per document\n", "parse()", parse_time, parse_allocs);
+		std::printf("  %-20s %10.1fms %6.1f allocations per document\n", "parser + recycle()", reuse_time, reuse_allocs);
+	}
+
+	toml::bench::print_checksum(sum);
+	return 0;
+}
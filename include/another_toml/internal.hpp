@@ -24,7 +24,9 @@
 #define ANOTHER_TOML_INTERNAL_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <numeric>
+#include <optional>
 #include <type_traits>
 
 #include "another_toml/types.hpp"
@@ -74,8 +76,35 @@ namespace another_toml
 			void operator()(toml_internal_data*) noexcept;
 		};
 
+		// State kept between calls to incremental_parser::feed
+		struct incremental_state;
+		// Deleter for above type
+		struct incremental_state_deleter
+		{
+		public:
+			void operator()(incremental_state*) noexcept;
+		};
+
+		// Buffers kept between documents by parser
+		struct parser_cache;
+		// Deleter for above type
+		struct parser_cache_deleter
+		{
+		public:
+			void operator()(parser_cache*) noexcept;
+		};
+
 		// Returns the sibling node of index_t, or bad_index.
 		index_t get_next(const toml_internal_data&, index_t) noexcept;
+		// Returns the number of children of index_t.
+		std::size_t get_child_count(const toml_internal_data&, index_t) noexcept;
+		// Returns the nth child of index_t, or bad_index.
+		index_t get_child_at(const toml_internal_data&, index_t, std::size_t) noexcept;
+		// Returns the elements of an array of integers, floats or booleans,
+		// or an empty optional if index_t isn't one.
+		std::optional<span<const std::int64_t>> get_packed_integers(const toml_internal_data&, index_t) noexcept;
+		std::optional<span<const double>> get_packed_floats(const toml_internal_data&, index_t) noexcept;
+		std::optional<span<const bool>> get_packed_booleans(const toml_internal_data&, index_t) noexcept;
 
 		template<typename T>
 		constexpr auto is_toml_type = std::is_same_v<T, std::int64_t> ||
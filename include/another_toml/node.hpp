@@ -24,7 +24,11 @@
 #define ANOTHER_TOML_NODE_HPP
 
 #include <cassert>
+#include <cstddef>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -35,6 +39,42 @@ namespace another_toml
 {
 	// FWD def
 	class node_iterator;
+	class child_range;
+	class parser;
+	template<bool RootNode>
+	class basic_node;
+
+	// A dotted key path such as "servers.alpha.ip" or "products[2].sku".
+	// Keys can be bare, "basic" or 'literal' as in a TOML dotted key,
+	// [n] selects the nth element of an array or array table.
+	// The keys are normalised and hashed on construction, so build a path once
+	// and reuse it with basic_node::find_child to resolve it against many documents.
+	// Throws: parsing_error if path is malformed
+	class node_path
+	{
+	public:
+		explicit node_path(std::string_view path);
+
+		std::size_t size() const noexcept
+		{
+			return _segments.size();
+		}
+
+	private:
+		template<bool RootNode>
+		friend class basic_node;
+
+		struct segment
+		{
+			// NFC normalised key name and its hash
+			std::string name;
+			std::size_t hash = {};
+			// array element, or bad_index if this is a key
+			detail::index_t element = detail::bad_index;
+		};
+
+		std::vector<segment> _segments;
+	};
 
 	// TOML node for accessing parsed data
 	// If RootNode = true then the type holds ownership of the 
@@ -83,6 +123,19 @@ namespace another_toml
 		// If this node has no chilren, then the returned node will be bad
 		basic_node<> get_first_child() const;
 
+		// The number of children this node has, 0 for a bad node
+		std::size_t size() const noexcept;
+		// Get the nth child of this node.
+		// Arrays, arrays of tables and tables are indexed in constant time,
+		// except for containers with fewer than 16 non-contiguous children,
+		// which walk through them.
+		// Throws: bad_node if good() == false for this node
+		// Throws: node_not_found if n >= size()
+		basic_node<> get_child(std::size_t n) const;
+		// Random access range over this node's children
+		// Doesn't allocate, unlike get_children
+		child_range children() const noexcept;
+
 		// Get siblings. If this node isn't the only child of its parent
 		// then you can iterate through the siblings by calling get_next_sibling.
 		bool has_sibling() const noexcept;
@@ -91,6 +144,12 @@ namespace another_toml
 		// Throws: node_not_found if has_sibling() == false
 		basic_node<> get_next_sibling() const;
 
+		// Get the node that contains this node.
+		// eg. the parent of a value is its key, or the array it is in
+		// Throws: bad_node if good() == false for this node
+		// If this is the root table, then the returned node will be bad
+		basic_node<> get_parent() const;
+
 		// get child with the provided name
 		// test the return value using .good()
 		// NOTE: Only searches immediate children.
@@ -101,6 +160,13 @@ namespace another_toml
 		// As above, but returns a bad node on error instead of throwing
 		basic_node<> find_child(std::string_view, no_throw_t) const noexcept;
 
+		// Get the node at the end of a node_path, searching from this node.
+		// Key segments resolve to the key's value, like find_child above.
+		// Throws : bad_node and node_not_found
+		basic_node<> find_child(const node_path&) const;
+		// As above, but returns a bad node on error instead of throwing
+		basic_node<> find_child(const node_path&, no_throw_t) const noexcept;
+
 		// Searches for a child node called key_name,
 		// if that node is a Key, then returns it's child
 		// converted to `T`.
@@ -113,6 +179,10 @@ namespace another_toml
 		// Provide a default value to be returned if the key isn't found
 		template<typename T>
 		T get_value(std::string_view key_name, T default_return) const;
+		// As above, but returns an empty optional instead of throwing if this
+		// isn't a table, the key isn't found or its value isn't a `T`
+		template<typename T>
+		std::optional<T> get_value(std::string_view key_name, no_throw_t) const;
 
 		// Iterator based interface for accessing child nodes
 		node_iterator begin() const noexcept;
@@ -124,6 +194,13 @@ namespace another_toml
 		std::string as_string() const;
 		std::string as_string(int_base) const;
 		std::string as_string(float_rep, std::int8_t = auto_precision) const;
+		// Access the name of a table, key, array or array_table, or the value of
+		// a string node without copying it.
+		// The view is valid for as long as the root_node (and the input buffer when
+		// it was parsed with parser_options::borrow_input).
+		std::string_view as_string_view() const;
+		// As above, but returns an empty optional instead of throwing
+		std::optional<std::string_view> as_string_view(no_throw_t) const noexcept;
 
 		// The following functions should only be called on nodes
 		// matching the value_type of the node
@@ -137,12 +214,40 @@ namespace another_toml
 		date as_date_local() const;
 		time as_time_local() const;
 
+		// As above, but return an empty optional instead of throwing
+		// if this node is bad or doesn't hold a value of the requested type
+		std::optional<std::int64_t> as_integer(no_throw_t) const noexcept;
+		std::optional<double> as_floating(no_throw_t) const noexcept;
+		std::optional<bool> as_boolean(no_throw_t) const noexcept;
+		std::optional<date_time> as_date_time(no_throw_t) const noexcept;
+		std::optional<local_date_time> as_date_time_local(no_throw_t) const noexcept;
+		std::optional<date> as_date_local(no_throw_t) const noexcept;
+		std::optional<time> as_time_local(no_throw_t) const noexcept;
+
 		// Extracts this node as the requested type.
 		// `T` can be a container if this node is a homogeneous array
 		// `T` or `T::value_type` must be one of the types returned by 
 		// the extraction functions above (as_XXXXX()).
 		template<typename T>
 		T as_type() const;
+		// As above, but returns an empty optional instead of throwing.
+		// std::string only matches string values and named nodes, other
+		// values aren't converted to their string representation.
+		template<typename T>
+		std::optional<T> as_type(no_throw_t) const;
+
+		// View the elements of an array of integers, floats or booleans as a contiguous block.
+		// `T` must be std::int64_t, double or bool.
+		// The first call for an array copies its elements into a buffer owned by the document,
+		// later calls return the same buffer. The span is valid for as long as the root_node.
+		// Throws: bad_node, wrong_node_type if this isn't an array,
+		//		wrong_type if any of the elements aren't a `T` and
+		//		std::bad_alloc if the buffer can't be allocated
+		template<typename T>
+		span<const T> as_span() const;
+		// As above, but returns an empty optional instead of throwing
+		template<typename T>
+		std::optional<span<const T>> as_span(no_throw_t) const noexcept;
 
 		// Shorthand for find_child
 		basic_node<> operator[](std::string_view str) const
@@ -156,6 +261,14 @@ namespace another_toml
 			return find_child(str);
 		}
 
+		// Shorthand for get_child
+		template<typename Integral,
+			std::enable_if_t<detail::is_integral_v<Integral>, int> = 0>
+		basic_node<> operator[](Integral n) const
+		{
+			return get_child(static_cast<std::size_t>(n));
+		}
+
 		// Allow implicit testing of the node
 		operator bool() const noexcept
 		{
@@ -163,6 +276,9 @@ namespace another_toml
 		}
 
 	private:
+		// parser::recycle takes the storage of root nodes
+		friend class parser;
+
 		data_type _data;
 		detail::index_t _index;
 	};
@@ -234,6 +350,169 @@ namespace another_toml
 		const detail::toml_internal_data* _data;
 		detail::index_t _index;
 	};
+
+	// Random access range over the children of a node.
+	// Returned by basic_node::children.
+	class child_range
+	{
+	public:
+		class iterator
+		{
+		public:
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = node;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = node;
+
+			iterator(const detail::toml_internal_data* sh = {},
+				detail::index_t parent = detail::bad_index, std::size_t n = {}) noexcept
+				: _data{ sh }, _parent{ parent }, _n{ n }
+			{}
+
+			node operator*() const noexcept
+			{
+				assert(_data);
+				return node{ _data, detail::get_child_at(*_data, _parent, _n) };
+			}
+
+			node operator[](difference_type i) const noexcept
+			{
+				return *(*this + i);
+			}
+
+			iterator& operator++() noexcept
+			{
+				++_n;
+				return *this;
+			}
+
+			iterator operator++(int) noexcept
+			{
+				auto out = *this;
+				++_n;
+				return out;
+			}
+
+			iterator& operator--() noexcept
+			{
+				--_n;
+				return *this;
+			}
+
+			iterator operator--(int) noexcept
+			{
+				auto out = *this;
+				--_n;
+				return out;
+			}
+
+			iterator& operator+=(difference_type i) noexcept
+			{
+				_n += i;
+				return *this;
+			}
+
+			iterator& operator-=(difference_type i) noexcept
+			{
+				_n -= i;
+				return *this;
+			}
+
+			friend iterator operator+(iterator it, difference_type i) noexcept
+			{
+				return it += i;
+			}
+
+			friend iterator operator+(difference_type i, iterator it) noexcept
+			{
+				return it += i;
+			}
+
+			friend iterator operator-(iterator it, difference_type i) noexcept
+			{
+				return it -= i;
+			}
+
+			friend difference_type operator-(const iterator& lhs, const iterator& rhs) noexcept
+			{
+				return static_cast<difference_type>(lhs._n) - static_cast<difference_type>(rhs._n);
+			}
+
+			friend bool operator==(const iterator& lhs, const iterator& rhs) noexcept
+			{
+				return lhs._n == rhs._n;
+			}
+
+			friend bool operator!=(const iterator& lhs, const iterator& rhs) noexcept
+			{
+				return lhs._n != rhs._n;
+			}
+
+			friend bool operator<(const iterator& lhs, const iterator& rhs) noexcept
+			{
+				return lhs._n < rhs._n;
+			}
+
+			friend bool operator>(const iterator& lhs, const iterator& rhs) noexcept
+			{
+				return lhs._n > rhs._n;
+			}
+
+			friend bool operator<=(const iterator& lhs, const iterator& rhs) noexcept
+			{
+				return lhs._n <= rhs._n;
+			}
+
+			friend bool operator>=(const iterator& lhs, const iterator& rhs) noexcept
+			{
+				return lhs._n >= rhs._n;
+			}
+
+		private:
+			const detail::toml_internal_data* _data;
+			detail::index_t _parent;
+			std::size_t _n;
+		};
+
+		child_range(const detail::toml_internal_data* sh = {},
+			detail::index_t parent = detail::bad_index) noexcept
+			: _data{ sh }, _parent{ parent },
+			_size{ sh ? detail::get_child_count(*sh, parent) : std::size_t{} }
+		{}
+
+		std::size_t size() const noexcept
+		{
+			return _size;
+		}
+
+		bool empty() const noexcept
+		{
+			return _size == 0;
+		}
+
+		// n must be less than size()
+		node operator[](std::size_t n) const noexcept
+		{
+			assert(n < _size);
+			return begin()[static_cast<iterator::difference_type>(n)];
+		}
+
+		iterator begin() const noexcept
+		{
+			return iterator{ _data, _parent };
+		}
+
+		iterator end() const noexcept
+		{
+			return iterator{ _data, _parent, _size };
+		}
+
+	private:
+		const detail::toml_internal_data* _data;
+		detail::index_t _parent;
+		std::size_t _size;
+	};
 }
 
 namespace std
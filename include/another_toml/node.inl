@@ -20,6 +20,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <new>
+
+#include "another_toml/except.hpp"
 #include "another_toml/node.hpp"
 
 namespace another_toml
@@ -32,26 +35,87 @@ namespace another_toml
 		if (!key.good())
 			throw node_not_found{ "Unable to find key" };
 
-		return key.as_t<T>();
+		return key.template as_type<T>();
 	}
 
 	template<bool R>
 	template<typename T>
 	T basic_node<R>::get_value(std::string_view key_name, T def) const
 	{
-		try
+		if (!good())
+			throw bad_node{ "Called get_value on a bad node" };
+
+		if (!table() && !inline_table())
+			throw wrong_node_type{ "Cannot call get_value on this type of node" };
+
+		// missing keys are expected here, so don't go through the throwing find_child
+		const auto key = find_child(key_name, no_throw);
+		if (!key.good())
+			return def;
+
+		return key.template as_type<T>();
+	}
+
+	template<bool R>
+	template<typename T>
+	std::optional<T> basic_node<R>::get_value(std::string_view key_name, no_throw_t) const
+	{
+		return find_child(key_name, no_throw).template as_type<T>(no_throw);
+	}
+
+	template<bool R>
+	template<typename T>
+	T basic_node<R>::as_type() const
+	{
+		if constexpr (detail::is_container_v<T>)
 		{
-			return get_value<T>(key_name);
+			static_assert(detail::is_toml_type<typename T::value_type>,
+				"Extracting arrays requires the target type to be an exact TOML type");
+
+			if (!array())
+				throw wrong_node_type{ "Error: calling as_type with a container type requires this to be an array node" };
+
+			using element_t = typename T::value_type;
+			if constexpr ((std::is_same_v<element_t, std::int64_t> || std::is_same_v<element_t, double> ||
+				std::is_same_v<element_t, bool>) &&
+				std::is_constructible_v<T, const element_t*, const element_t*>)
+			{
+				if (const auto values = as_span<element_t>(no_throw); values)
+					return T(values->begin(), values->end());
+			}
+
+			auto out = T{};
+			for (const auto n : *this)
+				out.push_back(n.template as_type<typename T::value_type>());
+
+			return out;
 		}
-		catch (const node_not_found&)
+		else
 		{
-			return def;
+			static_assert(detail::is_toml_type<T>, "as_type() must be called with an exact TOML type.");
+
+			if constexpr (std::is_same_v<T, std::int64_t>)
+				return as_integer();
+			else if constexpr (std::is_same_v<T, double>)
+				return as_floating();
+			else if constexpr (std::is_same_v<T, bool>)
+				return as_boolean();
+			else if constexpr (std::is_same_v<T, std::string>)
+				return as_string();
+			else if constexpr (std::is_same_v<T, date>)
+				return as_date_local();
+			else if constexpr (std::is_same_v<T, time>)
+				return as_time_local();
+			else if constexpr (std::is_same_v<T, local_date_time>)
+				return as_date_time_local();
+			else if constexpr (std::is_same_v<T, date_time>)
+				return as_date_time();
 		}
 	}
 
 	template<bool R>
 	template<typename T>
-	T basic_node<R>::as_type() const
+	std::optional<T> basic_node<R>::as_type(no_throw_t) const
 	{
 		if constexpr (detail::is_container_v<T>)
 		{
@@ -59,36 +123,100 @@ namespace another_toml
 				"Extracting arrays requires the target type to be an exact TOML type");
 
 			if (!array())
-				throw wrong_node_type{ "Error: calling as_t with a container type requires this to be an array node" };
+				return {};
+
+			using element_t = typename T::value_type;
+			if constexpr ((std::is_same_v<element_t, std::int64_t> || std::is_same_v<element_t, double> ||
+				std::is_same_v<element_t, bool>) &&
+				std::is_constructible_v<T, const element_t*, const element_t*>)
+			{
+				if (const auto values = as_span<element_t>(no_throw); values)
+					return T(values->begin(), values->end());
+			}
 
 			auto out = T{};
 			for (const auto n : *this)
-				out.push_back(n.as_type<typename T::value_type>());
+			{
+				auto value = n.template as_type<typename T::value_type>(no_throw);
+				if (!value)
+					return {};
+				out.push_back(std::move(*value));
+			}
 
 			return out;
 		}
 		else
 		{
-			static_assert(detail::is_toml_type<T>, "as_t() must be called with an exact TOML type.")
-
-				if constexpr (std::is_same_v<T, std::int64_t>)
-					return as_integer();
-				else if constexpr (std::is_same_v<T, double>)
-					return as_floating();
-				else if constexpr (std::is_same_v<T, bool>)
-					return as_boolean();
-				else if constexpr (std::is_same_v<T, std::string>)
-					return as_string();
-				else if constexpr (std::is_same_v<T, date>)
-					return as_date_local();
-				else if constexpr (std::is_same_v<T, time>)
-					return as_time_local();
-				else if constexpr (std::is_same_v<T, local_date_time>)
-					return as_date_time_local();
-				else if constexpr (std::is_same_v<T, date_time>)
-					return as_date_time();
+			static_assert(detail::is_toml_type<T>, "as_type() must be called with an exact TOML type.");
+
+			if constexpr (std::is_same_v<T, std::int64_t>)
+				return as_integer(no_throw);
+			else if constexpr (std::is_same_v<T, double>)
+				return as_floating(no_throw);
+			else if constexpr (std::is_same_v<T, bool>)
+				return as_boolean(no_throw);
+			else if constexpr (std::is_same_v<T, std::string>)
+			{
+				const auto str = as_string_view(no_throw);
+				if (!str)
+					return {};
+				return std::string{ *str };
+			}
+			else if constexpr (std::is_same_v<T, date>)
+				return as_date_local(no_throw);
+			else if constexpr (std::is_same_v<T, time>)
+				return as_time_local(no_throw);
+			else if constexpr (std::is_same_v<T, local_date_time>)
+				return as_date_time_local(no_throw);
+			else if constexpr (std::is_same_v<T, date_time>)
+				return as_date_time(no_throw);
 		}
+	}
+
+	template<bool R>
+	template<typename T>
+	span<const T> basic_node<R>::as_span() const
+	{
+		static_assert(std::is_same_v<T, std::int64_t> || std::is_same_v<T, double> ||
+			std::is_same_v<T, bool>, "as_span() must be called with std::int64_t, double or bool");
+
+		if (!good())
+			throw bad_node{ "Called as_span on a bad node" };
+
+		if (!array())
+			throw wrong_node_type{ "Error: calling as_span requires this to be an array node" };
+
+		if (const auto values = as_span<T>(no_throw); values)
+			return *values;
+
+		for (const auto n : *this)
+		{
+			if (!n.template as_type<T>(no_throw))
+				throw wrong_type{ "Error: calling as_span requires every element of the array to be the requested type" };
+		}
+
+		// every element is a T, so the buffer couldn't be allocated
+		throw std::bad_alloc{};
+	}
+
+	template<bool R>
+	template<typename T>
+	std::optional<span<const T>> basic_node<R>::as_span(no_throw_t) const noexcept
+	{
+		static_assert(std::is_same_v<T, std::int64_t> || std::is_same_v<T, double> ||
+			std::is_same_v<T, bool>, "as_span() must be called with std::int64_t, double or bool");
+
+		if (!array())
+			return {};
+
+		if (size() == 0)
+			return span<const T>{};
+
+		if constexpr (std::is_same_v<T, std::int64_t>)
+			return detail::get_packed_integers(*_data, _index);
+		else if constexpr (std::is_same_v<T, double>)
+			return detail::get_packed_floats(*_data, _index);
 		else
-			throw wrong_type{ "Unable to convert node to type" };
+			return detail::get_packed_booleans(*_data, _index);
 	}
 }
@@ -23,28 +23,227 @@
 #ifndef ANOTHER_TOML_PARSER_HPP
 #define ANOTHER_TOML_PARSER_HPP
 
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "another_toml/node.hpp"
 
 namespace another_toml
 {
+	// The kinds of error that stop a parse, named after the matching exceptions in except.hpp
+	enum class parse_error_kind : std::uint8_t
+	{
+		toml_error,
+		unexpected_eof,
+		unexpected_character,
+		parsing_error,
+		duplicate_element,
+		unicode_error,
+		invalid_unicode_char,
+		// the file couldn't be read, the position is 0
+		file_error
+	};
+
+	// An error reported to a diagnostics_handler
+	class diagnostic
+	{
+	public:
+		diagnostic(parse_error_kind k, std::size_t l, std::size_t c, std::size_t o,
+			std::function<std::string()> render)
+			: kind{ k }, line{ l }, column{ c }, offset{ o }, _render{ std::move(render) }
+		{}
+
+		// Returns the message that would have been written to std::cerr.
+		// This parses the document again, and can only be called from diagnostics_handler::error.
+		std::string message() const { return _render(); }
+
+		parse_error_kind kind;
+		// where the error was found, counted from 0 like toml_error::line() and toml_error::column()
+		std::size_t line, column;
+		// byte offset of the error from the start of the document
+		std::size_t offset;
+
+	private:
+		std::function<std::string()> _render;
+	};
+
+	// Receives errors from the no_throw parse functions, see parser_options::diagnostics
+	class diagnostics_handler
+	{
+	public:
+		virtual ~diagnostics_handler() noexcept = default;
+
+		// Called once with the error that stopped the parse
+		virtual void error(const diagnostic&) = 0;
+	};
+
+	// Configurable options for controlling how documents are read
+	struct parser_options
+	{
+		// Memory map files instead of reading them through a std::ifstream.
+		// Files that can't be mapped (eg. pipes or procfs files) are read normally,
+		// as are all files on platforms without mmap.
+		bool memory_map = false;
+		// Reference unescaped key names and string values directly from the input buffer,
+		// rather than copying them into the root_node. Only strings that differ from
+		// their input text (eg. because of escape sequences) are copied.
+		// The caller must keep the buffer alive and unchanged for as long as the root_node
+		// and any nodes taken from it are in use.
+		// Only used when parsing from a string, streams and files are always copied.
+		bool borrow_input = false;
+		// Only check the syntax and range of floating point values while parsing, the value is
+		// converted the first time it's read and then kept. Integers also skip being reformatted.
+		// The conversion is synchronised, so nodes from the same root_node can still be read
+		// from several threads at once.
+		bool lazy_values = false;
+		// Parse large documents using up to this many threads, the document is split
+		// at [table] and [[array table]] headers. 0 uses every hardware thread.
+		// Only used when parsing from a string, a stream or a file.
+		std::size_t threads = 1;
+		// Report errors from the no_throw parse functions here instead of writing them to std::cerr.
+		// Error messages aren't formatted unless the handler asks for them,
+		// except by incremental_parser, which has discarded the input by then.
+		diagnostics_handler* diagnostics = nullptr;
+	};
+
+	// Receives the contents of a document from parse(..., parse_handler&) in document order.
+	// Override the functions for the parts of the document you need, the rest are ignored.
+	// Names and strings are only valid until the function returns.
+	class parse_handler
+	{
+	public:
+		virtual ~parse_handler() noexcept = default;
+
+		// [table]
+		// The path contains each part of a dotted table name, starting from the root table
+		virtual void begin_table(const std::vector<std::string_view>&) {}
+		// [[array_table]]
+		// called for every table added to the array
+		virtual void begin_array_table(const std::vector<std::string_view>&) {}
+
+		// The path contains each part of a dotted key name,
+		// starting from the current table or inline table.
+		// Followed by a value, array or inline table.
+		virtual void key(const std::vector<std::string_view>&) {}
+
+		virtual void begin_array() {}
+		virtual void end_array() {}
+		virtual void begin_inline_table() {}
+		virtual void end_inline_table() {}
+
+		// The bool is true for 'literal strings'
+		virtual void string_value(std::string_view, bool) {}
+		virtual void integer_value(std::int64_t, int_base) {}
+		virtual void floating_value(double, float_rep) {}
+		virtual void boolean_value(bool) {}
+		virtual void date_time_value(date_time) {}
+		virtual void date_time_local_value(local_date_time) {}
+		virtual void date_local_value(date) {}
+		virtual void time_local_value(time) {}
+	};
+
 	// Parse a TOML document.
 	root_node parse(std::string_view toml);
 	root_node parse(const std::string& toml);
 	root_node parse(const char* toml);
+	root_node parse(std::string_view toml, const parser_options&);
+	root_node parse(const std::string& toml, const parser_options&);
+	root_node parse(const char* toml, const parser_options&);
 	root_node parse(std::istream&);
+	root_node parse(std::istream&, const parser_options&);
 	// NOTE: user must handle std exceptions related to file reading
 	// eg. std::filesystem_error and its children.
 	root_node parse(const std::filesystem::path& filename);
+	root_node parse(const std::filesystem::path& filename, const parser_options&);
 
 	// Parse a TOML document without throwing another_toml exceptions
-	// Errors are reported to std::cerr.
+	// Errors are written to std::cerr, unless parser_options::diagnostics is set.
 	root_node parse(std::string_view toml, no_throw_t);
 	root_node parse(const std::string& toml, no_throw_t);
 	root_node parse(const char* toml, no_throw_t);
+	root_node parse(std::string_view toml, const parser_options&, no_throw_t);
+	root_node parse(const std::string& toml, const parser_options&, no_throw_t);
+	root_node parse(const char* toml, const parser_options&, no_throw_t);
 	root_node parse(std::istream&, no_throw_t);
+	root_node parse(std::istream&, const parser_options&, no_throw_t);
 	root_node parse(const std::filesystem::path& filename, no_throw_t);
+	root_node parse(const std::filesystem::path& filename, const parser_options&, no_throw_t);
+
+	// Parse a TOML document, passing its contents to a parse_handler instead of returning a root_node.
+	// Values are never stored, only the names of tables and keys are kept while parsing,
+	// so that the document is validated the same way as the other parse functions.
+	// Returns false if the document couldn't be read.
+	// NOTE: the handler may have received part of the document before an error is found.
+	// parser_options::borrow_input, lazy_values and threads don't apply to a handler.
+	bool parse(std::string_view toml, parse_handler&);
+	bool parse(const std::string& toml, parse_handler&);
+	bool parse(const char* toml, parse_handler&);
+	bool parse(std::string_view toml, const parser_options&, parse_handler&);
+	bool parse(const std::string& toml, const parser_options&, parse_handler&);
+	bool parse(const char* toml, const parser_options&, parse_handler&);
+	bool parse(const std::filesystem::path& filename, parse_handler&);
+	bool parse(const std::filesystem::path& filename, const parser_options&, parse_handler&);
+
+	bool parse(std::string_view toml, parse_handler&, no_throw_t);
+	bool parse(const std::string& toml, parse_handler&, no_throw_t);
+	bool parse(const char* toml, parse_handler&, no_throw_t);
+	bool parse(std::string_view toml, const parser_options&, parse_handler&, no_throw_t);
+	bool parse(const std::string& toml, const parser_options&, parse_handler&, no_throw_t);
+	bool parse(const char* toml, const parser_options&, parse_handler&, no_throw_t);
+	bool parse(const std::filesystem::path& filename, parse_handler&, no_throw_t);
+	bool parse(const std::filesystem::path& filename, const parser_options&, parse_handler&, no_throw_t);
+
+	// Parses a document that arrives in pieces (eg. from a socket).
+	// Each complete line is parsed as soon as it has been fed in,
+	// pieces can be split anywhere, including inside strings and line endings.
+	// Uses parser_options::lazy_values and diagnostics, the other options don't apply.
+	class incremental_parser
+	{
+	public:
+		explicit incremental_parser(const parser_options& = {});
+
+		// Add the next piece of the document.
+		// Once an error has been reported further input is ignored
+		// and finish() returns a bad node.
+		void feed(std::string_view toml);
+		// Returns false if an error has been reported
+		bool feed(std::string_view toml, no_throw_t);
+
+		// Parses anything that remains and returns the document.
+		// The parser can then be used to parse a new document.
+		root_node finish();
+		root_node finish(no_throw_t);
+
+	private:
+		std::unique_ptr<detail::incremental_state, detail::incremental_state_deleter> _state;
+	};
+
+	// Parses many documents one after another, keeping its scratch buffers between them.
+	// Documents passed back to recycle() have their node storage reused by the next parse,
+	// so parsing small documents stops allocating once the parser has warmed up.
+	// parser_options::threads is ignored, each parser parses on the calling thread.
+	// A parser must not be used by several threads at once.
+	class parser
+	{
+	public:
+		explicit parser(const parser_options& = {});
+
+		root_node parse(std::string_view toml);
+		root_node parse(std::string_view toml, no_throw_t);
+
+		// Keep a document's storage for the next parse, the parser holds on to one document.
+		// The document and any nodes taken from it can no longer be used.
+		void recycle(root_node&& document) noexcept;
+		// Release the buffers and storage held by the parser.
+		void reset();
+
+	private:
+		std::unique_ptr<detail::parser_cache, detail::parser_cache_deleter> _cache;
+	};
 }
 
 #endif
@@ -57,7 +57,25 @@ namespace another_toml
 	};
 
 	// Parses floating point TOML value strings
-	parse_float_string_return parse_float_string(std::string_view str);
+	// Strings over 64 chars need a heap allocation, error_t::bad is returned if it fails
+	parse_float_string_return parse_float_string(std::string_view str) noexcept;
+	// Returns true if str is a valid floating point value string whose value is certain to be
+	// storable without converting it, and that parse_float_string can convert without allocating.
+	// Other strings need to be checked with parse_float_string.
+	bool float_string_in_range(std::string_view str) noexcept;
+
+	struct parse_integer_string_return
+	{
+		std::int64_t value;
+		int_base base = int_base::dec;
+
+		using error_t = parse_float_string_return::error_t;
+		// if != error_t::none, then an error occured
+		error_t error = error_t::none;
+	};
+
+	// Parses integer TOML value strings (decimal, hex, octal or binary)
+	parse_integer_string_return parse_integer_string(std::string_view str) noexcept;
 
 	// Throws unicode_error if str is not a valid UTF-8 string
 	// to_escaped_string only escapes control characters
@@ -80,7 +98,13 @@ namespace another_toml
 	// Set ascii_output to return an ASCII string; unicode chars will be escaped.
 	std::string escape_toml_name(std::string_view str, bool ascii_ouput = false);
 
-	bool unicode_string_equal(std::string_view lhs, std::string_view rhs);
+	bool unicode_string_equal(std::string_view lhs, std::string_view rhs) noexcept;
+	// Returns the NFC normalised form of a UTF-8 string
+	// ASCII strings are returned unchanged
+	std::string to_nfc_string(std::string_view str);
+	// Writes the NFC normalised form of a UTF-8 string into buffer without allocating
+	// Returns the part of buffer that was written, or an empty optional if it didn't fit
+	std::optional<std::string_view> to_nfc_string(std::string_view str, span<char> buffer) noexcept;
 	
 	// returns true if string contains any unicode code units
 	bool contains_unicode(std::string_view s) noexcept;
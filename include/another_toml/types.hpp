@@ -120,6 +120,51 @@ namespace another_toml
 	// Tag type
 	struct no_throw_t {};
 	constexpr auto no_throw = no_throw_t{};
+
+	// View of contiguous values, returned by basic_node::as_span
+	template<typename T>
+	class span
+	{
+	public:
+		constexpr span() noexcept = default;
+		constexpr span(T* data, std::size_t size) noexcept
+			: _data{ data }, _size{ size }
+		{}
+
+		constexpr T* data() const noexcept
+		{
+			return _data;
+		}
+
+		constexpr std::size_t size() const noexcept
+		{
+			return _size;
+		}
+
+		constexpr bool empty() const noexcept
+		{
+			return _size == 0;
+		}
+
+		constexpr T& operator[](std::size_t i) const noexcept
+		{
+			return _data[i];
+		}
+
+		constexpr T* begin() const noexcept
+		{
+			return _data;
+		}
+
+		constexpr T* end() const noexcept
+		{
+			return _data + _size;
+		}
+
+	private:
+		T* _data = nullptr;
+		std::size_t _size = {};
+	};
 }
 
 #endif
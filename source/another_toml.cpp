@@ -20,21 +20,50 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <bitset>
 #include <cassert>
 #include <charconv>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
-#include <regex>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <sstream>
+#include <stdexcept>
 #include <string_view>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ANOTHER_TOML_HAS_MMAP
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define ANOTHER_TOML_HAS_SSE2
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define ANOTHER_TOML_TARGET_AVX2
+#else
+#define ANOTHER_TOML_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 #include "uni_algo/break_grapheme.h"
 #include "uni_algo/conv.h"
+#include "uni_algo/norm.h"
 
 #include "another_toml/except.hpp"
 #include "another_toml/internal.hpp"
@@ -83,1016 +112,2006 @@ namespace another_toml
 			//dates,
 			date_time, local_date_time, date, time>;
 
+		// A node waiting to be added to toml_internal_data by insert_child
 		struct internal_node
 		{
-			internal_node(std::string name, const node_type n_t) noexcept
-				: name{ std::move(name) }, type{ n_t } {}
-			internal_node(std::string name, const node_type n_t, const value_type v_t, variant_t value) noexcept
-				: name{ std::move(name) }, type{ n_t }, v_type{ v_t }, value{ std::move(value) } {}
+			internal_node(std::string_view name, const node_type n_t) noexcept
+				: name{ name }, type{ n_t } {}
+			internal_node(std::string_view name, const node_type n_t, const value_type v_t, variant_t value) noexcept
+				: name{ name }, type{ n_t }, v_type{ v_t }, value{ std::move(value) } {}
 
-			std::string name;
+			std::string_view name;
 			variant_t value;
-			index_t next = bad_index;
-			index_t child = bad_index;
 			table_def_type table_type = table_def_type::end;
 			value_type v_type = value_type::bad;
 			node_type type;
-			// a closed table can still have child tables added, but not child keys
 			bool closed = true;
+			bool ascii_name = true;
 		};
 
-		struct toml_internal_data
-		{
-			std::vector<internal_node> nodes = { internal_node{ {}, node_type::root_table } };
-#ifndef NDEBUG
-			std::string input_log;
-#endif
-		};
-
-		void toml_data_deleter::operator()(toml_internal_data* ptr) noexcept
-		{
-			delete ptr;
-		}
-
-		index_t get_next(const toml_internal_data& d, const index_t i) noexcept
-		{
-			assert(size(d.nodes) > i);
-			return d.nodes[i].next;
-		}
+		// Node indices are stored as 32-bit values in the node links
+		using link_t = std::uint32_t;
+		constexpr auto bad_link = std::numeric_limits<link_t>::max();
+		// The largest number of nodes a document can hold
+		constexpr auto max_nodes = index_t{ bad_link };
 
-		static index_t find_parent(const toml_internal_data& d, const index_t i) noexcept
+		// Sibling, first and last child, parent and child count of a node
+		class node_links
 		{
-			auto index = i;
-			auto prev = i;
-			while (--index <= i)
+		public:
+			index_t next() const noexcept
 			{
-				if (d.nodes[index].next == prev)
-					prev = index;
-				if (d.nodes[index].child == prev)
-					return index;
+				return from_link(_next);
 			}
-			return bad_index;
-		}
-	}
-
-	using namespace detail;
 
-	static std::string to_string(node_type n)
-	{
-		switch (n)
-		{
-		case node_type::array:
-			return "array"s;
-		case node_type::array_tables:
-			return "array table"s;
-		case node_type::inline_table:
-			return "inline table"s;
-		case node_type::key:
-			return "key"s;
-		case node_type::value:
-			return "value"s;
-		case node_type::table:
-			return "table"s;
-		case node_type::root_table:
-			return "root table"s;
-		}
+			index_t child() const noexcept
+			{
+				return from_link(_child);
+			}
 
-		return "error type"s;
-	}
+			index_t last_child() const noexcept
+			{
+				return from_link(_last_child);
+			}
 
-	constexpr auto root_table = index_t{};
+			index_t parent() const noexcept
+			{
+				return from_link(_parent);
+			}
 
-	// method defs for nodes
-	template<bool R>
-	bool basic_node<R>::good() const noexcept
-	{
-		return _data && !(_index == bad_index ||
-			node_type::end == _data->nodes[_index].type);
-	}
+			std::size_t child_count() const noexcept
+			{
+				return _child_count;
+			}
 
-	// test node type
-	template<bool R>
-	bool basic_node<R>::table() const noexcept
-	{
-		if (!good())
-			return false;
+			// Children are always appended to their parent after being pushed,
+			// so a parent whose children have no descendants holds them in a
+			// contiguous block of node indices.
+			bool contiguous_children() const noexcept
+			{
+				return _child != bad_link &&
+					std::size_t{ _last_child } - _child + 1 == _child_count;
+			}
 
-		const auto type = _data->nodes[_index].type;
-		return type == node_type::table || type == node_type::root_table;
-	}
+			void set_next(const index_t i) noexcept
+			{
+				_next = to_link(i);
+			}
 
-	template<bool R>
-	bool basic_node<R>::array() const noexcept
-	{
-		return good() && node_type::array == _data->nodes[_index].type;
-	}
+			void set_child(const index_t i) noexcept
+			{
+				_child = to_link(i);
+			}
 
-	template<bool R>
-	bool basic_node<R>::array_table() const noexcept
-	{
-		return good() && node_type::array_tables == _data->nodes[_index].type;
-	}
+			void set_last_child(const index_t i) noexcept
+			{
+				_last_child = to_link(i);
+			}
 
-	template<bool R>
-	bool basic_node<R>::key() const noexcept
-	{
-		return good() && node_type::key == _data->nodes[_index].type;
-	}
+			void set_parent(const index_t i) noexcept
+			{
+				_parent = to_link(i);
+			}
 
-	template<bool R>
-	bool basic_node<R>::value() const noexcept
-	{
-		return good() && node_type::value == _data->nodes[_index].type;
-	}
+			void set_child_count(const std::size_t count) noexcept
+			{
+				assert(count < max_nodes);
+				_child_count = static_cast<link_t>(count);
+			}
 
-	template<bool R>
-	bool basic_node<R>::inline_table() const noexcept
-	{
-		return good() && node_type::inline_table == _data->nodes[_index].type;
-	}
+		private:
+			static constexpr index_t from_link(const link_t l) noexcept
+			{
+				return l == bad_link ? bad_index : index_t{ l };
+			}
 
-	template<bool R>
-	value_type basic_node<R>::type() const noexcept
-	{
-		if (!good())
-			return value_type::bad;
-		return _data->nodes[_index].v_type;
-	}
+			static constexpr link_t to_link(const index_t i) noexcept
+			{
+				assert(i == bad_index || i < max_nodes);
+				return i == bad_index ? bad_link : static_cast<link_t>(i);
+			}
 
-	template<bool R>
-	bool basic_node<R>::has_children() const noexcept
-	{
-		return good() && _data->nodes[_index].child != bad_index;
-	}
+			link_t _next = bad_link;
+			link_t _child = bad_link;
+			link_t _last_child = bad_link;
+			link_t _parent = bad_link;
+			link_t _child_count = {};
+		};
 
-	template<bool R>
-	std::vector<basic_node<>> basic_node<R>::get_children() const
-	{
-		if (!good())
-			throw bad_node{ "Called get_children on a bad node"s };
+		struct node_tags
+		{
+			node_type type;
+			value_type v_type = value_type::bad;
+			table_def_type table_type = table_def_type::end;
+			// a closed table can still have child tables added, but not child keys
+			bool closed = true;
+			// name is ASCII, and so is already NFC normalised.
+			// Otherwise the normalised name is stored in toml_internal_data::nfc_names
+			bool ascii_name = true;
+		};
 
-		auto out = std::vector<basic_node<>>{};
-		auto child = _data->nodes[_index].child;
-		while (child != bad_index)
+		// Monotonic storage for node names and string values.
+		// Strings are never freed individually, all the blocks are
+		// released together with the owning toml_internal_data.
+		class string_arena
 		{
-			if constexpr (R)
-				out.emplace_back(basic_node<>{ _data.get(), child });
-			else	
-				out.emplace_back(basic_node<>{ _data, child });
+		public:
+			// Copies str into the arena, the returned view is valid
+			// for the lifetime of the arena
+			std::string_view store(std::string_view str)
+			{
+				if (empty(str))
+					return {};
 
-			child = _data->nodes[child].next;
-		}
-		return out;
-	}
+				const auto sz = size(str);
+				if (sz > _remaining)
+				{
+					// large strings get a block of their own, so the space
+					// left in the current block isn't wasted
+					if (sz > block_size / 4)
+						return { copy_to(allocate_block(sz), str), sz };
 
-	template<>
-	basic_node<> basic_node<true>::get_first_child() const
-	{
-		if (!good())
-			throw bad_node{ "Called get_first_child on a bad node"s };
+					_pos = _block = allocate_block(block_size);
+					_remaining = block_size;
+				}
 
-		return basic_node<>{ _data.get(), _data->nodes[_index].child};
-	}
+				const auto out = copy_to(_pos, str);
+				_pos += sz;
+				_remaining -= sz;
+				return { out, sz };
+			}
 
-	template<>
-	basic_node<> basic_node<>::get_first_child() const
-	{
-		if (!good())
-			throw bad_node{ "Called get_first_child on a bad node"s };
+			// Forgets every stored string, keeping the current block to be reused
+			void clear() noexcept
+			{
+				auto keep = std::unique_ptr<char[]>{};
+				for (auto& block : _blocks)
+				{
+					if (block.get() == _block)
+						keep = std::move(block);
+				}
 
-		return basic_node<>{ _data, _data->nodes[_index].child};
-	}
+				// the vector keeps its capacity, so this doesn't allocate
+				_blocks.clear();
+				_pos = keep.get();
+				_remaining = keep ? block_size : std::size_t{};
+				if (keep)
+					_blocks.push_back(std::move(keep));
+				return;
+			}
 
-	template<bool R>
-	bool basic_node<R>::has_sibling() const noexcept
-	{
-		return good() && _data->nodes[_index].next != bad_index;
-	}
+			// Takes ownership of other's blocks, views into them remain valid
+			void adopt(string_arena&& other)
+			{
+				std::move(begin(other._blocks), end(other._blocks), std::back_inserter(_blocks));
+				other._blocks.clear();
+				other._block = nullptr;
+				other._pos = nullptr;
+				other._remaining = {};
+				return;
+			}
 
-	template<>
-	basic_node<> basic_node<true>::get_next_sibling() const
-	{
-		if (!good())
-			throw bad_node{ "Called get_next_sibling on a bad node"s };
+		private:
+			char* allocate_block(const std::size_t sz)
+			{
+				return _blocks.emplace_back(new char[sz]).get();
+			}
 
-		return basic_node<>{ _data.get(), _data->nodes[_index].next};
-	}
+			static const char* copy_to(char* dest, std::string_view str) noexcept
+			{
+				std::copy(begin(str), end(str), dest);
+				return dest;
+			}
 
-	template<>
-	basic_node<> basic_node<>::get_next_sibling() const
-	{
-		if (!good())
-			throw bad_node{ "Called get_next_sibling on a bad node"s };
+			static constexpr auto block_size = std::size_t{ 16 * 1024 };
+			std::vector<std::unique_ptr<char[]>> _blocks;
+			// the block that small strings are being stored in
+			char* _block = nullptr;
+			char* _pos = nullptr;
+			std::size_t _remaining = {};
+		};
 
-		return basic_node<>{ _data, _data->nodes[_index].next};
-	}
+		// Names up to this many bytes are normalised on the stack when looking them up
+		constexpr auto nfc_name_buffer_size = std::size_t{ 256 };
+		// Tables with at least this many children get a child_index
+		constexpr auto child_index_threshold = std::size_t{ 32 };
+		// Arrays and tables with at least this many children that aren't stored
+		// contiguously get an entry in child_offsets
+		constexpr auto child_offsets_threshold = std::size_t{ 16 };
+
+		// Values belonging to some of the arrays in a document, stored back to back
+		// so that clearing the store keeps its capacity.
+		// Arrays must be added in index order.
+		template<typename T>
+		class array_store
+		{
+		public:
+			// Following calls to push_back add values to array
+			void begin_array(const index_t array)
+			{
+				assert(_arrays.empty() || _arrays.back().array < array);
+				_arrays.push_back(entry{ array, size(_values) });
+				return;
+			}
 
-	template<bool R>
-	basic_node<> basic_node<R>::find_child(std::string_view name) const
-	{
-		if (!good())
-			throw bad_node{ "Called find_child on a bad node"s };
+			void push_back(const T value)
+			{
+				_values.push_back(value);
+				return;
+			}
 
-		if (!table() && !inline_table())
-			throw wrong_node_type{ "Cannot call find_child on this type of node"s };
-		
-		auto child = get_first_child();
-		while (child.good() && !unicode_string_equal(child.as_string(), name))
-			child = child.get_next_sibling();
+			void reserve_more(const std::size_t count)
+			{
+				_values.reserve(size(_values) + count);
+				return;
+			}
 
-		if (!child.good())
-			throw node_not_found{ "Failed to find child node"s };
+			// Returns the values of array, or an empty optional if it wasn't added
+			std::optional<span<const T>> find(const index_t array) const noexcept
+			{
+				const auto iter = std::lower_bound(begin(_arrays), end(_arrays), array,
+					[](const entry& e, const index_t i) noexcept {
+						return e.array < i;
+					});
 
-		if (child.key())
-			return child.get_first_child();
+				if (iter == end(_arrays) || iter->array != array)
+					return {};
 
-		return child;
-	}
+				const auto last = next(iter) == end(_arrays) ? size(_values) : next(iter)->first;
+				return span<const T>{ data(_values) + iter->first, last - iter->first };
+			}
 
-	template<bool R>
-	basic_node<> basic_node<R>::find_child(std::string_view name, no_throw_t) const noexcept
-	{
-		if (!table() && !inline_table())
-			return basic_node<>{};
+			bool empty() const noexcept
+			{
+				return _arrays.empty();
+			}
 
-		auto child = get_first_child();
-		while (child.good() && !unicode_string_equal(child.as_string(), name))
-			child = child.get_next_sibling();
+			void clear() noexcept
+			{
+				_arrays.clear();
+				_values.clear();
+				return;
+			}
 
-		if (child.key())
-			return child.get_first_child();
+		private:
+			struct entry
+			{
+				index_t array;
+				std::size_t first;
+			};
 
-		return child;
-	}
+			std::vector<entry> _arrays;
+			std::vector<T> _values;
+		};
 
-	template<bool R>
-	node_iterator basic_node<R>::begin() const noexcept
-	{
-		const auto child = _data->nodes[_index].child;
-		if (child != bad_index)
+		// A name along with its hash, so that node_path lookups can reuse
+		// the hash they computed up front
+		struct hashed_name
 		{
-			if constexpr (R)
-				return node_iterator{ _data.get(), child};
-			else
-				return node_iterator{ _data, child };
-		}
-		else
-			return end();
-	}
+			hashed_name(std::string_view n) noexcept
+				: name{ n }, hash{ std::hash<std::string_view>{}(n) }
+			{}
 
-	template<bool R>
-	node_iterator basic_node<R>::end() const noexcept
-	{
-		return node_iterator{};
-	}
+			hashed_name(std::string_view n, std::size_t h) noexcept
+				: name{ n }, hash{ h }
+			{}
 
-	struct to_string_visitor
-	{
-	public:
-		const writer_options& options;
+			bool operator==(const hashed_name& rhs) const noexcept
+			{
+				return hash == rhs.hash && name == rhs.name;
+			}
 
-		std::string operator()(std::monostate)
+			std::string_view name;
+			std::size_t hash;
+		};
+
+		struct hashed_name_hash
 		{
-			throw wrong_type{ "This node type cannot be converted to string"s };
-		}
+			std::size_t operator()(const hashed_name& n) const noexcept
+			{
+				return n.hash;
+			}
+		};
 
-		std::string operator()(string_t)
+		// Hashed lookup for the children of large tables
+		struct child_index
 		{
-			throw toml_error{ "Error outputing string value"s };
-		}
+			// NFC normalised child name -> child index
+			std::unordered_map<hashed_name, index_t, hashed_name_hash> names;
+		};
 
-		std::string operator()(detail::integral i)
+		// State of a value that is converted on first access
+		enum class lazy_state : std::uint8_t
 		{
-			auto out = std::stringstream{};
-			using base = int_base;
-			if (options.simple_numerical_output ||
-				i.value < 0)
-				i.base = base::dec;
+			ready,
+			pending,
+			converting
+		};
 
-			if (i.base == base::bin)
+		// Calls convert if state is pending, or waits for another thread that is already calling it.
+		// convert returns false if it failed, leaving the state pending for the next caller.
+		// Returns true if the value is ready, the writes made by convert are then visible to the caller.
+		template<typename Convert>
+		bool convert_once(std::atomic<lazy_state>& state, Convert&& convert) noexcept
+		{
+			if (state.load(std::memory_order_acquire) == lazy_state::ready)
+				return true;
+
+			auto expected = lazy_state::pending;
+			if (state.compare_exchange_strong(expected, lazy_state::converting, std::memory_order_acquire))
 			{
-				auto bin = std::bitset<64>{ *reinterpret_cast<uint64_t*>(&i.value) }.to_string();
-				auto beg = begin(bin);
-				auto end = std::end(bin);
-				while (beg != end && *beg == '0')
-					++beg;
-				const auto size = std::distance(beg, end);
-				if (size < 1)
-					out << "0b0"s;
-				else
-					out << "0b"s << std::string_view{ &*beg, static_cast<std::size_t>(size) };
-				return out.str();
+				const auto converted = convert();
+				state.store(converted ? lazy_state::ready : lazy_state::pending, std::memory_order_release);
+				return converted;
 			}
-			else
-			{
-				switch (i.base)
-				{
-				case base::dec:
-					out << std::dec;
-					break;
-				case base::hex:
-					out << std::hex << "0x"s;
-					break;
-				case base::oct:
-					out << std::oct << "0o"s;
-					break;
-				}
 
-				out << i.value;
-				return out.str();
+			// another thread is converting it
+			auto current = expected;
+			while (current == lazy_state::converting)
+			{
+				std::this_thread::yield();
+				current = state.load(std::memory_order_acquire);
 			}
+			return current == lazy_state::ready;
 		}
 
-		std::string operator()(detail::floating d)
+		// An array whose elements are all integers, all floats or all booleans
+		struct packable_array
 		{
-			if (std::isnan(d.value))
-				return "nan"s;
-			else if (d.value == std::numeric_limits<double>::infinity())
-				return "inf"s;
-			else if (d.value == -std::numeric_limits<double>::infinity())
-				return "-inf"s;
+			index_t array;
+			value_type type;
+		};
 
-			auto strm = std::ostringstream{};
-			if (d.rep == float_rep::scientific &&
-				!options.simple_numerical_output)
-				strm << std::scientific;
-			else if (d.rep == float_rep::fixed &&
-				!options.simple_numerical_output)
-				strm << std::fixed;
-			else // d.rep == default || simple_numerical_output enabled
-				strm << std::defaultfloat;
+		// The elements of a packable_array, copied into a contiguous buffer by the
+		// first call to toml_internal_data::packed_values
+		using packed_buffer = std::variant<std::monostate, std::unique_ptr<std::int64_t[]>,
+			std::unique_ptr<double[]>, std::unique_ptr<bool[]>>;
 
-			if (d.precision > auto_precision)
-				strm << std::setprecision(d.precision);
-	
-			strm << d.value;
-			auto str = strm.str();
+		// Nodes are stored as a structure of arrays, each indexed by the node index.
+		// Tree walks only need to touch the compact links and tags.
+		struct toml_internal_data
+		{
+			toml_internal_data()
+			{
+				push_node(internal_node{ {}, node_type::root_table });
+			}
 
-			if (str.find('.') == std::string::npos &&
-				str.find('e') == std::string::npos)
-				str += ".0"s;
+			index_t node_count() const noexcept
+			{
+				return size(links);
+			}
 
-			return str;
-		}
+			// Tests if str is a view into borrowed_input
+			bool is_borrowed(std::string_view str) const noexcept
+			{
+				// std::less gives a total order for unrelated pointers
+				const auto less = std::less<const char*>{};
+				return !less(data(str), data(borrowed_input)) &&
+					!less(data(borrowed_input) + size(borrowed_input), data(str) + size(str));
+			}
 
-		std::string operator()(date v)
-		{
-			auto strm = std::ostringstream{};
-			strm << std::setfill('0');
-			strm << std::setw(4) << v.year;
-			strm << '-' << std::setw(2) << static_cast<uint16_t>(v.month);
-			strm << '-' << std::setw(2) << static_cast<uint16_t>(v.day);
-			return strm.str();
-		}
+			// Appends n without linking it into the tree
+			index_t push_node(internal_node n)
+			{
+				const auto i = node_count();
+				if (i >= max_nodes)
+					throw std::length_error{ "TOML document contains too many nodes" };
+
+				links.emplace_back();
+				tags.emplace_back(node_tags{ n.type, n.v_type, n.table_type, n.closed, n.ascii_name });
+				names.emplace_back(n.name);
+				values.emplace_back(std::move(n.value));
+				return i;
+			}
 
-		std::string operator()(date_time v)
-		{
-			auto out = this->operator()(v.datetime);
-			if (v.offset_hours == 0 &&
-				v.offset_minutes == 0)
+			// Adds or removes nodes at the end, new nodes are not linked into the tree
+			void resize(const std::size_t count)
 			{
-				out.push_back('Z');
+				links.resize(count);
+				tags.resize(count);
+				names.resize(count);
+				values.resize(count);
+				return;
 			}
-			else
+
+			// Returns the value of node i, floating point values left unconverted
+			// by parser_options::lazy_values are converted and stored on first access.
+			// The parser only leaves values that float_string_in_range accepts, so
+			// the conversion can't fail or allocate.
+			// Once the document is complete, this is safe to call from several threads at once.
+			const variant_t& value(const index_t i) const noexcept
 			{
-				auto strm = std::ostringstream{};
-				strm << std::setfill('0');
-				out.push_back(v.offset_positive ? '+' : '-');
-				//strm << v.offset_positive ? '+' : '-';
-				strm << std::setw(2) << static_cast<uint16_t>(v.offset_hours);
-				strm << ':' << std::setw(2) << static_cast<uint16_t>(v.offset_minutes);
-				out += strm.str();
+				if (tags[i].v_type != value_type::floating_point)
+					return values[i];
+
+				// values aren't shared with other threads until the document is complete,
+				// and lazy_nodes is only filled in once it is
+				if (lazy_nodes.empty())
+				{
+					if (std::holds_alternative<std::monostate>(values[i]))
+						convert_lazy_value(i);
+					return values[i];
+				}
+
+				const auto iter = std::lower_bound(begin(lazy_nodes), end(lazy_nodes), i);
+				if (iter == end(lazy_nodes) || *iter != i)
+					return values[i];
+
+				convert_once(lazy_states[static_cast<std::size_t>(iter - begin(lazy_nodes))], [this, i]() noexcept {
+					convert_lazy_value(i);
+					return true;
+				});
+				return values[i];
 			}
-			return out;
-		}
 
-		std::string operator()(time v)
-		{
-			auto strm = std::ostringstream{};
-			strm << std::setfill('0');
-			strm << std::setw(2) << static_cast<uint16_t>(v.hours);
-			strm << ':' << std::setw(2) << static_cast<uint16_t>(v.minutes);
-			// TOML 1.1 optional seconds
-			strm << ':' << std::setw(2) << static_cast<uint16_t>(v.seconds);
-			if (v.seconds_frac != 0.f)
+			// Records the lazy floating point values that are still unconverted,
+			// called once the document is complete
+			void track_lazy_values()
 			{
-				auto fracs = std::to_string(v.seconds_frac);
-				while (!empty(fracs) && fracs.back() == '0')
-					fracs.pop_back();
-				strm << fracs.substr(1);
+				lazy_nodes.clear();
+				for (auto i = index_t{}; i < node_count(); ++i)
+				{
+					if (tags[i].v_type == value_type::floating_point &&
+						std::holds_alternative<std::monostate>(values[i]))
+						lazy_nodes.push_back(i);
+				}
+
+				lazy_states = std::vector<std::atomic<lazy_state>>(size(lazy_nodes));
+				for (auto& state : lazy_states)
+					state.store(lazy_state::pending, std::memory_order_relaxed);
+				return;
 			}
-			return strm.str();
-		}
 
-		std::string operator()(local_date_time v)
-		{
-			auto out = this->operator()(v.date);
-			using sep = writer_options::date_time_separator_t;
-			switch (options.date_time_separator)
+			// Returns the elements of array i if they are all a T, or an empty optional if
+			// they aren't, or if there isn't enough memory to copy them.
+			// The elements are copied into a contiguous buffer on first access,
+			// so that documents that never call this don't pay for it.
+			// Once the document is complete, this is safe to call from several threads at once.
+			template<typename T>
+			std::optional<span<const T>> packed_values(const index_t i) const noexcept
 			{
-			case sep::big_t:
-				out.push_back('T');
-				break;
-			case sep::whitespace:
-				out.push_back(' ');
-				break;
+				const auto iter = std::lower_bound(begin(packable_arrays), end(packable_arrays), i,
+					[](const packable_array& a, const index_t array) noexcept {
+						return a.array < array;
+					});
+
+				if (iter == end(packable_arrays) || iter->array != i)
+					return {};
+
+				if constexpr (std::is_same_v<T, std::int64_t>)
+				{
+					if (iter->type != value_type::integer)
+						return {};
+				}
+				else if constexpr (std::is_same_v<T, double>)
+				{
+					if (iter->type != value_type::floating_point)
+						return {};
+				}
+				else
+				{
+					static_assert(std::is_same_v<T, bool>);
+					if (iter->type != value_type::boolean)
+						return {};
+				}
+
+				const auto n = static_cast<std::size_t>(iter - begin(packable_arrays));
+				const auto& l = links[i];
+				const auto count = l.child_count();
+				const auto packed = convert_once(packed_states[n], [&]() noexcept {
+					auto buffer = std::unique_ptr<T[]>{ new (std::nothrow) T[count] };
+					if (!buffer)
+						return false;
+
+					// packable arrays have contiguous children
+					auto out = buffer.get();
+					for (auto child = l.child(); child != l.last_child() + 1; ++child)
+					{
+						if constexpr (std::is_same_v<T, std::int64_t>)
+							*out++ = std::get<integral>(values[child]).value;
+						else if constexpr (std::is_same_v<T, double>)
+							*out++ = std::get<floating>(value(child)).value; // value() decodes lazy floats
+						else
+							*out++ = std::get<bool>(values[child]);
+					}
+
+					packed_buffers[n] = std::move(buffer);
+					return true;
+				});
+
+				if (!packed)
+					return {};
+
+				return span<const T>{ std::get<std::unique_ptr<T[]>>(packed_buffers[n]).get(), count };
 			}
 
-			out += this->operator()(v.time);
-			return out;
-		}
+			// Prepares packed_values for the arrays in packable_arrays,
+			// called once the document is complete
+			void track_packable_arrays()
+			{
+				packed_buffers.clear();
+				packed_buffers.resize(size(packable_arrays));
+				packed_states = std::vector<std::atomic<lazy_state>>(size(packable_arrays));
+				for (auto& state : packed_states)
+					state.store(lazy_state::pending, std::memory_order_relaxed);
+				return;
+			}
 
-		std::string operator()(bool b)
-		{
-			return b ? "true"s : "false"s;
-		}
-	};
+			// Removes every node except an empty root table, keeping the allocated storage
+			void clear() noexcept
+			{
+				links.clear();
+				tags.clear();
+				names.clear();
+				values.clear();
+				strings.clear();
+				borrowed_input = {};
+				child_indexes.clear();
+				child_offsets.clear();
+				packable_arrays.clear();
+				packed_states.clear();
+				packed_buffers.clear();
+				nfc_names.clear();
+				lazy_nodes.clear();
+				lazy_states.clear();
+#ifndef NDEBUG
+				input_log.clear();
+#endif
+				push_node(internal_node{ {}, node_type::root_table });
+				return;
+			}
 
-	template<bool R>
-	std::string basic_node<R>::as_string() const
-	{
-		if (!good())
-			throw bad_node{ "Called as_string on a bad node"s };
+			// Removes the nodes after i, which must all be descendants of i
+			void erase_descendants(const index_t i)
+			{
+				const auto first = i + 1;
+				for (auto n = first; n < node_count(); ++n)
+				{
+					child_indexes.erase(n);
+					nfc_names.erase(n);
+				}
 
-		if(_data->nodes[_index].v_type == value_type::string ||
-			_data->nodes[_index].type != node_type::value)
-			return _data->nodes[_index].name;
+				// only filled in once the document is complete
+				assert(child_offsets.empty() && packable_arrays.empty() && lazy_nodes.empty());
 
-		return std::visit(to_string_visitor{ writer_options{} }, _data->nodes[_index].value);
-	}
+				links.resize(first);
+				tags.resize(first);
+				names.resize(first);
+				values.resize(first);
+				links[i].set_child(bad_index);
+				links[i].set_last_child(bad_index);
+				links[i].set_child_count(0);
+				return;
+			}
 
-	template<bool R>
-	std::string basic_node<R>::as_string(int_base b) const
-	{
-		if (!good())
-			throw bad_node{ "Called as_string on a bad node"s };
+			std::vector<node_links> links;
+			std::vector<node_tags> tags;
+			// points into strings
+			std::vector<std::string_view> names;
+			// lazy floating point values hold monostate until read through value()
+			mutable std::vector<variant_t> values;
+			// storage for names and nfc_names
+			string_arena strings;
+			// caller owned input that names may point into instead of strings,
+			// see parser_options::borrow_input
+			std::string_view borrowed_input;
+			// parent index -> child_index
+			std::unordered_map<index_t, child_index> child_indexes;
+			// index of each child, for arrays and tables whose children aren't contiguous
+			array_store<link_t> child_offsets;
+			// arrays of only integers, floats or booleans, in index order, once the document is complete.
+			// packed_states and packed_buffers hold the state and elements of each, see packed_values
+			std::vector<packable_array> packable_arrays;
+			mutable std::vector<std::atomic<lazy_state>> packed_states;
+			mutable std::vector<packed_buffer> packed_buffers;
+			// node index -> NFC normalised name, for non-ASCII key and table names
+			std::unordered_map<index_t, std::string_view> nfc_names;
+#ifndef NDEBUG
+			std::string input_log;
+#endif
 
-		try
-		{
-			auto value = std::get<integral>(_data->nodes[_index].value);
-			value.base = b;
+		private:
+			void convert_lazy_value(const index_t i) const noexcept
+			{
+				const auto ret = parse_float_string(names[i]);
+				assert(ret.error == parse_float_string_return::error_t::none);
+				if (ret.error == parse_float_string_return::error_t::none)
+					values[i] = floating{ ret.value, ret.representation };
+				else
+					values[i] = floating{ std::numeric_limits<double>::quiet_NaN(), float_rep::default };
+				return;
+			}
+
+			// node indexes of the unconverted lazy values, in order, once the document is complete.
+			// lazy_states holds the state of each, so that value() can convert them
+			// when it's called from several threads
+			std::vector<index_t> lazy_nodes;
+			mutable std::vector<std::atomic<lazy_state>> lazy_states;
+		};
 
-			return to_string_visitor{ writer_options{} }(value);
+		void toml_data_deleter::operator()(toml_internal_data* ptr) noexcept
+		{
+			delete ptr;
 		}
-		catch (const std::bad_variant_access&)
+
+		index_t get_next(const toml_internal_data& d, const index_t i) noexcept
 		{
-			throw wrong_type{ "This overload only works on integral types"s };
+			assert(d.node_count() > i);
+			return d.links[i].next();
 		}
-	}
 
-	template<bool R>
-	std::string basic_node<R>::as_string(float_rep rep, std::int8_t prec) const
-	{
-		if (!good())
-			throw bad_node{ "Called as_string on a bad node"s };
+		std::size_t get_child_count(const toml_internal_data& d, const index_t i) noexcept
+		{
+			assert(d.node_count() > i);
+			return d.links[i].child_count();
+		}
 
-		try
+		index_t get_child_at(const toml_internal_data& d, const index_t i, const std::size_t n) noexcept
 		{
-			auto value = std::get<floating>(_data->nodes[_index].value);
-			value.rep = rep;
-			value.precision = prec;
+			assert(d.node_count() > i);
+			const auto& l = d.links[i];
+			if (n >= l.child_count())
+				return bad_index;
+
+			if (l.contiguous_children())
+				return l.child() + n;
 
-			return to_string_visitor{ writer_options{} }(value);
+			if (const auto offsets = d.child_offsets.find(i); offsets)
+				return (*offsets)[n];
+
+			auto child = l.child();
+			for (auto c = n; c != 0; --c)
+				child = d.links[child].next();
+			return child;
 		}
-		catch (const std::bad_variant_access&)
+
+		std::optional<span<const std::int64_t>> get_packed_integers(const toml_internal_data& d, const index_t i) noexcept
 		{
-			throw wrong_type{ "This overload only works on floating point types"s };
+			return d.packed_values<std::int64_t>(i);
 		}
-	}
 
-	template<bool R>
-	std::int64_t basic_node<R>::as_integer() const
-	{
-		if (!good())
-			throw bad_node{ "Called as_integer on a bad node"s };
+		std::optional<span<const double>> get_packed_floats(const toml_internal_data& d, const index_t i) noexcept
+		{
+			return d.packed_values<double>(i);
+		}
 
-		try
+		std::optional<span<const bool>> get_packed_booleans(const toml_internal_data& d, const index_t i) noexcept
 		{
-			const auto integral = std::get<detail::integral>(_data->nodes[_index].value);
-			return integral.value;
+			return d.packed_values<bool>(i);
 		}
-		catch (const std::bad_variant_access& e)
+
+		static child_index* get_child_index(toml_internal_data& d, const index_t parent) noexcept
 		{
-			throw wrong_type{ e.what() };
+			const auto iter = d.child_indexes.find(parent);
+			if (iter == end(d.child_indexes))
+				return nullptr;
+			return &iter->second;
 		}
-	}
 
-	template<bool R>
-	double basic_node<R>::as_floating() const
-	{
-		if (!good())
-			throw bad_node{ "Called as_floating on a bad node"s };
+		static const child_index* get_child_index(const toml_internal_data& d, const index_t parent) noexcept
+		{
+			const auto iter = d.child_indexes.find(parent);
+			if (iter == end(d.child_indexes))
+				return nullptr;
+			return &iter->second;
+		}
 
-		try
+		// Tables are the only nodes whose children are looked up by name
+		constexpr bool has_named_children(const node_type t) noexcept
 		{
-			return std::get<floating>(_data->nodes[_index].value).value;
+			return t == node_type::root_table ||
+				t == node_type::table ||
+				t == node_type::inline_table;
 		}
-		catch (const std::bad_variant_access& e)
+
+		// Returns the NFC normalised name of the node at i
+		static std::string_view normalised_name(const toml_internal_data& d, const index_t i) noexcept
 		{
-			throw wrong_type{ e.what() };
+			if (d.tags[i].ascii_name)
+				return d.names[i];
+
+			const auto iter = d.nfc_names.find(i);
+			assert(iter != end(d.nfc_names));
+			return iter->second;
 		}
-	}
 
-	template<bool R>
-	bool basic_node<R>::as_boolean() const
-	{
-		if (!good())
-			throw bad_node{ "Called as_boolean on a bad node"s };
-
-		try
+		// Returns the child of parent with the already normalised name, or bad_index
+		static index_t find_child(const toml_internal_data& d, const index_t parent, const hashed_name name) noexcept
 		{
-			return std::get<bool>(_data->nodes[_index].value);
+			if (const auto index = get_child_index(d, parent); index)
+			{
+				const auto iter = index->names.find(name);
+				if (iter == end(index->names))
+					return bad_index;
+				return iter->second;
+			}
+
+			auto next = d.links[parent].child();
+			while (next != bad_index)
+			{
+				if (normalised_name(d, next) == name.name)
+					break;
+				next = d.links[next].next();
+			}
+			return next;
 		}
-		catch (const std::bad_variant_access& e)
+
+		// Returns the child of parent named s, or bad_index
+		static index_t find_child(const toml_internal_data& d, const index_t parent, const std::string_view s) noexcept
 		{
-			throw wrong_type{ e.what() };
-		}
-	}
+			// only non-ASCII names need normalising before comparison
+			if (!contains_unicode(s))
+				return find_child(d, parent, hashed_name{ s });
 
-	template<bool R>
-	date_time basic_node<R>::as_date_time() const
-	{
-		if (!good())
-			throw bad_node{ "Called as_date_time on a bad node"s };
+			auto buffer = std::array<char, nfc_name_buffer_size>{};
+			if (const auto nfc_name = to_nfc_string(s, span<char>{ data(buffer), size(buffer) }); nfc_name)
+				return find_child(d, parent, hashed_name{ *nfc_name });
 
-		try
-		{
-			return std::get<date_time>(_data->nodes[_index].value);
+			// too long for the buffer
+			if (uni::norm::is_nfc_utf8(s))
+				return find_child(d, parent, hashed_name{ s });
+
+			for (auto child = d.links[parent].child(); child != bad_index; child = d.links[child].next())
+			{
+				if (unicode_string_equal(normalised_name(d, child), s))
+					return child;
+			}
+
+			return bad_index;
 		}
-		catch (const std::bad_variant_access& e)
+
+		static index_t find_parent(const toml_internal_data& d, const index_t i) noexcept
 		{
-			throw wrong_type{ e.what() };
+			return d.links[i].parent();
 		}
 	}
 
-	template<bool R>
-	local_date_time basic_node<R>::as_date_time_local() const
-	{
-		if (!good())
-			throw bad_node{ "Called as_date_time_local on a bad node"s };
+	using namespace detail;
 
-		try 
-		{
-			return std::get<local_date_time>(_data->nodes[_index].value);
-		}
-		catch (const std::bad_variant_access& e)
+	static std::string to_string(node_type n)
+	{
+		switch (n)
 		{
-			throw wrong_type{ e.what() };
+		case node_type::array:
+			return "array"s;
+		case node_type::array_tables:
+			return "array table"s;
+		case node_type::inline_table:
+			return "inline table"s;
+		case node_type::key:
+			return "key"s;
+		case node_type::value:
+			return "value"s;
+		case node_type::table:
+			return "table"s;
+		case node_type::root_table:
+			return "root table"s;
 		}
+
+		return "error type"s;
 	}
 
+	constexpr auto root_table = index_t{};
+
+	// Defined in another_toml/string_util.cpp
+	// Replaces escape codes in place, returns false on error
+	// NoThrow errors are written to the ostream
+	template<bool NoThrow, bool SurrogatePairs = false>
+	bool replace_escape_chars(std::string&, std::ostream&);
+
+	extern template bool replace_escape_chars<true>(std::string&, std::ostream&);
+	extern template bool replace_escape_chars<false>(std::string&, std::ostream&);
+
+	// method defs for nodes
 	template<bool R>
-	date basic_node<R>::as_date_local() const
+	bool basic_node<R>::good() const noexcept
 	{
-		if (!good())
-			throw bad_node{ "Called as_date_local on a bad node"s };
-
-		try
-		{
-			return std::get<date>(_data->nodes[_index].value);
-		}
-		catch (const std::bad_variant_access& e)
-		{
-			throw wrong_type{ e.what() };
-		}
+		return _data && !(_index == bad_index ||
+			node_type::end == _data->tags[_index].type);
 	}
 
+	// test node type
 	template<bool R>
-	time basic_node<R>::as_time_local() const
+	bool basic_node<R>::table() const noexcept
 	{
 		if (!good())
-			throw bad_node{ "Called as_time_local on a bad node"s };
+			return false;
 
-		try
-		{
-			return std::get<time>(_data->nodes[_index].value);
-		}
-		catch (const std::bad_variant_access& e)
-		{
-			throw wrong_type{ e.what() };
-		}
+		const auto type = _data->tags[_index].type;
+		return type == node_type::table || type == node_type::root_table;
 	}
 
-	template class basic_node<true>;
-	template class basic_node<false>;
-
-	// helpers for adding elements to the internal data structure
-	template<bool NoThrow>
-	static index_t insert_child(detail::toml_internal_data& d, const index_t parent, detail::internal_node n);
-	template<bool NoThrow>
-	static index_t insert_child_table(const index_t parent, std::string name, detail::toml_internal_data& d, table_def_type t);
-	template<bool NoThrow>
-	static index_t insert_child_table_array(index_t parent, std::string name, detail::toml_internal_data& d);
-
-	//method defs for writer
-	writer::writer()
-		: _data{ new toml_internal_data{} }
-	{}
-
-	void writer::begin_table(std::string_view table_name, table_def_type table_type)
+	template<bool R>
+	bool basic_node<R>::array() const noexcept
 	{
-		assert(table_type < table_def_type::array);
-		auto i = _stack.back();
-		const auto t = _data->nodes[i].type;
-		assert(t == node_type::table ||
-			t == node_type::root_table ||
-			t == node_type::inline_table ||
-			t == node_type::array ||
-			t == node_type::array_tables);
-		assert(table_type == table_def_type::dotted ||
-			table_type == table_def_type::header);
-
-		auto new_table = insert_child_table<false>(i, std::string{ table_name }, *_data, table_type);
-		assert(new_table != bad_index);
-		_stack.emplace_back(new_table);
+		return good() && node_type::array == _data->tags[_index].type;
 	}
 
-	void writer::end_table() noexcept
+	template<bool R>
+	bool basic_node<R>::array_table() const noexcept
 	{
-		assert(!empty(_stack));
-		auto i = _stack.back();
-		assert(_data->nodes[i].type == node_type::table);
-		_stack.pop_back();
-		return;
+		return good() && node_type::array_tables == _data->tags[_index].type;
 	}
 
-	void writer::begin_array(std::string_view name)
+	template<bool R>
+	bool basic_node<R>::key() const noexcept
 	{
-		auto i = _stack.back();
-		const auto t = _data->nodes[i].type;
-		assert(t == node_type::table ||
-			t == node_type::root_table ||
-			t == node_type::inline_table ||
-			t == node_type::array);
-
-		auto new_arr = insert_child<false>(*_data, i, internal_node{ std::string{ name }, node_type::array });
-		assert(new_arr != bad_index);
-		_stack.emplace_back(new_arr);
-		return;
+		return good() && node_type::key == _data->tags[_index].type;
 	}
 
-	void writer::end_array() noexcept
+	template<bool R>
+	bool basic_node<R>::value() const noexcept
 	{
-		assert(!empty(_stack));
-		auto i = _stack.back();
-		assert(_data->nodes[i].type == node_type::array);
-		_stack.pop_back();
-		return;
+		return good() && node_type::value == _data->tags[_index].type;
 	}
 
-	void writer::begin_inline_table(std::string_view name)
+	template<bool R>
+	bool basic_node<R>::inline_table() const noexcept
 	{
-		auto i = _stack.back();
-		const auto t = _data->nodes[i].type;
-		assert(t == node_type::table ||
-			t == node_type::root_table ||
-			t == node_type::array ||
-			t == node_type::inline_table);
+		return good() && node_type::inline_table == _data->tags[_index].type;
+	}
 
-		auto new_table = insert_child<false>(*_data, i, internal_node{ std::string{ name }, node_type::inline_table });
-		assert(new_table != bad_index);
-		_stack.emplace_back(new_table);
-		return;
+	template<bool R>
+	value_type basic_node<R>::type() const noexcept
+	{
+		if (!good())
+			return value_type::bad;
+		return _data->tags[_index].v_type;
 	}
 
-	void writer::end_inline_table() noexcept
+	template<bool R>
+	bool basic_node<R>::has_children() const noexcept
 	{
-		assert(!empty(_stack));
-		auto i = _stack.back();
-		assert(_data->nodes[i].type == node_type::inline_table);
-		_stack.pop_back();
-		return;
+		return good() && _data->links[_index].child() != bad_index;
 	}
 
-	void writer::begin_array_table(std::string_view name)
+	template<bool R>
+	std::vector<basic_node<>> basic_node<R>::get_children() const
 	{
-		auto i = _stack.back();
-		const auto t = _data->nodes[i].type;
-		assert(t == node_type::table ||
-			t == node_type::root_table ||
-			t == node_type::array_tables);
+		if (!good())
+			throw bad_node{ "Called get_children on a bad node"s };
 
-		auto new_table = insert_child_table_array<false>(i, std::string{ name }, *_data);
-		assert(new_table != bad_index);
-		_stack.emplace_back(new_table);
+		auto out = std::vector<basic_node<>>{};
+		auto child = _data->links[_index].child();
+		while (child != bad_index)
+		{
+			if constexpr (R)
+				out.emplace_back(basic_node<>{ _data.get(), child });
+			else	
+				out.emplace_back(basic_node<>{ _data, child });
+
+			child = _data->links[child].next();
+		}
+		return out;
 	}
 
-	void writer::end_array_table() noexcept
+	template<>
+	basic_node<> basic_node<true>::get_first_child() const
 	{
-		assert(!empty(_stack));
-		auto i = _stack.back();
-		assert(_data->nodes[i].type == node_type::table);
-		_stack.pop_back();
-		return;
+		if (!good())
+			throw bad_node{ "Called get_first_child on a bad node"s };
+
+		return basic_node<>{ _data.get(), _data->links[_index].child()};
 	}
 
-	// write values on their own, for arrays
-	void writer::write_key(std::string_view name)
+	template<>
+	basic_node<> basic_node<>::get_first_child() const
 	{
-		auto i = _stack.back();
-		const auto t = _data->nodes[i].type;
-		assert(t == node_type::table ||
-			t == node_type::root_table ||
-			t == node_type::inline_table);
+		if (!good())
+			throw bad_node{ "Called get_first_child on a bad node"s };
 
-		auto new_table = insert_child<false>(*_data, i, internal_node{ std::string{ name }, node_type::key });
-		assert(new_table != bad_index);
-		_stack.emplace_back(new_table);
-		return;
+		return basic_node<>{ _data, _data->links[_index].child()};
 	}
 
-	struct string_cont
+	template<bool R>
+	std::size_t basic_node<R>::size() const noexcept
 	{
-		std::string value;
-		bool literal;
-	};
+		if (!good())
+			return {};
 
-	template<typename Value>
-	static index_t write_value_impl(index_t parent, toml_internal_data& d, value_type ty, Value v)
+		return _data->links[_index].child_count();
+	}
+
+	template<bool R>
+	basic_node<> basic_node<R>::get_child(const std::size_t n) const
 	{
-		const auto t = d.nodes[parent].type;
-		assert(t == node_type::key ||
-			t == node_type::array);
+		if (!good())
+			throw bad_node{ "Called get_child on a bad node"s };
 
-		auto new_node = bad_index;
-		if constexpr(std::is_same_v<string_cont, std::decay_t<Value>>)
-			new_node = insert_child<false>(d, parent, internal_node{ std::move(v.value), node_type::value, ty, string_t{ v.literal } });
-		else
-			new_node = insert_child<false>(d, parent, internal_node{ {}, node_type::value, ty, std::move(v) });
+		const auto child = get_child_at(*_data, _index, n);
+		if (child == bad_index)
+			throw node_not_found{ "Child index out of range"s };
 
-		assert(new_node != bad_index);
-		return new_node;
+		return basic_node<>{ &*_data, child };
 	}
-	
-	void writer::write_value(std::string&& value)
+
+	template<bool R>
+	child_range basic_node<R>::children() const noexcept
 	{
-		write_value_impl(_stack.back(), *_data, value_type::string, string_cont{ std::move(value), false });
-		if (_data->nodes[_stack.back()].type == node_type::key)
-			_stack.pop_back();
-		return;
+		if (!good())
+			return child_range{};
+
+		return child_range{ &*_data, _index };
 	}
 
-	void writer::write_value(std::string&& value, literal_string_t)
+	template<bool R>
+	bool basic_node<R>::has_sibling() const noexcept
 	{
-		write_value_impl(_stack.back(), *_data, value_type::string, string_cont{ std::move(value), true });
-		if (_data->nodes[_stack.back()].type == node_type::key)
-			_stack.pop_back();
-		return;
+		return good() && _data->links[_index].next() != bad_index;
 	}
 
-	void writer::write_value(std::string_view value)
+	template<>
+	basic_node<> basic_node<true>::get_next_sibling() const
 	{
-		write_value_impl(_stack.back(), *_data, value_type::string, string_cont{ std::string{ value }, false });
-		if (_data->nodes[_stack.back()].type == node_type::key)
-			_stack.pop_back();
-		return;
-	}
-
-	void writer::write_value(std::string_view value, literal_string_t)
-	{
-		write_value_impl(_stack.back(), *_data, value_type::string, string_cont{ std::string{ value }, true });
-		if (_data->nodes[_stack.back()].type == node_type::key)
-			_stack.pop_back();
-		return;
-	}
+		if (!good())
+			throw bad_node{ "Called get_next_sibling on a bad node"s };
 
-	void writer::write_value(std::int64_t value, int_base base)
-	{
-		write_value_impl(_stack.back(), *_data, value_type::integer, detail::integral{ value, base });
-		if(_data->nodes[_stack.back()].type == node_type::key)
-			_stack.pop_back(); 
-		return;
+		return basic_node<>{ _data.get(), _data->links[_index].next()};
 	}
 
-	void writer::write_value(double value, float_rep rep, std::int8_t precision)
+	template<>
+	basic_node<> basic_node<>::get_next_sibling() const
 	{
-		write_value_impl(_stack.back(), *_data, value_type::floating_point, detail::floating{ value, rep, precision });
-		if(_data->nodes[_stack.back()].type == node_type::key) 
-			_stack.pop_back();
-		return;
-	}
+		if (!good())
+			throw bad_node{ "Called get_next_sibling on a bad node"s };
 
-	void writer::write_value(bool value)
-	{
-		write_value_impl(_stack.back(), *_data, value_type::boolean, std::move(value));
-		if(_data->nodes[_stack.back()].type == node_type::key) 
-			_stack.pop_back();
-		return;
+		return basic_node<>{ _data, _data->links[_index].next()};
 	}
 
-	void writer::write_value(date_time value)
+	template<>
+	basic_node<> basic_node<true>::get_parent() const
 	{
-		write_value_impl(_stack.back(), *_data, value_type::date_time, std::move(value));
-		if(_data->nodes[_stack.back()].type == node_type::key) 
-			_stack.pop_back();
-		return;
-	}
+		if (!good())
+			throw bad_node{ "Called get_parent on a bad node"s };
 
-	void writer::write_value(local_date_time value)
-	{
-		write_value_impl(_stack.back(), *_data, value_type::local_date_time, std::move(value));
-		if(_data->nodes[_stack.back()].type == node_type::key) 
-			_stack.pop_back();
-		return;
+		return basic_node<>{ _data.get(), _data->links[_index].parent() };
 	}
 
-	void writer::write_value(date value)
+	template<>
+	basic_node<> basic_node<>::get_parent() const
 	{
-		write_value_impl(_stack.back(), *_data, value_type::local_date, std::move(value));
-		if(_data->nodes[_stack.back()].type == node_type::key) 
-			_stack.pop_back();
-		return;
-	}
+		if (!good())
+			throw bad_node{ "Called get_parent on a bad node"s };
 
-	void writer::write_value(time value)
-	{
-		write_value_impl(_stack.back(), *_data, value_type::local_time, std::move(value));
-		if(_data->nodes[_stack.back()].type == node_type::key) 
-			_stack.pop_back();
-		return;
+		return basic_node<>{ _data, _data->links[_index].parent() };
 	}
 
-	void writer::write(std::string_view key, double value, float_rep rep, std::int8_t precision)
+	template<bool R>
+	basic_node<> basic_node<R>::find_child(std::string_view name) const
 	{
-		write_key(key);
-		write_value(value, rep, precision);
-		return;
-	}
+		if (!good())
+			throw bad_node{ "Called find_child on a bad node"s };
 
-	std::string writer::to_string() const
-	{
-		auto sstream = std::ostringstream{};
-		sstream << *this;
-		return std::move(sstream).str();
-	}
+		if (!table() && !inline_table())
+			throw wrong_node_type{ "Cannot call find_child on this type of node"s };
+		
+		const auto child = basic_node<>{ &*_data, detail::find_child(*_data, _index, name) };
+		if (!child.good())
+			throw node_not_found{ "Failed to find child node"s };
 
-	// Returns true if a table header should be written for i
-	static bool is_headered_table(index_t i, const toml_internal_data& d) noexcept
-	{
-		auto& table = d.nodes[i];
-		auto child = table.child;
-		while (child != bad_index)
-		{
-			const auto& c_ref = d.nodes[child];
-			
-			if (node_type::value != c_ref.type)
-				return true;
+		if (child.key())
+			return child.get_first_child();
 
-			child = c_ref.next;
-		}
-		return false;
+		return child;
 	}
 
-	static std::string make_table_name(const std::vector<index_t>& nodes, const toml_internal_data& d,
-		const writer_options& o)
+	template<bool R>
+	basic_node<> basic_node<R>::find_child(std::string_view name, no_throw_t) const noexcept
 	{
-		assert(!empty(nodes));
-		if (nodes.empty())
-			return "\"\""s;
+		if (!table() && !inline_table())
+			return basic_node<>{};
 
-		auto out = std::string{};
-		auto beg = begin(nodes);
-		const auto end = std::end(nodes);
-		for (beg; beg != end; ++beg)
-		{
-			const auto& node = d.nodes[*beg];
-			if (node.type == node_type::root_table || node.table_type == table_def_type::array)
-				continue;
+		const auto child = basic_node<>{ &*_data, detail::find_child(*_data, _index, name) };
 
-			out += escape_toml_name(node.name, o.ascii_output);
-			if (next(beg) != end)
-				out.push_back('.');
-		}
+		if (child.key())
+			return child.get_first_child();
 
-		return out;
+		return child;
 	}
 
-	static std::vector<index_t> get_children(index_t i, const toml_internal_data& d)
+	template<bool R>
+	basic_node<> basic_node<R>::find_child(const node_path& path) const
 	{
-		auto children = std::vector<index_t>{};
-		auto child = d.nodes[i].child;
-		while (child != bad_index)
-		{
-			children.emplace_back(child);
-			child = d.nodes[child].next;
-		}
-		return children;
-	}
+		if (!good())
+			throw bad_node{ "Called find_child on a bad node"s };
 
-	template<typename UnaryFunction>
-	void for_each_child(index_t i, const toml_internal_data& d, UnaryFunction f) 
-		noexcept(std::is_nothrow_invocable_v<UnaryFunction, const internal_node&>)
-	{
-		auto child = d.nodes[i].child;
-		while (child != bad_index)
-		{
-			std::invoke(f, d.nodes[child]);
-			child = d.nodes[child].next;
-		}
-		return;
+		const auto child = find_child(path, no_throw);
+		if (!child.good())
+			throw node_not_found{ "Failed to find node at path"s };
+
+		return child;
 	}
 
-	template<typename Table>
-	static bool dotted_table_has_keys(const Table& i, const toml_internal_data& d)
+	template<bool R>
+	basic_node<> basic_node<R>::find_child(const node_path& path, no_throw_t) const noexcept
 	{
-		const internal_node* table = {};
-		if constexpr (std::is_same_v<Table, internal_node>)
-			table = &i;
-		else
-			table = &d.nodes[i];
-
-		assert(table->type == node_type::table &&
-			table->table_type == table_def_type::dotted);
+		if (!good())
+			return basic_node<>{};
 
-		auto child = table->child;
-		while (child != bad_index)
+		const auto& d = *_data;
+		auto i = _index;
+		for (const auto& seg : path._segments)
 		{
-			auto& child_ref = d.nodes[child];
+			const auto type = d.tags[i].type;
+			if (seg.element == bad_index)
+			{
+				if (!has_named_children(type))
+					return basic_node<>{};
 
-			if (child_ref.type == node_type::key)
-				return true;
+				i = detail::find_child(d, i, hashed_name{ seg.name, seg.hash });
+				if (i == bad_index)
+					return basic_node<>{};
 
-			if (child_ref.type == node_type::table &&
-				child_ref.table_type == table_def_type::dotted &&
-				dotted_table_has_keys(child, d))
-				return true;
+				if (d.tags[i].type == node_type::key)
+					i = d.links[i].child();
+			}
+			else
+			{
+				if (type != node_type::array && type != node_type::array_tables)
+					return basic_node<>{};
 
-			child = child_ref.next;
+				i = detail::get_child_at(d, i, seg.element);
+				if (i == bad_index)
+					return basic_node<>{};
+			}
 		}
 
-		return false;
+		return basic_node<>{ &d, i };
 	}
 
-	static bool skip_table_header(index_t table, index_t child, const toml_internal_data& d)
+	template<bool R>
+	node_iterator basic_node<R>::begin() const noexcept
 	{
-		if (child == bad_index)
-			return false;
-
-		auto tables = true;
-		const auto func = [&tables, &d](const internal_node& n) noexcept {
-			if (n.type != node_type::table &&
-				n.type != node_type::array_tables)
-				tables = false;
-
-			if(n.type == node_type::table &&
-				n.table_type == table_def_type::dotted &&
-				dotted_table_has_keys(n, d))
-				tables = false;
-
-			return;
-		};
-
-		for_each_child(table, d, func);
-		return tables;
+		const auto child = _data->links[_index].child();
+		if (child != bad_index)
+		{
+			if constexpr (R)
+				return node_iterator{ _data.get(), child};
+			else
+				return node_iterator{ _data, child };
+		}
+		else
+			return end();
 	}
 
-	using char_count_t = std::int16_t;
-	
-	static void append_line_length(char_count_t& line, const std::size_t length, const writer_options& o) noexcept
+	template<bool R>
+	node_iterator basic_node<R>::end() const noexcept
 	{
-		if (length > o.max_line_length)
-			line = o.max_line_length + 1;
-		else
-			line += static_cast<char_count_t>(length);
-
-		if (line > o.max_line_length)
-			line = o.max_line_length + 1;
-		return;
+		return node_iterator{};
 	}
 
-	static bool optional_newline(std::ostream& strm, char_count_t& last_newline, const writer_options& o)
+	struct to_string_visitor
 	{
-		if (last_newline > 0 && last_newline > o.max_line_length)
+	public:
+		const writer_options& options;
+
+		std::string operator()(std::monostate)
 		{
-			strm << '\n';
-			last_newline = {};
+			throw wrong_type{ "This node type cannot be converted to string"s };
+		}
 
-			if (o.indent_after_line_split)
+		std::string operator()(string_t)
+		{
+			throw toml_error{ "Error outputing string value"s };
+		}
+
+		std::string operator()(detail::integral i)
+		{
+			auto out = std::stringstream{};
+			using base = int_base;
+			if (options.simple_numerical_output ||
+				i.value < 0)
+				i.base = base::dec;
+
+			if (i.base == base::bin)
 			{
-				if (empty(o.indent_string))
-				{
-					strm << '\t';
-					append_line_length(last_newline, 1, o);
-				}
+				auto bin = std::bitset<64>{ *reinterpret_cast<uint64_t*>(&i.value) }.to_string();
+				auto beg = begin(bin);
+				auto end = std::end(bin);
+				while (beg != end && *beg == '0')
+					++beg;
+				const auto size = std::distance(beg, end);
+				if (size < 1)
+					out << "0b0"s;
 				else
+					out << "0b"s << std::string_view{ &*beg, static_cast<std::size_t>(size) };
+				return out.str();
+			}
+			else
+			{
+				switch (i.base)
 				{
-					strm << o.indent_string;
-					append_line_length(last_newline, size(o.indent_string), o);
+				case base::dec:
+					out << std::dec;
+					break;
+				case base::hex:
+					out << std::hex << "0x"s;
+					break;
+				case base::oct:
+					out << std::oct << "0o"s;
+					break;
 				}
+
+				out << i.value;
+				return out.str();
 			}
-			return true;
 		}
-		return false;
-	}
 
-	using indent_level_t = std::int32_t;
-
-	static void optional_indentation(std::ostream& strm, const indent_level_t indent,
-		const writer_options& o, char_count_t& last_newline_dist)
-	{
-		if (o.indent_child_tables)
+		std::string operator()(detail::floating d)
 		{
-			const auto str_size = size(o.indent_string);
+			if (std::isnan(d.value))
+				return "nan"s;
+			else if (d.value == std::numeric_limits<double>::infinity())
+				return "inf"s;
+			else if (d.value == -std::numeric_limits<double>::infinity())
+				return "-inf"s;
+
+			auto strm = std::ostringstream{};
+			if (d.rep == float_rep::scientific &&
+				!options.simple_numerical_output)
+				strm << std::scientific;
+			else if (d.rep == float_rep::fixed &&
+				!options.simple_numerical_output)
+				strm << std::fixed;
+			else // d.rep == default || simple_numerical_output enabled
+				strm << std::defaultfloat;
+
+			if (d.precision > auto_precision)
+				strm << std::setprecision(d.precision);
+	
+			strm << d.value;
+			auto str = strm.str();
+
+			if (str.find('.') == std::string::npos &&
+				str.find('e') == std::string::npos)
+				str += ".0"s;
+
+			return str;
+		}
+
+		std::string operator()(date v)
+		{
+			auto strm = std::ostringstream{};
+			strm << std::setfill('0');
+			strm << std::setw(4) << v.year;
+			strm << '-' << std::setw(2) << static_cast<uint16_t>(v.month);
+			strm << '-' << std::setw(2) << static_cast<uint16_t>(v.day);
+			return strm.str();
+		}
+
+		std::string operator()(date_time v)
+		{
+			auto out = this->operator()(v.datetime);
+			if (v.offset_hours == 0 &&
+				v.offset_minutes == 0)
+			{
+				out.push_back('Z');
+			}
+			else
+			{
+				auto strm = std::ostringstream{};
+				strm << std::setfill('0');
+				out.push_back(v.offset_positive ? '+' : '-');
+				//strm << v.offset_positive ? '+' : '-';
+				strm << std::setw(2) << static_cast<uint16_t>(v.offset_hours);
+				strm << ':' << std::setw(2) << static_cast<uint16_t>(v.offset_minutes);
+				out += strm.str();
+			}
+			return out;
+		}
+
+		std::string operator()(time v)
+		{
+			auto strm = std::ostringstream{};
+			strm << std::setfill('0');
+			strm << std::setw(2) << static_cast<uint16_t>(v.hours);
+			strm << ':' << std::setw(2) << static_cast<uint16_t>(v.minutes);
+			// TOML 1.1 optional seconds
+			strm << ':' << std::setw(2) << static_cast<uint16_t>(v.seconds);
+			if (v.seconds_frac != 0.f)
+			{
+				auto fracs = std::to_string(v.seconds_frac);
+				while (!empty(fracs) && fracs.back() == '0')
+					fracs.pop_back();
+				strm << fracs.substr(1);
+			}
+			return strm.str();
+		}
+
+		std::string operator()(local_date_time v)
+		{
+			auto out = this->operator()(v.date);
+			using sep = writer_options::date_time_separator_t;
+			switch (options.date_time_separator)
+			{
+			case sep::big_t:
+				out.push_back('T');
+				break;
+			case sep::whitespace:
+				out.push_back(' ');
+				break;
+			}
+
+			out += this->operator()(v.time);
+			return out;
+		}
+
+		std::string operator()(bool b)
+		{
+			return b ? "true"s : "false"s;
+		}
+	};
+
+	template<bool R>
+	std::string basic_node<R>::as_string() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_string on a bad node"s };
+
+		if(_data->tags[_index].v_type == value_type::string ||
+			_data->tags[_index].type != node_type::value)
+			return std::string{ _data->names[_index] };
+
+		return std::visit(to_string_visitor{ writer_options{} }, _data->value(_index));
+	}
+
+	template<bool R>
+	std::string_view basic_node<R>::as_string_view() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_string_view on a bad node"s };
+
+		if (const auto str = as_string_view(no_throw); str)
+			return *str;
+
+		throw wrong_type{ "as_string_view only works on string values and named nodes"s };
+	}
+
+	template<bool R>
+	std::optional<std::string_view> basic_node<R>::as_string_view(no_throw_t) const noexcept
+	{
+		if (!good() ||
+			(_data->tags[_index].type == node_type::value &&
+			_data->tags[_index].v_type != value_type::string))
+			return {};
+
+		return _data->names[_index];
+	}
+
+	template<bool R>
+	std::string basic_node<R>::as_string(int_base b) const
+	{
+		if (!good())
+			throw bad_node{ "Called as_string on a bad node"s };
+
+		const auto integral = std::get_if<detail::integral>(&_data->value(_index));
+		if (!integral)
+			throw wrong_type{ "This overload only works on integral types"s };
+
+		auto value = *integral;
+		value.base = b;
+		return to_string_visitor{ writer_options{} }(value);
+	}
+
+	template<bool R>
+	std::string basic_node<R>::as_string(float_rep rep, std::int8_t prec) const
+	{
+		if (!good())
+			throw bad_node{ "Called as_string on a bad node"s };
+
+		const auto floating_value = std::get_if<floating>(&_data->value(_index));
+		if (!floating_value)
+			throw wrong_type{ "This overload only works on floating point types"s };
+
+		auto value = *floating_value;
+		value.rep = rep;
+		value.precision = prec;
+		return to_string_visitor{ writer_options{} }(value);
+	}
+
+	template<bool R>
+	std::int64_t basic_node<R>::as_integer() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_integer on a bad node"s };
+
+		if (const auto value = as_integer(no_throw); value)
+			return *value;
+
+		throw wrong_type{ "Called as_integer on a node that isn't an integer value"s };
+	}
+
+	template<bool R>
+	double basic_node<R>::as_floating() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_floating on a bad node"s };
+
+		if (const auto value = as_floating(no_throw); value)
+			return *value;
+
+		throw wrong_type{ "Called as_floating on a node that isn't a floating point value"s };
+	}
+
+	template<bool R>
+	bool basic_node<R>::as_boolean() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_boolean on a bad node"s };
+
+		if (const auto value = as_boolean(no_throw); value)
+			return *value;
+
+		throw wrong_type{ "Called as_boolean on a node that isn't a boolean value"s };
+	}
+
+	template<bool R>
+	date_time basic_node<R>::as_date_time() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_date_time on a bad node"s };
+
+		if (const auto value = as_date_time(no_throw); value)
+			return *value;
+
+		throw wrong_type{ "Called as_date_time on a node that isn't a date_time value"s };
+	}
+
+	template<bool R>
+	local_date_time basic_node<R>::as_date_time_local() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_date_time_local on a bad node"s };
+
+		if (const auto value = as_date_time_local(no_throw); value)
+			return *value;
+
+		throw wrong_type{ "Called as_date_time_local on a node that isn't a local_date_time value"s };
+	}
+
+	template<bool R>
+	date basic_node<R>::as_date_local() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_date_local on a bad node"s };
+
+		if (const auto value = as_date_local(no_throw); value)
+			return *value;
+
+		throw wrong_type{ "Called as_date_local on a node that isn't a local date value"s };
+	}
+
+	template<bool R>
+	time basic_node<R>::as_time_local() const
+	{
+		if (!good())
+			throw bad_node{ "Called as_time_local on a bad node"s };
+
+		if (const auto value = as_time_local(no_throw); value)
+			return *value;
+
+		throw wrong_type{ "Called as_time_local on a node that isn't a local time value"s };
+	}
+
+	template<bool R>
+	std::optional<std::int64_t> basic_node<R>::as_integer(no_throw_t) const noexcept
+	{
+		if (!good())
+			return {};
+
+		if (const auto value = std::get_if<detail::integral>(&_data->value(_index)); value)
+			return value->value;
+
+		return {};
+	}
+
+	template<bool R>
+	std::optional<double> basic_node<R>::as_floating(no_throw_t) const noexcept
+	{
+		if (!good())
+			return {};
+
+		if (const auto value = std::get_if<floating>(&_data->value(_index)); value)
+			return value->value;
+
+		return {};
+	}
+
+	template<bool R>
+	std::optional<bool> basic_node<R>::as_boolean(no_throw_t) const noexcept
+	{
+		if (!good())
+			return {};
+
+		if (const auto value = std::get_if<bool>(&_data->value(_index)); value)
+			return *value;
+
+		return {};
+	}
+
+	template<bool R>
+	std::optional<date_time> basic_node<R>::as_date_time(no_throw_t) const noexcept
+	{
+		if (!good())
+			return {};
+
+		if (const auto value = std::get_if<date_time>(&_data->value(_index)); value)
+			return *value;
+
+		return {};
+	}
+
+	template<bool R>
+	std::optional<local_date_time> basic_node<R>::as_date_time_local(no_throw_t) const noexcept
+	{
+		if (!good())
+			return {};
+
+		if (const auto value = std::get_if<local_date_time>(&_data->value(_index)); value)
+			return *value;
+
+		return {};
+	}
+
+	template<bool R>
+	std::optional<date> basic_node<R>::as_date_local(no_throw_t) const noexcept
+	{
+		if (!good())
+			return {};
+
+		if (const auto value = std::get_if<date>(&_data->value(_index)); value)
+			return *value;
+
+		return {};
+	}
+
+	template<bool R>
+	std::optional<time> basic_node<R>::as_time_local(no_throw_t) const noexcept
+	{
+		if (!good())
+			return {};
+
+		if (const auto value = std::get_if<time>(&_data->value(_index)); value)
+			return *value;
+
+		return {};
+	}
+
+	node_path::node_path(std::string_view path)
+	{
+		auto pos = std::size_t{};
+		const auto skip_whitespace = [&]() noexcept {
+			while (pos < path.size() && (path[pos] == ' ' || path[pos] == '\t'))
+				++pos;
+		};
+
+		const auto error = [&](std::string_view msg) {
+			return parsing_error{ "Error parsing node_path \""s + std::string{ path } +
+				"\": "s + std::string{ msg } + " at column "s + std::to_string(pos + 1) };
+		};
+
+		// [n]
+		const auto parse_element = [&]() {
+			assert(path[pos] == '[');
+			++pos;
+			skip_whitespace();
+			auto element = index_t{};
+			const auto [ptr, ec] = std::from_chars(path.data() + pos, path.data() + path.size(), element);
+			// bad_index marks key segments, so it can't be used as an index
+			if (ec == std::errc::result_out_of_range || (ec == std::errc{} && element == bad_index))
+				throw error("array index out of range"sv);
+			if (ec != std::errc{})
+				throw error("expected array index"sv);
+			pos = static_cast<std::size_t>(ptr - path.data());
+			skip_whitespace();
+			if (pos == path.size() || path[pos] != ']')
+				throw error("expected ']'"sv);
+			++pos;
+			_segments.push_back(segment{ {}, {}, element });
+			return;
+		};
+
+		const auto parse_key = [&]() {
+			auto name = std::string{};
+			if (const auto quote = path[pos]; quote == '"' || quote == '\'')
+			{
+				auto last = pos + 1;
+				while (last < path.size() && path[last] != quote)
+				{
+					// skip escaped chars in basic strings
+					if (quote == '"' && path[last] == '\\')
+						++last;
+					++last;
+				}
+
+				if (last >= path.size())
+					throw error("missing closing quote"sv);
+
+				name = path.substr(pos + 1, last - pos - 1);
+				if (quote == '"')
+				{
+					auto escape_errors = std::ostringstream{};
+					if (!replace_escape_chars<true>(name, escape_errors))
+						throw error("invalid escape code"sv);
+				}
+				pos = last + 1;
+			}
+			else
+			{
+				const auto first = pos;
+				while (pos < path.size() && ((path[pos] >= 'a' && path[pos] <= 'z') ||
+					(path[pos] >= 'A' && path[pos] <= 'Z') || (path[pos] >= '0' && path[pos] <= '9') ||
+					path[pos] == '_' || path[pos] == '-'))
+					++pos;
+
+				if (pos == first)
+					throw error("expected key name"sv);
+				name = path.substr(first, pos - first);
+			}
+
+			if (contains_unicode(name))
+				name = to_nfc_string(name);
+
+			const auto hash = hashed_name{ name }.hash;
+			_segments.push_back(segment{ std::move(name), hash, bad_index });
+			return;
+		};
+
+		skip_whitespace();
+		if (pos == path.size())
+			throw error("path is empty"sv);
+
+		while (true)
+		{
+			skip_whitespace();
+			if (pos == path.size())
+				throw error("expected key name"sv);
+
+			if (path[pos] == '[')
+				parse_element();
+			else
+				parse_key();
+
+			skip_whitespace();
+			while (pos < path.size() && path[pos] == '[')
+			{
+				parse_element();
+				skip_whitespace();
+			}
+
+			if (pos == path.size())
+				break;
+
+			if (path[pos] != '.')
+				throw error("expected '.' or '['"sv);
+			++pos;
+		}
+
+		return;
+	}
+
+	template class basic_node<true>;
+	template class basic_node<false>;
+
+	struct parser_state;
+
+	// Returns the stream that no_throw parses write errors to (std::cerr by default).
+	// The first call records the error's kind and position for parser_options::diagnostics,
+	// later calls add details to the same error.
+	static std::ostream& report_error(parser_state& strm, parse_error_kind kind = parse_error_kind::parsing_error);
+
+	// helpers for adding elements to the internal data structure
+	// NoThrow errors are written to strm, which must be set when NoThrow is true
+	template<bool NoThrow>
+	static index_t insert_child(detail::toml_internal_data& d, const index_t parent, detail::internal_node n,
+		parser_state* strm = nullptr);
+	template<bool NoThrow>
+	static index_t insert_child_table(const index_t parent, std::string_view name, detail::toml_internal_data& d, table_def_type t,
+		parser_state* strm = nullptr);
+	template<bool NoThrow>
+	static index_t insert_child_table_array(index_t parent, std::string_view name, detail::toml_internal_data& d,
+		parser_state* strm = nullptr);
+
+	//method defs for writer
+	writer::writer()
+		: _data{ new toml_internal_data{} }
+	{}
+
+	void writer::begin_table(std::string_view table_name, table_def_type table_type)
+	{
+		assert(table_type < table_def_type::array);
+		auto i = _stack.back();
+		const auto t = _data->tags[i].type;
+		assert(t == node_type::table ||
+			t == node_type::root_table ||
+			t == node_type::inline_table ||
+			t == node_type::array ||
+			t == node_type::array_tables);
+		assert(table_type == table_def_type::dotted ||
+			table_type == table_def_type::header);
+
+		auto new_table = insert_child_table<false>(i, std::string{ table_name }, *_data, table_type);
+		assert(new_table != bad_index);
+		_stack.emplace_back(new_table);
+	}
+
+	void writer::end_table() noexcept
+	{
+		assert(!empty(_stack));
+		auto i = _stack.back();
+		assert(_data->tags[i].type == node_type::table);
+		_stack.pop_back();
+		return;
+	}
+
+	void writer::begin_array(std::string_view name)
+	{
+		auto i = _stack.back();
+		const auto t = _data->tags[i].type;
+		assert(t == node_type::table ||
+			t == node_type::root_table ||
+			t == node_type::inline_table ||
+			t == node_type::array);
+
+		auto new_arr = insert_child<false>(*_data, i, internal_node{ std::string{ name }, node_type::array });
+		assert(new_arr != bad_index);
+		_stack.emplace_back(new_arr);
+		return;
+	}
+
+	void writer::end_array() noexcept
+	{
+		assert(!empty(_stack));
+		auto i = _stack.back();
+		assert(_data->tags[i].type == node_type::array);
+		_stack.pop_back();
+		return;
+	}
+
+	void writer::begin_inline_table(std::string_view name)
+	{
+		auto i = _stack.back();
+		const auto t = _data->tags[i].type;
+		assert(t == node_type::table ||
+			t == node_type::root_table ||
+			t == node_type::array ||
+			t == node_type::inline_table);
+
+		auto new_table = insert_child<false>(*_data, i, internal_node{ std::string{ name }, node_type::inline_table });
+		assert(new_table != bad_index);
+		_stack.emplace_back(new_table);
+		return;
+	}
+
+	void writer::end_inline_table() noexcept
+	{
+		assert(!empty(_stack));
+		auto i = _stack.back();
+		assert(_data->tags[i].type == node_type::inline_table);
+		_stack.pop_back();
+		return;
+	}
+
+	void writer::begin_array_table(std::string_view name)
+	{
+		auto i = _stack.back();
+		const auto t = _data->tags[i].type;
+		assert(t == node_type::table ||
+			t == node_type::root_table ||
+			t == node_type::array_tables);
+
+		auto new_table = insert_child_table_array<false>(i, std::string{ name }, *_data);
+		assert(new_table != bad_index);
+		_stack.emplace_back(new_table);
+	}
+
+	void writer::end_array_table() noexcept
+	{
+		assert(!empty(_stack));
+		auto i = _stack.back();
+		assert(_data->tags[i].type == node_type::table);
+		_stack.pop_back();
+		return;
+	}
+
+	// write values on their own, for arrays
+	void writer::write_key(std::string_view name)
+	{
+		auto i = _stack.back();
+		const auto t = _data->tags[i].type;
+		assert(t == node_type::table ||
+			t == node_type::root_table ||
+			t == node_type::inline_table);
+
+		auto new_table = insert_child<false>(*_data, i, internal_node{ std::string{ name }, node_type::key });
+		assert(new_table != bad_index);
+		_stack.emplace_back(new_table);
+		return;
+	}
+
+	struct string_cont
+	{
+		std::string value;
+		bool literal;
+	};
+
+	template<typename Value>
+	static index_t write_value_impl(index_t parent, toml_internal_data& d, value_type ty, Value v)
+	{
+		const auto t = d.tags[parent].type;
+		assert(t == node_type::key ||
+			t == node_type::array);
+
+		auto new_node = bad_index;
+		if constexpr(std::is_same_v<string_cont, std::decay_t<Value>>)
+			new_node = insert_child<false>(d, parent, internal_node{ std::move(v.value), node_type::value, ty, string_t{ v.literal } });
+		else
+			new_node = insert_child<false>(d, parent, internal_node{ {}, node_type::value, ty, std::move(v) });
+
+		assert(new_node != bad_index);
+		return new_node;
+	}
+	
+	void writer::write_value(std::string&& value)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::string, string_cont{ std::move(value), false });
+		if (_data->tags[_stack.back()].type == node_type::key)
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(std::string&& value, literal_string_t)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::string, string_cont{ std::move(value), true });
+		if (_data->tags[_stack.back()].type == node_type::key)
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(std::string_view value)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::string, string_cont{ std::string{ value }, false });
+		if (_data->tags[_stack.back()].type == node_type::key)
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(std::string_view value, literal_string_t)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::string, string_cont{ std::string{ value }, true });
+		if (_data->tags[_stack.back()].type == node_type::key)
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(std::int64_t value, int_base base)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::integer, detail::integral{ value, base });
+		if(_data->tags[_stack.back()].type == node_type::key)
+			_stack.pop_back(); 
+		return;
+	}
+
+	void writer::write_value(double value, float_rep rep, std::int8_t precision)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::floating_point, detail::floating{ value, rep, precision });
+		if(_data->tags[_stack.back()].type == node_type::key) 
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(bool value)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::boolean, std::move(value));
+		if(_data->tags[_stack.back()].type == node_type::key) 
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(date_time value)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::date_time, std::move(value));
+		if(_data->tags[_stack.back()].type == node_type::key) 
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(local_date_time value)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::local_date_time, std::move(value));
+		if(_data->tags[_stack.back()].type == node_type::key) 
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(date value)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::local_date, std::move(value));
+		if(_data->tags[_stack.back()].type == node_type::key) 
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write_value(time value)
+	{
+		write_value_impl(_stack.back(), *_data, value_type::local_time, std::move(value));
+		if(_data->tags[_stack.back()].type == node_type::key) 
+			_stack.pop_back();
+		return;
+	}
+
+	void writer::write(std::string_view key, double value, float_rep rep, std::int8_t precision)
+	{
+		write_key(key);
+		write_value(value, rep, precision);
+		return;
+	}
+
+	std::string writer::to_string() const
+	{
+		auto sstream = std::ostringstream{};
+		sstream << *this;
+		return std::move(sstream).str();
+	}
+
+	// Returns true if a table header should be written for i
+	static bool is_headered_table(index_t i, const toml_internal_data& d) noexcept
+	{
+		auto child = d.links[i].child();
+		while (child != bad_index)
+		{
+			if (node_type::value != d.tags[child].type)
+				return true;
+
+			child = d.links[child].next();
+		}
+		return false;
+	}
+
+	static std::string make_table_name(const std::vector<index_t>& nodes, const toml_internal_data& d,
+		const writer_options& o)
+	{
+		assert(!empty(nodes));
+		if (nodes.empty())
+			return "\"\""s;
+
+		auto out = std::string{};
+		auto beg = begin(nodes);
+		const auto end = std::end(nodes);
+		for (beg; beg != end; ++beg)
+		{
+			const auto& tags = d.tags[*beg];
+			if (tags.type == node_type::root_table || tags.table_type == table_def_type::array)
+				continue;
+
+			out += escape_toml_name(d.names[*beg], o.ascii_output);
+			if (next(beg) != end)
+				out.push_back('.');
+		}
+
+		return out;
+	}
+
+	static std::vector<index_t> get_children(index_t i, const toml_internal_data& d)
+	{
+		auto children = std::vector<index_t>{};
+		auto child = d.links[i].child();
+		while (child != bad_index)
+		{
+			children.emplace_back(child);
+			child = d.links[child].next();
+		}
+		return children;
+	}
+
+	template<typename UnaryFunction>
+	void for_each_child(index_t i, const toml_internal_data& d, UnaryFunction f) 
+		noexcept(std::is_nothrow_invocable_v<UnaryFunction, index_t>)
+	{
+		auto child = d.links[i].child();
+		while (child != bad_index)
+		{
+			std::invoke(f, child);
+			child = d.links[child].next();
+		}
+		return;
+	}
+
+	static bool dotted_table_has_keys(const index_t table, const toml_internal_data& d)
+	{
+		assert(d.tags[table].type == node_type::table &&
+			d.tags[table].table_type == table_def_type::dotted);
+
+		auto child = d.links[table].child();
+		while (child != bad_index)
+		{
+			const auto& child_tags = d.tags[child];
+
+			if (child_tags.type == node_type::key)
+				return true;
+
+			if (child_tags.type == node_type::table &&
+				child_tags.table_type == table_def_type::dotted &&
+				dotted_table_has_keys(child, d))
+				return true;
+
+			child = d.links[child].next();
+		}
+
+		return false;
+	}
+
+	static bool skip_table_header(index_t table, index_t child, const toml_internal_data& d)
+	{
+		if (child == bad_index)
+			return false;
+
+		auto tables = true;
+		const auto func = [&tables, &d](const index_t n) noexcept {
+			const auto& n_tags = d.tags[n];
+			if (n_tags.type != node_type::table &&
+				n_tags.type != node_type::array_tables)
+				tables = false;
+
+			if(n_tags.type == node_type::table &&
+				n_tags.table_type == table_def_type::dotted &&
+				dotted_table_has_keys(n, d))
+				tables = false;
+
+			return;
+		};
+
+		for_each_child(table, d, func);
+		return tables;
+	}
+
+	using char_count_t = std::int16_t;
+	
+	static void append_line_length(char_count_t& line, const std::size_t length, const writer_options& o) noexcept
+	{
+		if (length > o.max_line_length)
+			line = o.max_line_length + 1;
+		else
+			line += static_cast<char_count_t>(length);
+
+		if (line > o.max_line_length)
+			line = o.max_line_length + 1;
+		return;
+	}
+
+	static bool optional_newline(std::ostream& strm, char_count_t& last_newline, const writer_options& o)
+	{
+		if (last_newline > 0 && last_newline > o.max_line_length)
+		{
+			strm << '\n';
+			last_newline = {};
+
+			if (o.indent_after_line_split)
+			{
+				if (empty(o.indent_string))
+				{
+					strm << '\t';
+					append_line_length(last_newline, 1, o);
+				}
+				else
+				{
+					strm << o.indent_string;
+					append_line_length(last_newline, size(o.indent_string), o);
+				}
+			}
+			return true;
+		}
+		return false;
+	}
+
+	using indent_level_t = std::int32_t;
+
+	static void optional_indentation(std::ostream& strm, const indent_level_t indent,
+		const writer_options& o, char_count_t& last_newline_dist)
+	{
+		if (o.indent_child_tables)
+		{
+			const auto str_size = size(o.indent_string);
 			for (auto i = indent_level_t{}; i < indent; ++i)
 			{
 				strm << o.indent_string;
@@ -1285,15 +2304,15 @@ namespace another_toml
 	{
 		assert(!empty(stack));
 		const auto parent = stack.back();
-		const auto parent_type = d.nodes[parent].type;
+		const auto parent_type = d.tags[parent].type;
 
 		auto children = get_children(parent, d);
 
 		// make sure we write out keys and dotted tables before
 		// tables and table arrays
 		std::stable_sort(begin(children), end(children), [&d](auto&& l, auto&& r) {
-			const auto& left = d.nodes[l];
-			const auto& right = d.nodes[r];
+			const auto& left = d.tags[l];
+			const auto& right = d.tags[r];
 			const auto left_type = sort_value(left.type);
 			const auto right_type = sort_value(right.type);
 			return std::tie(left_type, left.table_type) <
@@ -1304,8 +2323,8 @@ namespace another_toml
 		const auto end = std::end(children);
 		for (beg; beg != end; ++beg)
 		{
-			const auto& c_ref = d.nodes[*beg];
-			switch (c_ref.type)
+			const auto& c_tags = d.tags[*beg];
+			switch (c_tags.type)
 			{
 			case node_type::root_table:
 				[[fallthrough]];
@@ -1321,12 +2340,12 @@ namespace another_toml
 				auto indent = indent_level;
 				
 				if (parent_type != node_type::array_tables && 
-					(is_headered_table(*beg, d) || c_ref.child == bad_index))
+					(is_headered_table(*beg, d) || d.links[*beg].child() == bad_index))
 				{
 					// skip if all their children are also tables
 					// skip writing empty tables unless they are leafs
-					if((o.skip_empty_tables && skip_table_header(*beg, c_ref.child, d)) ||
-						c_ref.table_type == table_def_type::dotted)
+					if((o.skip_empty_tables && skip_table_header(*beg, d.links[*beg].child(), d)) ||
+						c_tags.table_type == table_def_type::dotted)
 					{
 						write_children<false>(strm, d, o, name_stack, last_newline_dist, indent_level);
 						break;
@@ -1360,7 +2379,7 @@ namespace another_toml
 				{
 					optional_indentation(strm, indent_level, o, last_newline_dist);
 
-					strm << escape_toml_name(c_ref.name, o.ascii_output);
+					strm << escape_toml_name(d.names[*beg], o.ascii_output);
 					if (o.compact_spacing)
 					{
 						strm << '=';
@@ -1449,33 +2468,32 @@ namespace another_toml
 				optional_indentation(strm, indent_level, o, last_newline_dist);
 
 				// get dotted tables that contribute to this key name
-				auto dotted_tables = std::vector<const std::string*>{};
+				auto dotted_tables = std::vector<std::string_view>{};
 				{
 					const auto end = rend(stack);
 					auto iter = rbegin(stack);
 					for (iter; iter != end; ++iter)
 					{
-						const auto &ref = d.nodes[*iter];
+						const auto &ref = d.tags[*iter];
 						if (ref.type != node_type::table ||
 							ref.table_type != table_def_type::dotted)
 							break;
 
-						dotted_tables.emplace_back(&ref.name);
+						dotted_tables.emplace_back(d.names[*iter]);
 					}
 				}
 
 				// start the name with any dotted table names
 				auto key_name = std::string{};
-				std::for_each(rbegin(dotted_tables), rend(dotted_tables), [&key_name, &o](auto str_ptr) {
-					assert(str_ptr);
-					const auto escaped_name = escape_toml_name(*str_ptr, o.ascii_output);
+				std::for_each(rbegin(dotted_tables), rend(dotted_tables), [&key_name, &o](auto table_name) {
+					const auto escaped_name = escape_toml_name(table_name, o.ascii_output);
 					key_name += escaped_name;
 					key_name.push_back('.');
 					return;
 					});
 
 				// finaly
-				key_name += escape_toml_name(c_ref.name, o.ascii_output);
+				key_name += escape_toml_name(d.names[*beg], o.ascii_output);
 				append_line_length(last_newline_dist, size(key_name), o);
 				strm << key_name;
 				if (!o.compact_spacing)
@@ -1535,7 +2553,7 @@ namespace another_toml
 				{
 					optional_indentation(strm, indent_level, o, last_newline_dist);
 
-					const auto table_name = escape_toml_name(c_ref.name, o.ascii_output);
+					const auto table_name = escape_toml_name(d.names[*beg], o.ascii_output);
 					append_line_length(last_newline_dist, size(table_name), o);
 					strm << table_name;
 					if (!o.compact_spacing)
@@ -1599,16 +2617,16 @@ namespace another_toml
 			} break;
 			case node_type::value:
 			{
-				if (c_ref.v_type == value_type::string)
+				if (c_tags.v_type == value_type::string)
 				{
-					const auto& string_extra = std::get<string_t>(c_ref.value);
-					write_out_string(strm, string_extra, c_ref.name, o, last_newline_dist, indent_level);
+					const auto& string_extra = std::get<string_t>(d.value(*beg));
+					write_out_string(strm, string_extra, d.names[*beg], o, last_newline_dist, indent_level);
 				}
-				else if (c_ref.v_type == value_type::bad)
+				else if (c_tags.v_type == value_type::bad)
 					throw toml_error{ "Value node with bad data, unable to output"s };
 				else
 				{
-					const auto str = std::visit(to_string_visitor{ o }, c_ref.value);
+					const auto str = std::visit(to_string_visitor{ o }, d.value(*beg));
 					strm << str;
 					append_line_length(last_newline_dist, size(str), o);
 				}
@@ -1654,94 +2672,200 @@ namespace another_toml
 		return;
 	}
 
-	std::ostream& operator<<(std::ostream& o, const writer& w)
+	std::ostream& operator<<(std::ostream& o, const writer& w)
+	{
+		//write the byte order mark
+		if (w._opts.utf8_bom)
+		{
+			for (const auto ch : utf8_bom)
+				o.put(static_cast<char>(ch));
+		}
+
+		auto last_newline = char_count_t{ -1 };
+		write_children<false>(o, *w._data, w._opts, { 0 }, last_newline, -1);
+
+		return o;
+	}
+
+	static void insert_bad(detail::toml_internal_data& d)
+	{
+		d.push_node(internal_node{ {}, node_type::end });
+		return;
+	}
+
+	// Builds a child_index for parent from its current children
+	static void make_child_index(detail::toml_internal_data& d, const index_t parent)
+	{
+		assert(has_named_children(d.tags[parent].type));
+		auto& index = d.child_indexes[parent];
+		auto child = d.links[parent].child();
+		while (child != bad_index)
+		{
+			index.names.try_emplace(normalised_name(d, child), child);
+			child = d.links[child].next();
+		}
+		return;
+	}
+
+	// Adds array i to packable_arrays if its elements are all integers,
+	// all floats or all booleans, so that basic_node::as_span can view them.
+	// The elements must be contiguous.
+	static void find_packable_array(detail::toml_internal_data& d, const index_t i)
 	{
-		//write the byte order mark
-		if (w._opts.utf8_bom)
+		const auto& l = d.links[i];
+		const auto first = l.child();
+		const auto last = l.last_child() + 1;
+		const auto v_type = d.tags[first].v_type;
+		if (v_type != value_type::integer && v_type != value_type::floating_point &&
+			v_type != value_type::boolean)
+			return;
+
+		for (auto child = first; child != last; ++child)
 		{
-			for (const auto ch : utf8_bom)
-				o.put(static_cast<char>(ch));
+			if (d.tags[child].type != node_type::value || d.tags[child].v_type != v_type)
+				return;
 		}
 
-		auto last_newline = char_count_t{ -1 };
-		write_children<false>(o, *w._data, w._opts, { 0 }, last_newline, -1);
+		d.packable_arrays.push_back(packable_array{ i, v_type });
+		return;
+	}
 
-		return o;
+	// Called once the document is complete.
+	// Stores the children of arrays and tables whose children aren't contiguous in child_offsets,
+	// so that get_child_at doesn't have to walk them, and tracks the arrays that as_span
+	// can view and the unconverted lazy values.
+	static void finish_document(detail::toml_internal_data& d)
+	{
+		d.track_lazy_values();
+		for (auto i = index_t{}; i < d.node_count(); ++i)
+		{
+			const auto type = d.tags[i].type;
+			const auto& l = d.links[i];
+			// keys only have their value as a child
+			if (type == node_type::key || l.child_count() == 0)
+				continue;
+
+			if (l.contiguous_children())
+			{
+				if (type == node_type::array)
+					find_packable_array(d, i);
+				continue;
+			}
+
+			if (l.child_count() < child_offsets_threshold)
+				continue;
+
+			auto& offsets = d.child_offsets;
+			offsets.begin_array(i);
+			offsets.reserve_more(l.child_count());
+			for (auto child = l.child(); child != bad_index; child = d.links[child].next())
+				offsets.push_back(static_cast<link_t>(child));
+			assert(offsets.find(i)->size() == l.child_count());
+		}
+
+		d.track_packable_arrays();
+		return;
 	}
 
-	static void insert_bad(detail::toml_internal_data& d)
+	// Adds child to the end of parent's children
+	static void link_last_child(detail::toml_internal_data& d, const index_t parent, const index_t child) noexcept
 	{
-		d.nodes.emplace_back(internal_node{ {}, node_type::end });
+		d.links[child].set_parent(parent);
+		auto& parent_links = d.links[parent];
+		if (const auto last_child = parent_links.last_child();
+			last_child == bad_index)
+			parent_links.set_child(child);
+		else
+			d.links[last_child].set_next(child);
+		parent_links.set_last_child(child);
+		parent_links.set_child_count(parent_links.child_count() + 1);
 		return;
 	}
 
 	template<bool NoThrow>
-	index_t insert_child(detail::toml_internal_data& d, const index_t parent, detail::internal_node n)
+	index_t insert_child(detail::toml_internal_data& d, const index_t parent, detail::internal_node n,
+		parser_state* strm)
 	{
 		assert(parent != bad_index);
-		const auto new_index = size(d.nodes);
-		auto& p = d.nodes[parent];
-		auto allow_duplicates = p.type == node_type::array || p.type == node_type::array_tables;
-		if (p.child != bad_index)
-		{
-			auto child = p.child;
-			while (true)
-			{
-				auto& child_ref = d.nodes[child];
-				if (unicode_string_equal(child_ref.name, n.name) && !allow_duplicates)
-				{
-					if (child_ref.type == node_type::table && 
-						n.type == node_type::table &&
-						!child_ref.closed &&
-						p.table_type == n.table_type)
-						return child;
-
-					// TODO: invalid/inline-table/overwrite-01
-					// This error isnt rendered correctly 
-					// TODO: invalid/inline-table/overwrite-10 invalid/key/duplicate-keys-1 invalid/key/duplicate-keys-3 invalid/spec/inline-table-3-0
-					// Error carrot is in the wrong location for keys and table names that start with space
-					const auto msg = "Tried to insert duplicate element: "s + n.name +
-						", into: "s + (parent == 0 ? "root table"s : p.name) + ".\n"s;
+		const auto new_index = d.node_count();
+		const auto& p = d.tags[parent];
+		const auto allow_duplicates = !has_named_children(p.type);
 
-					if constexpr (NoThrow)
-					{
-						std::cerr << msg;
-						return bad_index;
-					}
-					else
-						throw duplicate_element{ msg, {}, {}, n.name };
-				}
+		// normalise the name once, so that siblings can be compared bytewise
+		auto nfc_name = std::string{};
+		if (!allow_duplicates && contains_unicode(n.name))
+		{
+			n.ascii_name = false;
+			nfc_name = to_nfc_string(n.name);
+		}
+		const auto name = n.ascii_name ? std::string_view{ n.name } : std::string_view{ nfc_name };
 
-				if (child_ref.next == bad_index)
-					break;
+		// returns the node to use in place of a duplicate, or bad_index on error
+		const auto duplicate_child = [&](const index_t child)->index_t {
+			const auto& child_ref = d.tags[child];
+			if (child_ref.type == node_type::table &&
+				n.type == node_type::table &&
+				!child_ref.closed &&
+				p.table_type == n.table_type)
+				return child;
+
+			// TODO: invalid/inline-table/overwrite-01
+			// This error isnt rendered correctly 
+			// TODO: invalid/inline-table/overwrite-10 invalid/key/duplicate-keys-1 invalid/key/duplicate-keys-3 invalid/spec/inline-table-3-0
+			// Error carrot is in the wrong location for keys and table names that start with space
+			const auto msg = "Tried to insert duplicate element: "s + std::string{ n.name } +
+				", into: "s + (parent == 0 ? "root table"s : std::string{ d.names[parent] }) + ".\n"s;
 
-				child = child_ref.next;
+			if constexpr (NoThrow)
+			{
+				assert(strm);
+				report_error(*strm, parse_error_kind::duplicate_element) << msg;
+				return bad_index;
 			}
+			else
+				throw duplicate_element{ msg, {}, {}, std::string{ n.name } };
+		};
 
-			d.nodes[child].next = new_index;
+		// check for duplicate names, arrays can be appended to immediately
+		auto index = allow_duplicates ? nullptr : get_child_index(d, parent);
+		if (index)
+		{
+			if (const auto iter = index->names.find(name);
+				iter != end(index->names))
+				return duplicate_child(iter->second);
 		}
-		else
-			p.child = new_index;
-
-		d.nodes.emplace_back(std::move(n));
-		return new_index;
-	}
+		else if (!allow_duplicates)
+		{
+			auto child = d.links[parent].child();
+			while (child != bad_index)
+			{
+				if (normalised_name(d, child) == name)
+					return duplicate_child(child);
 
-	static index_t find_child(const detail::toml_internal_data& d, const index_t parent, const std::string_view s) noexcept
-	{
-		auto& p = d.nodes[parent];
-		if (p.child == bad_index)
-			return bad_index;
+				child = d.links[child].next();
+			}
+		}
 
-		auto next = p.child;
-		while (next != bad_index)
+		// move the names into storage owned by d, unless they're borrowed from the input
+		if (!d.is_borrowed(n.name))
+			n.name = d.strings.store(n.name);
+		auto stored_name = n.name;
+		if (!n.ascii_name)
 		{
-			auto c = &d.nodes[next];
-			if (unicode_string_equal(c->name, s))
-				break;
-			next = c->next;
+			stored_name = d.strings.store(nfc_name);
+			d.nfc_names.emplace(new_index, stored_name);
 		}
-		return next;
+
+		d.push_node(std::move(n));
+		link_last_child(d, parent, new_index);
+
+		if (index)
+			index->names.emplace(stored_name, new_index);
+		// parent has become large enough to benefit from an index
+		else if (!allow_duplicates && d.links[parent].child_count() >= child_index_threshold)
+			make_child_index(d, parent);
+
+		return new_index;
 	}
 
 	enum class token_type
@@ -1763,15 +2887,457 @@ namespace another_toml
 	{
 		index_t parent;
 		std::optional<std::string> name;
+		// name as it appears in the input buffer, only set when borrowing the input
+		std::string_view input_name = {};
+
+		std::string_view view() const noexcept
+		{
+			return data(input_name) ? input_name : std::string_view{ *name };
+		}
+	};
+
+	// Characters that the string and comment loops need to examine one at a time:
+	// control characters, DEL, invalid UTF-8 and any of Chars.
+	// Every other character is copied unchanged, so runs of them can be consumed at once.
+	template<char... Chars>
+	constexpr bool is_special_char(const char ch) noexcept
+	{
+		const auto uch = static_cast<unsigned char>(ch);
+		return uch < 0x20 || uch == 0x7F || ((ch == Chars) || ...);
+	}
+
+	// Returns the length of the UTF-8 encoded code point at the start of str,
+	// or 0 if it isn't valid UTF-8. Overlong encodings and surrogates aren't valid.
+	static std::size_t utf8_sequence_length(const std::string_view str) noexcept
+	{
+		const auto byte = [str](const std::size_t i) noexcept {
+			return static_cast<unsigned char>(str[i]);
+		};
+
+		const auto lead = byte(0);
+		auto length = std::size_t{};
+		// the allowed range of the second byte depends on the lead byte
+		auto second_min = 0x80, second_max = 0xBF;
+		if (lead < 0x80)
+			return 1;
+		else if (lead < 0xC2)
+			return 0;
+		else if (lead < 0xE0)
+			length = 2;
+		else if (lead < 0xF0)
+		{
+			length = 3;
+			if (lead == 0xE0)
+				second_min = 0xA0;
+			else if (lead == 0xED)
+				second_max = 0x9F;
+		}
+		else if (lead < 0xF5)
+		{
+			length = 4;
+			if (lead == 0xF0)
+				second_min = 0x90;
+			else if (lead == 0xF4)
+				second_max = 0x8F;
+		}
+		else
+			return 0;
+
+		if (size(str) < length || byte(1) < second_min || byte(1) > second_max)
+			return 0;
+
+		for (auto i = std::size_t{ 2 }; i < length; ++i)
+		{
+			if ((byte(i) & 0xC0) != 0x80)
+				return 0;
+		}
+
+		return length;
+	}
+
+	template<char... Chars>
+	static std::size_t find_special_char_scalar(const std::string_view str) noexcept
+	{
+		auto i = std::size_t{};
+		while (i < size(str))
+		{
+			if (static_cast<unsigned char>(str[i]) < 0x80)
+			{
+				if (is_special_char<Chars...>(str[i]))
+					return i;
+				++i;
+			}
+			else if (const auto length = utf8_sequence_length(str.substr(i)); length != 0)
+				i += length;
+			else
+				return i;
+		}
+
+		return i;
+	}
+
+#ifdef ANOTHER_TOML_HAS_SSE2
+	static int lowest_set_bit(const std::uint32_t mask) noexcept
+	{
+		assert(mask != 0);
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	static bool cpu_has_avx2() noexcept
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		int regs[4];
+		__cpuid(regs, 0);
+		if (regs[0] < 7)
+			return false;
+		// the os must save ymm registers as well as the cpu supporting avx
+		__cpuid(regs, 1);
+		constexpr auto osxsave_avx = (1 << 27) | (1 << 28);
+		if ((regs[2] & osxsave_avx) != osxsave_avx || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(regs, 7, 0);
+		return regs[1] & (1 << 5);
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	static const bool has_avx2 = cpu_has_avx2();
+
+	// 16 bytes at a time, SSE2 is always available on x86-64.
+	// Non-ASCII characters are validated one code point at a time.
+	template<char... Chars>
+	static std::size_t find_special_char_sse2(const std::string_view str) noexcept
+	{
+		const auto first = data(str);
+		const auto sz = size(str);
+		const auto space = _mm_set1_epi8(0x20);
+		const auto del = _mm_set1_epi8(0x7F);
+		auto i = std::size_t{};
+		while (i + 16 <= sz)
+		{
+			const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+			// the compare is signed, so non-ASCII bytes are also less than space
+			auto special = _mm_or_si128(_mm_cmplt_epi8(block, space), _mm_cmpeq_epi8(block, del));
+			((special = _mm_or_si128(special, _mm_cmpeq_epi8(block, _mm_set1_epi8(Chars)))), ...);
+			const auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(special));
+			if (mask == 0)
+			{
+				i += 16;
+				continue;
+			}
+
+			i += lowest_set_bit(mask);
+			if (static_cast<unsigned char>(first[i]) < 0x80)
+				return i;
+
+			// stay here until the next ASCII character
+			while (i < sz && static_cast<unsigned char>(first[i]) >= 0x80)
+			{
+				const auto length = utf8_sequence_length(str.substr(i));
+				if (length == 0)
+					return i;
+				i += length;
+			}
+		}
+
+		return i + find_special_char_scalar<Chars...>(str.substr(i));
+	}
+
+	// Lookup tables for find_special_char_avx2, indexed by a nibble of the input.
+	// Each bit is a kind of invalid sequence, a sequence is invalid if it is
+	// flagged in every table. From Keiser and Lemire,
+	// "Validating UTF-8 In Less Than One Instruction Per Byte"
+	namespace utf8_lookup
+	{
+		constexpr auto too_short = std::uint8_t{ 1 << 0 };
+		constexpr auto too_long = std::uint8_t{ 1 << 1 };
+		constexpr auto overlong_3 = std::uint8_t{ 1 << 2 };
+		constexpr auto too_large = std::uint8_t{ 1 << 3 };
+		constexpr auto surrogate = std::uint8_t{ 1 << 4 };
+		constexpr auto overlong_2 = std::uint8_t{ 1 << 5 };
+		constexpr auto too_large_1000 = std::uint8_t{ 1 << 6 };
+		constexpr auto overlong_4 = std::uint8_t{ 1 << 6 };
+		constexpr auto two_conts = std::uint8_t{ 1 << 7 };
+		constexpr auto carry = std::uint8_t{ too_short | too_long | two_conts };
+
+		// high nibble of the previous byte
+		alignas(16) constexpr std::uint8_t byte_1_high[16] = {
+			too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+			two_conts, two_conts, two_conts, two_conts,
+			too_short | overlong_2,
+			too_short,
+			too_short | overlong_3 | surrogate,
+			too_short | too_large | too_large_1000 | overlong_4
+		};
+
+		// low nibble of the previous byte
+		alignas(16) constexpr std::uint8_t byte_1_low[16] = {
+			carry | overlong_3 | overlong_2 | overlong_4,
+			carry | overlong_2,
+			carry,
+			carry,
+			carry | too_large,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000 | surrogate,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000
+		};
+
+		// high nibble of the current byte
+		alignas(16) constexpr std::uint8_t byte_2_high[16] = {
+			too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+			too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+			too_long | overlong_2 | two_conts | overlong_3 | too_large,
+			too_long | overlong_2 | two_conts | surrogate | too_large,
+			too_long | overlong_2 | two_conts | surrogate | too_large,
+			too_short, too_short, too_short, too_short
+		};
+	}
+
+	// Returns the number of bytes at the end of a block of valid UTF-8
+	// that start a code point which continues past the block.
+	static std::size_t incomplete_code_point(const char* block_end) noexcept
+	{
+		for (auto n = std::size_t{ 1 }; n < 4; ++n)
+		{
+			const auto ch = static_cast<unsigned char>(block_end[-static_cast<std::ptrdiff_t>(n)]);
+			if (ch < 0x80)
+				return 0;
+			if (ch >= 0xC0)
+			{
+				const auto length = std::size_t{ ch >= 0xF0 ? 4u : ch >= 0xE0 ? 3u : 2u };
+				return length > n ? n : 0;
+			}
+		}
+
+		return 0;
+	}
+
+	// 32 bytes at a time, only called if has_avx2.
+	// Blocks are checked for special characters and invalid UTF-8 together,
+	// a block with either is searched again by find_special_char_sse2 for the exact position.
+	template<char... Chars>
+	ANOTHER_TOML_TARGET_AVX2
+	static std::size_t find_special_char_avx2(const std::string_view str) noexcept
+	{
+		const auto load_table = [](const std::uint8_t(&table)[16]) noexcept {
+			return _mm_load_si128(reinterpret_cast<const __m128i*>(table));
+		};
+
+		const auto byte_1_high = _mm256_broadcastsi128_si256(load_table(utf8_lookup::byte_1_high));
+		const auto byte_1_low = _mm256_broadcastsi128_si256(load_table(utf8_lookup::byte_1_low));
+		const auto byte_2_high = _mm256_broadcastsi128_si256(load_table(utf8_lookup::byte_2_high));
+		const auto nibble = _mm256_set1_epi8(0x0F);
+		const auto control_max = _mm256_set1_epi8(0x1F);
+		const auto del = _mm256_set1_epi8(0x7F);
+		const auto third_byte = _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80));
+		const auto fourth_byte = _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80));
+		const auto high_bit = _mm256_set1_epi8(static_cast<char>(0x80));
+
+		const auto first = data(str);
+		const auto sz = size(str);
+		auto prev_block = _mm256_setzero_si256();
+		// everything before this is known to be ordinary characters
+		auto checked = std::size_t{};
+		for (auto i = std::size_t{}; i + 32 <= sz; i += 32)
+		{
+			const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + i));
+			auto special = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(block, control_max), block),
+				_mm256_cmpeq_epi8(block, del));
+			((special = _mm256_or_si256(special, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(Chars)))), ...);
+
+			if (_mm256_movemask_epi8(block) == 0)
+			{
+				// an ASCII block is only invalid if the previous block ended part way through a code point
+				if (checked != i || !_mm256_testz_si256(special, special))
+					break;
+				checked = i + 32;
+			}
+			else
+			{
+				// the previous 1, 2 and 3 bytes for each byte in block
+				const auto prev_lane = _mm256_permute2x128_si256(prev_block, block, 0x21);
+				const auto prev1 = _mm256_alignr_epi8(block, prev_lane, 15);
+				const auto prev2 = _mm256_alignr_epi8(block, prev_lane, 14);
+				const auto prev3 = _mm256_alignr_epi8(block, prev_lane, 13);
+
+				const auto special_cases = _mm256_and_si256(_mm256_and_si256(
+					_mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+					_mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+					_mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble)));
+
+				// the third and fourth bytes of 3 and 4 byte code points must be continuations
+				const auto must_be_continuation = _mm256_and_si256(_mm256_or_si256(
+					_mm256_subs_epu8(prev2, third_byte), _mm256_subs_epu8(prev3, fourth_byte)), high_bit);
+
+				special = _mm256_or_si256(special, _mm256_xor_si256(must_be_continuation, special_cases));
+				if (!_mm256_testz_si256(special, special))
+					break;
+				checked = i + 32 - incomplete_code_point(first + i + 32);
+			}
+
+			prev_block = block;
+		}
+
+		return checked + find_special_char_sse2<Chars...>(str.substr(checked));
+	}
+#endif
+
+	// Returns the index of the first special character in str, or size(str) if there isn't one.
+	template<char... Chars>
+	static std::size_t find_special_char(const std::string_view str) noexcept
+	{
+#ifdef ANOTHER_TOML_HAS_SSE2
+		if (has_avx2)
+			return find_special_char_avx2<Chars...>(str);
+		return find_special_char_sse2<Chars...>(str);
+#else
+		return find_special_char_scalar<Chars...>(str);
+#endif
+	}
+
+	// Reads characters directly out of a contiguous buffer (a string or a mapped file).
+	// Provides the parts of the std::istream interface used by parser_state,
+	// without per character virtual calls or copying the input.
+	// The buffer must outlive the scanner.
+	class buffer_scanner
+	{
+	public:
+		using traits_type = std::istream::traits_type;
+		using int_type = traits_type::int_type;
+
+		explicit buffer_scanner(std::string_view buffer) noexcept
+			: _begin{ data(buffer) }, _pos{ data(buffer) }, _end{ data(buffer) + size(buffer) },
+			_line{ data(buffer) }
+		{}
+
+		int_type get() noexcept
+		{
+			if (_pos == _end)
+			{
+				_eof = true;
+				return traits_type::eof();
+			}
+
+			return traits_type::to_int_type(*_pos++);
+		}
+
+		int_type peek() noexcept
+		{
+			if (_pos == _end)
+			{
+				_eof = true;
+				return traits_type::eof();
+			}
+
+			return traits_type::to_int_type(*_pos);
+		}
+
+		void ignore() noexcept
+		{
+			if (_pos == _end)
+				_eof = true;
+			else
+				++_pos;
+			return;
+		}
+
+		// Steps back over the last character read.
+		// Like std::istream::putback this clears the eof state.
+		void putback(char) noexcept
+		{
+			_eof = false;
+			--_pos;
+			return;
+		}
+
+		// Becomes false after trying to read past the end of the buffer
+		bool good() const noexcept
+		{
+			return !_eof;
+		}
+
+		// The next character to be read
+		const char* position() const noexcept
+		{
+			return _pos;
+		}
+
+		// The number of characters that have been read
+		std::size_t offset() const noexcept
+		{
+			return static_cast<std::size_t>(_pos - _begin);
+		}
+
+		// The whole buffer
+		std::string_view buffer() const noexcept
+		{
+			return { _begin, static_cast<std::size_t>(_end - _begin) };
+		}
+
+		// The characters that haven't been read yet
+		std::string_view remaining() const noexcept
+		{
+			return { _pos, static_cast<std::size_t>(_end - _pos) };
+		}
+
+		void advance(const std::size_t n) noexcept
+		{
+			assert(n <= static_cast<std::size_t>(_end - _pos));
+			_pos += n;
+			return;
+		}
+
+		// Marks the next character to be read as the start of a line
+		void begin_line() noexcept
+		{
+			_line = _pos;
+			return;
+		}
+
+		// The characters read since the start of the current line
+		std::string_view line() const noexcept
+		{
+			assert(_line <= _pos);
+			return { _line, static_cast<std::size_t>(_pos - _line) };
+		}
+
+	private:
+		const char* _begin;
+		const char* _pos;
+		const char* _end;
+		const char* _line;
+		bool _eof = false;
 	};
 
 	struct parser_state
 	{
+		struct error_info
+		{
+			parse_error_kind kind;
+			std::size_t line, col, offset;
+		};
+
 		template<bool NoThrow>
 		std::pair<char, bool> get_char() noexcept(NoThrow)
 		{
 			auto val = strm.get();
-			if (val == std::istream::traits_type::eof())
+			if (val == buffer_scanner::traits_type::eof())
 			{
 				if constexpr (NoThrow)
 				{
@@ -1786,22 +3352,39 @@ namespace another_toml
 				}
 			}
 
-			toml_file.push_back(static_cast<char>(val));
 			++col;
 			return { static_cast<char>(val), {} };
 		}
 
+		// Reads the characters before the next special character, see is_special_char.
+		// Returns the characters that were read.
+		template<char... Chars>
+		std::string_view read_ordinary_chars()
+		{
+			const auto rest = strm.remaining();
+			const auto chars = rest.substr(0, find_special_char<Chars...>(rest));
+			strm.advance(size(chars));
+			col += size(chars);
+			return chars;
+		}
+
 		void nextline() noexcept
 		{
 			col = {};
 			++line;
-			toml_file.clear();
+			strm.begin_line();
 			return;
 		}
 
+		// The characters read so far on the current line.
+		// Error messages rebuild the offending line from this instead of storing each line as it's parsed.
+		std::string_view current_line() const noexcept
+		{
+			return strm.line();
+		}
+
 		void ignore()
 		{
-			toml_file.push_back(strm.peek());
 			strm.ignore();
 			++col;
 			return;
@@ -1810,8 +3393,7 @@ namespace another_toml
 		void putback() noexcept
 		{
 			--col;
-			strm.putback(toml_file.back());
-			toml_file.pop_back();
+			strm.putback(strm.line().back());
 			return;
 		}
 
@@ -1819,7 +3401,33 @@ namespace another_toml
 		{
 			--col;
 			strm.putback(ch);
-			toml_file.pop_back();
+			return;
+		}
+
+		// Returns the input in [first, last) if borrowing the input and it holds exactly str.
+		// Otherwise returns an empty view with no data.
+		std::string_view borrow(const char* first, const char* last, std::string_view str) const noexcept
+		{
+			const auto input = std::string_view{ first, static_cast<std::size_t>(last - first) };
+			if (borrow_input && input == str)
+				return input;
+			return {};
+		}
+
+		// Prepares the state to parse another document, keeping its buffers
+		void reset(std::string_view buffer) noexcept
+		{
+			strm = buffer_scanner{ buffer };
+			stack.clear();
+			open_tables.clear();
+			last_token = token_type::bad;
+			line = {};
+			col = {};
+			errors = &std::cerr;
+			render_errors = true;
+			first_error.reset();
+			handler = nullptr;
+			handler_path.clear();
 			return;
 		}
 
@@ -1827,25 +3435,106 @@ namespace another_toml
 		{
 			for (auto t : open_tables)
 			{
-				assert(toml_data.nodes[t].type == node_type::table ||
-					toml_data.nodes[t].type == node_type::root_table);
-				toml_data.nodes[t].closed = true;
+				assert(toml_data.tags[t].type == node_type::table ||
+					toml_data.tags[t].type == node_type::root_table);
+				toml_data.tags[t].closed = true;
 			}
 			open_tables.clear();
 		}
 
-		std::istream& strm;
+		buffer_scanner strm;
 		// stack is never empty, but may contain table->key->inline table->key->array->etc.
-		std::vector<index_t> stack;
+		std::vector<index_t> stack = {};
 		// tables that need to be closed when encountering the next table header
-		std::vector<index_t> open_tables;
-		std::vector<token_type> token_stream;
+		std::vector<index_t> open_tables = {};
+		// the most recently parsed token, only the last one is ever needed
+		token_type last_token = token_type::bad;
 		std::size_t line = {};
 		std::size_t col = {};
-		// Stores the previously parsed line.
-		std::string toml_file;
+		// see parser_options::borrow_input
+		bool borrow_input = false;
+		// see parser_options::lazy_values
+		bool lazy_values = false;
+		// no_throw parses write errors here, see report_error
+		std::ostream* errors = &std::cerr;
+		// false while errors are only being detected, which skips drawing the error line
+		bool render_errors = true;
+		// the first error reported by a no_throw parse, for parser_options::diagnostics
+		std::optional<error_info> first_error = {};
+		// receives the document instead of value nodes being added to toml_internal_data
+		parse_handler* handler = nullptr;
+		// reused to pass table and key paths to handler
+		std::vector<std::string_view> handler_path = {};
 	};
 
+	std::ostream& report_error(parser_state& strm, const parse_error_kind kind)
+	{
+		if (!strm.first_error)
+			strm.first_error = parser_state::error_info{ kind, strm.line, strm.col, strm.strm.offset() };
+		return *strm.errors;
+	}
+
+	// Fills strm.handler_path with the table names leading from the root table to table.
+	// The unnamed tables inside array tables are skipped.
+	static const std::vector<std::string_view>& table_path(parser_state& strm, const toml_internal_data& d, index_t table)
+	{
+		auto& path = strm.handler_path;
+		path.clear();
+		while (table != root_table)
+		{
+			if (d.tags[table].table_type != table_def_type::array)
+				path.emplace_back(d.names[table]);
+			table = d.links[table].parent();
+		}
+
+		std::reverse(begin(path), end(path));
+		return path;
+	}
+
+	// Fills strm.handler_path with the parts of a dotted key name
+	static const std::vector<std::string_view>& key_path(parser_state& strm, const toml_internal_data& d, const index_t key)
+	{
+		auto& path = strm.handler_path;
+		path.clear();
+		path.emplace_back(d.names[key]);
+		auto parent = d.links[key].parent();
+		while (d.tags[parent].type == node_type::table &&
+			d.tags[parent].table_type == table_def_type::dotted)
+		{
+			path.emplace_back(d.names[parent]);
+			parent = d.links[parent].parent();
+		}
+
+		std::reverse(begin(path), end(path));
+		return path;
+	}
+
+	// Passes a value to the handler in place of inserting a value node
+	static void report_value(parse_handler& h, const std::string_view str, const variant_t& value)
+	{
+		std::visit([&h, str](auto&& val) {
+			using T = std::decay_t<decltype(val)>;
+			if constexpr (std::is_same_v<string_t, T>)
+				h.string_value(str, val.literal);
+			else if constexpr (std::is_same_v<integral, T>)
+				h.integer_value(val.value, val.base);
+			else if constexpr (std::is_same_v<floating, T>)
+				h.floating_value(val.value, val.rep);
+			else if constexpr (std::is_same_v<bool, T>)
+				h.boolean_value(val);
+			else if constexpr (std::is_same_v<date_time, T>)
+				h.date_time_value(val);
+			else if constexpr (std::is_same_v<local_date_time, T>)
+				h.date_time_local_value(val);
+			else if constexpr (std::is_same_v<date, T>)
+				h.date_local_value(val);
+			else if constexpr (std::is_same_v<time, T>)
+				h.time_local_value(val);
+			return;
+		}, value);
+		return;
+	}
+
 	//new line(we check both, since file may have been opened in binary mode)
 	static bool newline(parser_state& strm, char ch) noexcept
 	{
@@ -1910,12 +3599,13 @@ namespace another_toml
 	}
 
 	template<bool NoThrow>
-	static index_t insert_child_table(const index_t parent, std::string name, detail::toml_internal_data& d, table_def_type t)
+	static index_t insert_child_table(const index_t parent, std::string_view name, detail::toml_internal_data& d, table_def_type t,
+		parser_state* strm)
 	{
-		auto table = detail::internal_node{ std::move(name) , node_type::table };
+		auto table = detail::internal_node{ name, node_type::table };
 		table.closed = false;
 		table.table_type = t;
-		return insert_child<NoThrow>(d, parent, std::move(table));
+		return insert_child<NoThrow>(d, parent, std::move(table), strm);
 	}
 
 	constexpr auto error_entire_line = std::numeric_limits<std::size_t>::max();
@@ -1923,7 +3613,7 @@ namespace another_toml
 
 	static void parse_line(parser_state& strm)
 	{
-		if (strm.toml_file.back() != '\n')
+		if (const auto line = strm.current_line(); empty(line) || line.back() != '\n')
 		{
 			auto [ch, eof] = strm.get_char<true>();
 			while (!eof && ch != '\n')
@@ -1934,35 +3624,41 @@ namespace another_toml
 	static void print_error_string(parser_state& strm, std::size_t error_begin,
 		std::size_t error_end, std::ostream& cerr)
 	{
+		if (!strm.render_errors)
+			return;
+
 		auto line_display_strm = std::ostringstream{};
 		line_display_strm << strm.line + 1 << '>';
 		const auto line_display = line_display_strm.str();
 
-		if (empty(strm.toml_file))
-		{
-			cerr << line_display_strm.str() << "\uFFFD\n";
+		const auto print_empty_line = [&line_display, &cerr]() {
+			cerr << line_display << "\uFFFD\n";
 			for (auto i = std::size_t{}; i < size(line_display); ++i)
 				cerr.put(' ');
 			cerr << '^';
 			return;
-		}
+		};
 
-		if (error_end == error_current_col)
+		if (empty(strm.current_line()))
 		{
-			error_end = strm.toml_file.find_last_not_of(' ');
-			if (error_end > size(strm.toml_file))
-				error_end = error_entire_line;
+			print_empty_line();
+			return;
 		}
 
-		if (strm.toml_file.back() != '\n')
+		if (error_end == error_current_col)
 		{
-			auto [ch, eof] = strm.get_char<true>();
-			while (!eof && ch != '\n')
-				std::tie(ch, eof) = strm.get_char<true>();
+			const auto line = strm.current_line();
+			error_end = line.find_last_not_of(' ');
+			if (error_end > size(line))
+				error_end = error_entire_line;
 		}
 
+		parse_line(strm);
+		// copy the line, it's edited below before being drawn
+		auto toml_line = std::string{ strm.current_line() };
+
 		if (error_end == error_entire_line)
-			error_end = strm.toml_file.find_last_not_of(' ');
+			error_end = toml_line.find_last_not_of(' ');
 
 		const auto is_position_control_char = [](char ch) {
 			return ch == '\v' ||
@@ -1976,35 +3672,35 @@ namespace another_toml
 				ch == '\0';
 		};
 
-		auto iter = std::find_if(begin(strm.toml_file), end(strm.toml_file), is_position_control_char);
+		auto iter = std::find_if(begin(toml_line), end(toml_line), is_position_control_char);
 
 		// replace any positional control characters
 		constexpr auto replacement_char = "\uFFFD"sv;
-		while (iter != end(strm.toml_file))
+		while (iter != end(toml_line))
 		{
-			iter = strm.toml_file.erase(iter);
-			// iter = strm.toml_file.insert(iter, begin(replacement_char), std::end(replacement_char));
-			iter = std::find_if(iter, end(strm.toml_file), is_position_control_char);
+			iter = toml_line.erase(iter);
+			// iter = toml_line.insert(iter, begin(replacement_char), std::end(replacement_char));
+			iter = std::find_if(iter, end(toml_line), is_position_control_char);
 		}
 
 		// if we left the string empty after erasing control chars
-		if (empty(strm.toml_file))
+		if (empty(toml_line))
 		{
-			print_error_string(strm, error_begin, error_end, cerr);
+			print_empty_line();
 			return;
 		}
 
-		cerr << line_display << strm.toml_file;
-		if(strm.toml_file.back() != '\n')
+		cerr << line_display << toml_line;
+		if(toml_line.back() != '\n')
 			cerr << '\n';
 
 		for (auto i = std::size_t{}; i < size(line_display); ++i)
 			cerr.put(' ');
 		
-		auto begin_addr = &strm.toml_file[error_begin];
-		auto end_addr = &strm.toml_file[error_end];
+		auto begin_addr = &toml_line[error_begin];
+		auto end_addr = &toml_line[error_end];
 
-		auto view = uni::ranges::grapheme::utf8_view{ strm.toml_file };
+		auto view = uni::ranges::grapheme::utf8_view{ toml_line };
 
 		auto begin_found = false;
 		auto end_found = false;
@@ -2055,1390 +3751,1723 @@ namespace another_toml
 	}
 
 	template<bool NoThrow>
-	static index_t insert_child_table_array(index_t parent, std::string name, detail::toml_internal_data& d)
+	static index_t insert_child_table_array(index_t parent, std::string_view name, detail::toml_internal_data& d,
+		parser_state* strm)
+	{
+		if (const auto child = find_child(d, parent, name);
+			child != bad_index)
+		{
+			const auto type = d.tags[child].type;
+			if (type != node_type::array_tables)
+			{
+				const auto msg = "Attempted to redefine \""s + std::string{ name } +
+					"\" as an array table; was previously defined as: "s + to_string(type) + ".\n"s;
+
+				if constexpr (NoThrow)
+				{
+					// additional information is added by the calling func
+					assert(strm);
+					report_error(*strm, parse_error_kind::duplicate_element) << msg;
+					insert_bad(d);
+					return bad_index;
+				}
+				else
+				{
+					// additional information is added by the calling func
+					throw duplicate_element{ msg, {}, {}, std::string{ name } };
+				}
+			}
+
+			parent = child;
+		}
+		else
+		{
+			//create array as child
+			auto n = internal_node{ name, node_type::array_tables };
+			n.table_type = table_def_type::header;
+			parent = insert_child<NoThrow>(d, parent, std::move(n), strm);
+			if constexpr (NoThrow)
+			{
+				if (parent == bad_index)
+					return parent;
+			}
+		}
+
+		assert(d.tags[parent].type == node_type::array_tables);
+
+		// insert array member
+		auto ret = insert_child_table<NoThrow>(parent, {}, d, table_def_type::array, strm);		
+		if constexpr (NoThrow)
+		{
+			if (ret == bad_index)
+			{
+				insert_bad(d);
+				return bad_index;
+			}
+		}
+		return ret;
+	}
+
+	// Tests if the char is the start of a unicode code point
+ 	static constexpr bool is_unicode_start(char c) noexcept
+	{
+		return c & 0x80 && c & 0x40;
+	}
+
+	// Tests if the char is part of a code point, but wasn't the start
+	static constexpr bool is_unicode_continuation(char c) noexcept
+	{
+		return c & 0x80 && !(c & 0x40);
+	}
+
+	constexpr auto unicode_error_char = char32_t{ 0x110000 };
+
+	// variant of unicode_u8_to_u32 that reads from parser_state
+	static char32_t parse_unicode_char(char c, parser_state& strm) noexcept
+	{
+		if (!is_unicode_start(c))
+			return unicode_error_char;
+
+		int bytes = 1;
+		if (c & 0b01000000)
+		{
+			++bytes;
+			if (c & 0b00100000)
+			{
+				++bytes;
+				if (c & 0b00010000)
+					++bytes;
+			}
+		}
+
+		assert(bytes >= 1);
+		auto out = std::uint32_t{};
+		switch (bytes)
+		{
+		case 2:
+			out = c & 0b00011111;
+			break;
+		case 3:
+			out = c & 0b00001111;
+			break;
+		case 4:
+			out = c & 0b00000111;
+			break;
+		}
+
+		while (bytes-- > 1)
+		{
+			auto [ch, eof] = strm.get_char<true>();
+			if (eof || !is_unicode_continuation(ch))
+				return unicode_error_char;
+			out = out << 6; 
+			out |= ch & 0b00111111;
+		}
+
+		if (valid_u32_code_point(out))
+			return out;
+
+		return unicode_error_char;
+	}
+
+	static constexpr bool invalid_string_chars(char ch) noexcept
+	{
+		return ((ch >= 0 && ch < 32) || ch == 127) && ch != '\t';
+	}
+
+	// TODO: invalid/string/multiline-no-close-5 invalid/string/multiline-lit-no-close-4
+	// no msg on nothrow; unexpected eof on throw
+
+	// TODO: invalid/inline-table/trailing-comma
+	// carret of off by one
+
+	//escapes control codes and unexpected unicode chars
+	// TODO: merge this with the block control style printer
+	static std::ostream& print_invalid_chars(const char ch, std::ostream& strm)
+	{
+		strm << to_escaped_string2(std::string_view{ &ch, 1 });
+		return strm;
+	}
+
+	template<bool NoThrow, bool DoubleQuoted>
+	static std::optional<std::string> get_quoted_str(parser_state& strm)
 	{
-		if (auto* node = &d.nodes[parent];
-			node->child != bad_index)
+		constexpr auto delim = DoubleQuoted ? '\"' : '\'';
+		auto out = std::string{};
+		char ch;
+		bool eof;
+		const auto string_begin = strm.col - 1;
+		constexpr auto missing_end_error_msg = "Quoted string missing end quote\n"sv;
+
+		while (strm.strm.good())
 		{
-			auto child = node->child;
-			node = &d.nodes[child];
+			out.append(strm.read_ordinary_chars<delim>());
+			try
+			{
+				std::tie(ch, eof) = strm.get_char<NoThrow>();
+			}
+			catch (const unexpected_eof&)
+			{
+				auto string = std::ostringstream{};
+				string << missing_end_error_msg;
+				print_error_string(strm, string_begin, strm.col, string);
+				throw unexpected_eof{ string.str(), strm.line, strm.col };
+			}
+
+			if constexpr (NoThrow)
+			{
+				if (eof)
+				{
+					report_error(strm, parse_error_kind::unexpected_character) << missing_end_error_msg;
+					print_error_string(strm, string_begin, strm.col, *strm.errors);
+					return {};
+				}
+			}
 
-			while (node)
+			if (newline(strm, ch))
 			{
-				if (unicode_string_equal(node->name, name))
+				if constexpr (NoThrow)
 				{
-					if (node->type == node_type::array_tables)
-					{
-						parent = child;
-						break;
-					}
-					else
+					report_error(strm, parse_error_kind::unexpected_character) << missing_end_error_msg;
+					print_error_string(strm, string_begin, error_entire_line, *strm.errors);
+					return {};
+				}
+				else
+				{
+					auto string = std::ostringstream{};
+					string << missing_end_error_msg;
+					print_error_string(strm, string_begin, error_entire_line, string);
+					throw unexpected_character{ string.str(), strm.line, strm.col };
+				}
+			}
+
+			if (ch == delim)
+			{
+				if constexpr (DoubleQuoted)
+				{
+					if (size(out) > 0)
 					{
-						const auto msg = "Attempted to redefine \""s + name +
-							"\" as an array table; was previously defined as: "s + to_string(node->type) + ".\n"s;
-						
-						if constexpr (NoThrow)
+						//don't break on escaped quote: '\"'
+						if (out.back() != '\\')
 						{
-							// additional information is added by the calling func
-							std::cerr << msg;
-							insert_bad(d);
-							return bad_index;
+							strm.putback(ch);
+							break;
 						}
-						else
+						// but do break if escaped slash followed by quote: "\\""
+						else if (size(out) > 2 && out[size(out) - 2] == '\\')
 						{
-							// additional information is added by the calling func
-							throw duplicate_element{ msg, {}, {}, std::move(name) };
+							strm.putback(ch);
+							break;
 						}
 					}
+					else
+					{
+						strm.putback(ch);
+						break;
+					}
 				}
-
-				if (node->next == bad_index)
+				else 
+				{
+					strm.putback(ch);
 					break;
-				child = node->next;
-				node = &d.nodes[child];
+				}
 			}
 
-			//create array
-			if (node->name != name)
+			if (invalid_string_chars(ch))
 			{
-				auto n = internal_node{ std::move(name), node_type::array_tables };
-				n.table_type = table_def_type::header;
-				parent = insert_child<NoThrow>(d, parent, std::move(n));
+				const auto print_error = [&strm, ch](std::ostream& o) {
+					o << "Unexpected character found in table/key name: \'"s;
+					print_invalid_chars(ch, o); 
+					o << "\'.\n"s;
+					print_error_string(strm, strm.col - 1, strm.col, o);
+				};
+
 				if constexpr (NoThrow)
 				{
-					if (parent == bad_index)
-						return parent;
+					print_error(report_error(strm, parse_error_kind::unexpected_character));
+					return {};
+				}
+				else
+				{
+					const auto line = strm.line,
+						col = strm.col;
+					auto str = std::ostringstream{};
+					print_error(str);
+					throw unexpected_character{ str.str(), line, col };
+				}
+			}
+			else if (is_unicode_byte(ch))
+			{
+				const auto ch_index = strm.col - 1;
+				const auto unicode = parse_unicode_char(ch, strm);
+
+				if (unicode == unicode_error_char)
+				{
+					const auto print_error = [&strm, ch, ch_index](std::ostream& o) {
+						o << "Invalid unicode character in string: \'"s; 
+						print_invalid_chars(ch, o);
+						o << "\'.\n"s;
+						print_error_string(strm, ch_index, error_current_col, o);
+					};
+
+					if constexpr (NoThrow)
+					{
+						print_error(report_error(strm, parse_error_kind::invalid_unicode_char));
+						return {};
+					}
+					else
+					{
+						const auto line = strm.line,
+							col = strm.col;
+						auto str = std::ostringstream{};
+						print_error(str);
+						throw invalid_unicode_char{ str.str(), line, col };
+					}
+				}
+				else
+				{
+					const auto u8 = unicode_u32_to_u8(unicode);
+					out.append(u8);
+					continue;
 				}
 			}
+
+			out.push_back(ch);
+		}
+		
+		return out;
+	}
+	
+	static std::optional<std::string> get_unquoted_name(parser_state& strm, char ch)
+	{
+		if (!valid_key_name_char(ch))
+		{
+			strm.putback(ch);
+			return {};
 		}
-		else
+			
+		auto out = std::string{ ch };
+		auto eof = false;
+		while (strm.strm.good())
 		{
-			//create array as child
-			auto n = internal_node{ std::move(name), node_type::array_tables };
-			n.table_type = table_def_type::header;
-			parent = insert_child<NoThrow>(d, parent, std::move(n));
-			if constexpr (NoThrow)
+			std::tie(ch, eof) = strm.get_char<true>();
+			if (eof) return {};
+
+			if (ch == ' ' ||
+				ch == '\t' ||
+				ch == '.' ||
+				ch == '=' ||
+				ch == ']')
 			{
-				if (parent == bad_index)
-					return parent;
+				strm.putback(ch);
+				break;
 			}
-		}
-
-		auto& node = d.nodes[parent];
-		assert(node.type == node_type::array_tables);
 
-		// insert array member
-		auto ret = insert_child_table<NoThrow>(parent, {}, d, table_def_type::array);		
-		if constexpr (NoThrow)
-		{
-			if (ret == bad_index)
+			if (!valid_key_name_char(ch))
 			{
-				insert_bad(d);
-				return bad_index;
+				strm.putback(ch);
+				return {};
 			}
+
+			out.push_back(ch);
 		}
-		return ret;
-	}
 
-	// Tests if the char is the start of a unicode code point
- 	static constexpr bool is_unicode_start(char c) noexcept
-	{
-		return c & 0x80 && c & 0x40;
+		return out;
 	}
 
-	// Tests if the char is part of a code point, but wasn't the start
-	static constexpr bool is_unicode_continuation(char c) noexcept
+	// Replace control chars with the unicode replacement char
+	// 's' is a string_view containing a grapheme
+	std::string_view block_control(std::string_view s) noexcept
 	{
-		return c & 0x80 && !(c & 0x40);
+		if (empty(s) || s[0] < 0x20)
+			return "\ufffd"sv;
+		else
+			return s;
 	}
 
-	constexpr auto unicode_error_char = char32_t{ 0x110000 };
+	// used in parse_key_name to select the correct table type
+	template<bool Table>
+	struct table_type_constant : std::integral_constant<table_def_type, table_def_type::dotted> {};
+	template<>
+	struct table_type_constant<true> : std::integral_constant<table_def_type, table_def_type::header> {};
 
-	// variant of unicode_u8_to_u32 that reads from parser_state
-	static char32_t parse_unicode_char(char c, parser_state& strm) noexcept
+	template<bool NoThrow, bool Table = false>
+	static key_name parse_key_name(parser_state& strm, detail::toml_internal_data& d, std::size_t& key_char_begin)
 	{
-		if (!is_unicode_start(c))
-			return unicode_error_char;
-
-		int bytes = 1;
-		if (c & 0b01000000)
-		{
-			++bytes;
-			if (c & 0b00100000)
-			{
-				++bytes;
-				if (c & 0b00010000)
-					++bytes;
-			}
-		}
-
-		assert(bytes >= 1);
-		auto out = std::uint32_t{};
-		switch (bytes)
+		auto name = std::optional<std::string>{};
+		auto input_name = std::string_view{};
+		auto parent = root_table;
+		if constexpr (!Table)
 		{
-		case 2:
-			out = c & 0b00011111;
-			break;
-		case 3:
-			out = c & 0b00001111;
-			break;
-		case 4:
-			out = c & 0b00000111;
-			break;
+			if(!empty(strm.stack))
+				parent = strm.stack.back();
 		}
 
-		while (bytes-- > 1)
+		while (strm.strm.good())
 		{
-			auto [ch, eof] = strm.get_char<true>();
-			if (eof || !is_unicode_continuation(ch))
-				return unicode_error_char;
-			out = out << 6; 
-			out |= ch & 0b00111111;
-		}
+			// eof exception is given more context in the calling function.
+			auto [ch, eof] = strm.get_char<NoThrow>();
+			if constexpr (NoThrow)
+			{
+				if (eof)
+				{
+					report_error(strm, parse_error_kind::unexpected_eof) << "Unexpected end-of-file in table/key name.\n";
+					print_error_string(strm, strm.col - 1, strm.col - 1, *strm.errors);
+					insert_bad(d);
+					return {};
+				}
+			}
 
-		if (valid_u32_code_point(out))
-			return out;
+			if (whitespace(ch, strm))
+				continue;
 
-		return unicode_error_char;
-	}
+			if (ch == '=' || ch == ']')
+			{
+				if (!name)
+				{
+					constexpr auto msg = "Missing name\n"sv;
+					const auto name_begin = strm.col < 2 ? 0 : strm.col - 2;
+					if constexpr (NoThrow)
+					{
+						report_error(strm, parse_error_kind::unexpected_character) << msg;
+						insert_bad(d);
+						print_error_string(strm, name_begin, strm.col, *strm.errors);
+						return {};
+					}
+					else
+					{
+						auto string = std::ostringstream{};
+						string << msg;
+						print_error_string(strm, name_begin, strm.col, string);
+						throw unexpected_character{ string.str(), strm.line, strm.col };
+					}
+				}
 
-	static constexpr bool invalid_string_chars(char ch) noexcept
-	{
-		return ((ch >= 0 && ch < 32) || ch == 127) && ch != '\t';
-	}
+				strm.putback(ch);
+				break;
+			}
 
-	// TODO: invalid/string/multiline-no-close-5 invalid/string/multiline-lit-no-close-4
-	// no msg on nothrow; unexpected eof on throw
+			if (ch == '\"')
+			{
+				if (name)
+				{
+					constexpr auto msg = "Unexpected character in key name: \"\n";
 
-	// TODO: invalid/inline-table/trailing-comma
-	// carret of off by one
+					if constexpr (NoThrow)
+					{
+						report_error(strm, parse_error_kind::unexpected_character) << msg;
+						print_error_string(strm, strm.col - 1, strm.col, *strm.errors);
+						return {};
+					}
+					else
+					{
+						auto str = std::ostringstream{};
+						str << msg;
+						print_error_string(strm, strm.col - 1, strm.col, str);
+						throw unexpected_character{ str.str(), strm.line, strm.col };
+					}
+				}
+				const auto name_first = strm.strm.position();
+				name = get_quoted_str<NoThrow, true>(strm);
+				if constexpr (NoThrow)
+				{
+					if (!name)
+					{
+						insert_bad(d);
+						return {};
+					}
+				}
 
-	//escapes control codes and unexpected unicode chars
-	// TODO: merge this with the block control style printer
-	static std::ostream& print_invalid_chars(const char ch, std::ostream& strm)
-	{
-		strm << to_escaped_string2(std::string_view{ &ch, 1 });
-		return strm;
-	}
+				assert(name);
+				if (!replace_escape_chars<NoThrow>(*name, *strm.errors))
+				{
+					if constexpr (NoThrow)
+					{
+						report_error(strm, parse_error_kind::unicode_error);
+						insert_bad(d);
+						return {};
+					}
+				}
 
-	template<bool NoThrow, bool DoubleQuoted>
-	static std::optional<std::string> get_quoted_str(parser_state& strm)
-	{
-		constexpr auto delim = DoubleQuoted ? '\"' : '\'';
-		auto out = std::string{};
-		char ch;
-		bool eof;
-		const auto string_begin = strm.col - 1;
-		constexpr auto missing_end_error_msg = "Quoted string missing end quote\n"sv;
+				input_name = strm.borrow(name_first, strm.strm.position(), *name);
 
-		while (strm.strm.good())
-		{
-			try
-			{
 				std::tie(ch, eof) = strm.get_char<NoThrow>();
+				if constexpr (NoThrow)
+				{
+					if (eof || ch != '\"')
+					{
+						report_error(strm, parse_error_kind::unexpected_character) << "Unexpected end of quoted string: "s << name.value_or("\"\""s) << '\n';
+						insert_bad(d);
+						return {};
+					}
+				}
+				
+				continue;
 			}
-			catch (const unexpected_eof&)
-			{
-				auto string = std::ostringstream{};
-				string << missing_end_error_msg;
-				print_error_string(strm, string_begin, strm.col, string);
-				throw unexpected_eof{ string.str(), strm.line, strm.col };
-			}
-
-			if constexpr (NoThrow)
+			else if(ch == '\'')
 			{
-				if (eof)
+				if (name)
 				{
-					std::cerr << missing_end_error_msg;
-					print_error_string(strm, string_begin, strm.col, std::cerr);
-					return {};
+					// TODO: update error invalid/key/newline-5
+					if constexpr (NoThrow)
+					{
+						report_error(strm, parse_error_kind::unexpected_character) << "Illigal character in name: \'\n";
+						insert_bad(d);
+						return {};
+					}
+					else
+						throw unexpected_character{ "Illigal character in name: \'" };
+				}
+				const auto name_first = strm.strm.position();
+				name = get_quoted_str<NoThrow, false>(strm);
+				if constexpr (NoThrow)
+				{
+					if(!name)
+					{
+						insert_bad(d);
+						return {};
+					}
 				}
-			}
 
-			if (newline(strm, ch))
+				input_name = strm.borrow(name_first, strm.strm.position(), *name);
+
+				std::tie(ch, eof) = strm.get_char<NoThrow>();
+				if constexpr (NoThrow)
+				{
+					if (eof || ch!= '\'')
+					{
+						insert_bad(d);
+						return{};
+					}
+				}
+				
+				continue;
+			}
+			else if (ch == '.')
 			{
-				if constexpr (NoThrow)
+				if (!name)
 				{
-					std::cerr << missing_end_error_msg;
-					print_error_string(strm, string_begin, error_entire_line, std::cerr);
-					return {};
+					constexpr auto msg = "Missing name\n"sv;
+					const auto name_begin = strm.col < 2 ? 0 : strm.col - 2;
+					if constexpr (NoThrow)
+					{
+						insert_bad(d);
+						report_error(strm, parse_error_kind::unexpected_character) << msg;
+						print_error_string(strm, name_begin, strm.col, *strm.errors);
+						return {};
+					}
+					else
+					{
+						auto string = std::ostringstream{};
+						string << msg;
+						print_error_string(strm, name_begin, strm.col, string);
+						throw unexpected_character{ string.str(), strm.line, strm.col };
+					}
 				}
 				else
 				{
-					auto string = std::ostringstream{};
-					string << missing_end_error_msg;
-					print_error_string(strm, string_begin, error_entire_line, string);
-					throw unexpected_character{ string.str(), strm.line, strm.col };
-				}
-			}
-
-			if (ch == delim)
-			{
-				if constexpr (DoubleQuoted)
-				{
-					if (size(out) > 0)
+					const auto part_name = data(input_name) ? input_name : std::string_view{ *name };
+					auto child = find_child(d, parent, part_name);
+					
+					if (child == bad_index)
+						child = insert_child_table<NoThrow>(parent, part_name, d, table_type_constant<Table>::value, &strm);
+					else if(const auto& c = d.tags[child]; 
+						c.type == node_type::array_tables)
 					{
-						//don't break on escaped quote: '\"'
-						if (out.back() != '\\')
+						if constexpr (!Table)
 						{
-							strm.putback(ch);
-							break;
+							const auto write_error = [&strm, &d, child](std::ostream& o) {
+								const auto msg = "Cannot use a dotted name to add a key to a table array.\n";
+								const auto name_end = strm.col - 1;
+								const auto name_beg = name_end - size(d.names[child]);
+								o << msg;
+								print_error_string(strm, name_beg, name_end, o);
+								return;
+							};
+
+							if constexpr (NoThrow)
+							{
+								write_error(report_error(strm, parse_error_kind::parsing_error));
+								insert_bad(d);
+								return {};
+							}
+							else
+							{
+								auto string = std::ostringstream{};
+								write_error(string);
+								throw parsing_error{ string.str(), strm.line, strm.col };
+							}
 						}
-						// but do break if escaped slash followed by quote: "\\""
-						else if (size(out) > 2 && out[size(out) - 2] == '\\')
+
+						child = d.links[child].last_child();
+					}
+					else if (c.closed && c.table_type == table_def_type::header)
+					{
+						if constexpr(!Table)
 						{
-							strm.putback(ch);
-							break;
+							const auto write_error = [&strm, &d, child](std::ostream& o) {
+								const auto msg = "Attempted to add to a previously defined table: \""s + std::string{ d.names[child] } +
+									"\" using dotted keys.\n"s;
+								const auto name_end = strm.col - 1;
+								const auto name_beg = name_end - size(d.names[child]);
+								o << msg;
+								print_error_string(strm, name_beg, name_end, o);
+								return;
+							};
+
+							if constexpr (NoThrow)
+							{
+								write_error(report_error(strm, parse_error_kind::duplicate_element));
+								insert_bad(d);
+								return {};
+							}
+							else
+							{
+								auto string = std::ostringstream{};
+								write_error(string);
+								throw duplicate_element{ string.str(), strm.line, strm.col, std::string{ d.names[child] } };
+							}
 						}
+						// fall out of if
 					}
-					else
+					else if (!(c.type == node_type::table || c.type == node_type::array_tables))
 					{
-						strm.putback(ch);
-						break;
+						const auto write_error = [&strm, &c, &d, child](std::ostream& o) {
+							const auto msg = "Attempted to redefine \""s + std::string{ d.names[child] } +
+								"\" as a table using dotted keys. Was previously defined as: \""s +
+								to_string(c.type) + "\".\n"s;
+							const auto name_end = strm.col - 1;
+							const auto name_beg = name_end - size(d.names[child]);
+							o << msg;
+							print_error_string(strm, name_beg, name_end, o);
+							return;
+						};
+
+						if constexpr (NoThrow)
+						{
+							write_error(report_error(strm, parse_error_kind::duplicate_element));
+							insert_bad(d);
+							return {};
+						}
+						else
+						{
+							auto string = std::ostringstream{};
+							write_error(string);
+							throw duplicate_element{ string.str(), strm.line, strm.col, std::string{ d.names[child] } };
+						}
 					}
+
+					parent = child;
+					name = {};
+					input_name = {};
+					key_char_begin = strm.col;
+					continue;
 				}
-				else 
+			}
+
+			const auto handle_character_error = [&strm, &d] {
+				// eof exception is given more context in the calling function.
+				const auto [ch, eof] = strm.get_char<NoThrow>();
+				if constexpr (NoThrow)
 				{
-					strm.putback(ch);
-					break;
+					if (eof)
+					{
+						report_error(strm, parse_error_kind::unexpected_eof) << "Unexpected end-of-file in table/key name.\n";
+						print_error_string(strm, strm.col - 1, strm.col, *strm.errors);
+						insert_bad(d);
+						return;
+					}
 				}
-			}
 
-			if (invalid_string_chars(ch))
-			{
-				const auto print_error = [&strm, ch](std::ostream& o) {
-					o << "Unexpected character found in table/key name: \'"s;
-					print_invalid_chars(ch, o); 
-					o << "\'.\n"s;
-					print_error_string(strm, strm.col - 1, strm.col, o);
+				const auto ch_index = strm.col - 1;
+				const auto print_error = [&strm, ch_index](std::ostream& o) {
+					parse_line(strm);
+					const auto str = strm.current_line().substr(ch_index);
+					auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
+					o << "Unexpected character found in table/key name: \'"s <<
+						block_control(*begin(graph_rng)) <<
+						"\'.\n"s;
+					print_error_string(strm, ch_index, ch_index + 1, o);
 				};
 
 				if constexpr (NoThrow)
 				{
-					print_error(std::cerr);
-					return {};
+					print_error(report_error(strm, parse_error_kind::unexpected_character));
+					insert_bad(d);
+					return;
 				}
 				else
 				{
 					const auto line = strm.line,
-						col = strm.col;
+						col = ch_index;
 					auto str = std::ostringstream{};
 					print_error(str);
 					throw unexpected_character{ str.str(), line, col };
 				}
-			}
-			else if (is_unicode_byte(ch))
-			{
-				const auto ch_index = strm.col - 1;
-				const auto unicode = parse_unicode_char(ch, strm);
+			};
 
-				if (unicode == unicode_error_char)
+			if (!name)
+			{
+				// ch has already been read
+				const auto name_first = strm.strm.position() - 1;
+				auto str = get_unquoted_name(strm, ch);
+				if (str)
 				{
-					const auto print_error = [&strm, ch, ch_index](std::ostream& o) {
-						o << "Invalid unicode character in string: \'"s; 
-						print_invalid_chars(ch, o);
-						o << "\'.\n"s;
-						print_error_string(strm, ch_index, error_current_col, o);
-					};
-
-					if constexpr (NoThrow)
-					{
-						print_error(std::cerr);
-						return {};
-					}
-					else
-					{
-						const auto line = strm.line,
-							col = strm.col;
-						auto str = std::ostringstream{};
-						print_error(str);
-						throw invalid_unicode_char{ str.str(), line, col };
-					}
+					name = str;
+					input_name = strm.borrow(name_first, strm.strm.position(), *name);
 				}
 				else
 				{
-					const auto u8 = unicode_u32_to_u8(unicode);
-					out.append(u8);
-					continue;
+					handle_character_error();
+					return {};
 				}
 			}
-
-			out.push_back(ch);
+			else
+			{
+				strm.putback();
+				strm.putback();
+				handle_character_error();
+				return {};
+			}
 		}
-		
-		return out;
+
+		return { parent, name, input_name };
 	}
-	
-	static std::optional<std::string> get_unquoted_name(parser_state& strm, char ch)
+
+	using get_value_type_ret = std::tuple<value_type, variant_t, std::string>;
+
+	// access func from string_util.cpp
+	template<bool NoThrow>
+	extern std::variant<std::monostate, date, time, date_time, local_date_time> parse_date_time_ex(std::string_view str, std::ostream& errors) noexcept(NoThrow);
+
+	// lazy: see parser_options::lazy_values, if set the returned string is always a copy of str
+	// NoThrow errors are written to errors
+	template<bool NoThrow>
+	static get_value_type_ret get_value_type(std::string_view str, const bool lazy, std::ostream& errors) noexcept(NoThrow)
 	{
-		if (!valid_key_name_char(ch))
+		if (empty(str))
 		{
-			strm.putback(ch);
-			return {};
+			if constexpr (NoThrow)
+			{
+				return { value_type::bad, {}, {} };
+			}
+			else
+				throw parsing_error{ "Error parsing value.\n" };
 		}
-			
-		auto out = std::string{ ch };
-		auto eof = false;
-		while (strm.strm.good())
-		{
-			std::tie(ch, eof) = strm.get_char<true>();
-			if (eof) return {};
 
-			if (ch == ' ' ||
-				ch == '\t' ||
-				ch == '.' ||
-				ch == '=' ||
-				ch == ']')
+		//keywords
+		//	true, false
+		if (str == "true"sv)
+			return { value_type::boolean, true, std::string{ str } };
+		if (str == "false"sv)
+			return { value_type::boolean, false, std::string{ str } };
+		
+		using error_t = parse_float_string_return::error_t;
+
+		const auto int_ret = parse_integer_string(str);
+		if (int_ret.error == error_t::none)
+		{
+			if (lazy)
+				return { value_type::integer, detail::integral{ int_ret.value, int_ret.base }, std::string{ str } };
+			return { value_type::integer, detail::integral{ int_ret.value, int_ret.base }, std::to_string(int_ret.value) };
+		}
+		else if (int_ret.error == error_t::out_of_range)
+		{
+			if constexpr (NoThrow)
 			{
-				strm.putback(ch);
-				break;
+				return { value_type::out_of_range, {}, {} };
 			}
+			else
+				throw parsing_error{ "Integer value out of storable range\n"s, };
+		}
 
-			if (!valid_key_name_char(ch))
+		// the value is converted by toml_internal_data::value() when it's first read
+		if (lazy && float_string_in_range(str))
+			return { value_type::floating_point, {}, std::string{ str } };
+
+		const auto float_ret = parse_float_string(str);
+		if (float_ret.error == error_t::none)
+			return { value_type::floating_point, floating{ float_ret.value, float_ret.representation }, std::string{str} };
+		else if (float_ret.error == error_t::out_of_range)
+		{
+			if constexpr (NoThrow)
 			{
-				strm.putback(ch);
-				return {};
+				return { value_type::out_of_range, {}, {} };
 			}
-
-			out.push_back(ch);
+			else
+				throw parsing_error{ "Foating point value outside storable range.\n"s };
 		}
 
-		return out;
-	}
-
-	// Defined in another_toml/string_util.cpp
-	template<bool NoThrow, bool SurrogatePairs = false>
-	std::optional<std::string> replace_escape_chars(std::string_view);
-
-	extern template std::optional<std::string> replace_escape_chars<true>(std::string_view);
-	extern template std::optional<std::string> replace_escape_chars<false>(std::string_view);
 
-	// Replace control chars with the unicode replacement char
-	// 's' is a string_view containing a grapheme
-	std::string_view block_control(std::string_view s) noexcept
-	{
-		if (empty(s) || s[0] < 0x20)
-			return "\ufffd"sv;
+		const auto ret = parse_date_time_ex<NoThrow>(str, errors);
+		return std::visit([str](auto&& val)->get_value_type_ret {
+			using T = std::decay_t<decltype(val)>;
+		if constexpr (std::is_same_v<date_time, T>)
+			return { value_type::date_time, val, std::string{str} };
+		else if constexpr (std::is_same_v<local_date_time, T>)
+			return { value_type::local_date_time, val, std::string{str} };
+		else if constexpr (std::is_same_v<date, T>)
+			return { value_type::local_date, val, std::string{str} };
+		else if constexpr (std::is_same_v<time, T>)
+			return { value_type::local_time, val, std::string{str} };
 		else
-			return s;
+			return { value_type::bad, {}, {} };
+		}, ret);
 	}
 
-	// used in parse_key_name to select the correct table type
-	template<bool Table>
-	struct table_type_constant : std::integral_constant<table_def_type, table_def_type::dotted> {};
-	template<>
-	struct table_type_constant<true> : std::integral_constant<table_def_type, table_def_type::header> {};
+	struct normal_tag_t {};
+	struct array_tag_t {};
+	struct inline_tag_t {};
 
-	template<bool NoThrow, bool Table = false>
-	static key_name parse_key_name(parser_state& strm, detail::toml_internal_data& d, std::size_t& key_char_begin)
+	// for parsing keywords, dates or numerical values
+	template<bool NoThrow, typename Tag>
+	static bool parse_unquoted_value(parser_state& strm, detail::toml_internal_data& toml_data)
 	{
-		auto name = std::optional<std::string>{};
-		auto parent = root_table;
-		if constexpr (!Table)
-		{
-			if(!empty(strm.stack))
-				parent = strm.stack.back();
-		}
+		auto out = std::string{};
+		auto ch = char{};
+		auto ch_index = strm.col;
+		auto eof = bool{};
+		const auto value_first = strm.strm.position();
+		const auto parent = strm.stack.back();
+		const auto parent_type = toml_data.tags[parent].type;
+		constexpr auto array = std::is_same_v<Tag, array_tag_t>;
+		constexpr auto inline_table = std::is_same_v<Tag, inline_tag_t>;
+		assert((parent_type == node_type::array) == array);
 
 		while (strm.strm.good())
 		{
-			// eof exception is given more context in the calling function.
-			auto [ch, eof] = strm.get_char<NoThrow>();
+			std::tie(ch, eof) = strm.get_char<NoThrow>();
 			if constexpr (NoThrow)
 			{
 				if (eof)
-				{
-					std::cerr << "Unexpected end-of-file in table/key name.\n";
-					print_error_string(strm, strm.col - 1, strm.col - 1, std::cerr);
-					insert_bad(d);
-					return {};
-				}
+					break;
 			}
 
-			if (whitespace(ch, strm))
-				continue;
+			if (ch == '#')
+			{
+				strm.putback(ch);
+				break;
+			}
 
-			if (ch == '=' || ch == ']')
+			if constexpr (array || inline_table)
 			{
-				if (!name)
+				if (ch == ',')
 				{
-					constexpr auto msg = "Missing name\n"sv;
-					const auto name_begin = strm.col < 2 ? 0 : strm.col - 2;
-					if constexpr (NoThrow)
-					{
-						std::cerr << msg;
-						insert_bad(d);
-						print_error_string(strm, name_begin, strm.col, std::cerr);
-						return {};
-					}
-					else
-					{
-						auto string = std::ostringstream{};
-						string << msg;
-						print_error_string(strm, name_begin, strm.col, string);
-						throw unexpected_character{ string.str(), strm.line, strm.col };
-					}
+					strm.putback(ch);
+					break;
 				}
+			}
 
-				strm.putback(ch);
-				break;
+			if constexpr (array)
+			{
+				if (ch == ']')
+				{
+					strm.putback(ch);
+					break;
+				}
 			}
 
-			if (ch == '\"')
+			if constexpr (inline_table)
 			{
-				if (name)
+				if (ch == '}')
 				{
-					constexpr auto msg = "Unexpected character in key name: \"\n";
+					strm.putback(ch);
+					break;
+				}
+
+				if (newline(strm, ch))
+				{
+					const auto write_error = [&strm, ch_index](std::ostream& o) {
+						o << "Unexpected newline in inline table value.\n"s;
+						print_error_string(strm, strm.col, strm.col, o);
+						return;
+						};
 
 					if constexpr (NoThrow)
 					{
-						std::cerr << msg;
-						print_error_string(strm, strm.col - 1, strm.col, std::cerr);
-						return {};
+						write_error(report_error(strm, parse_error_kind::parsing_error));
+						insert_bad(toml_data);
+						return false;
 					}
 					else
 					{
 						auto str = std::ostringstream{};
-						str << msg;
-						print_error_string(strm, strm.col - 1, strm.col, str);
-						throw unexpected_character{ str.str(), strm.line, strm.col };
-					}
-				}
-				name = get_quoted_str<NoThrow, true>(strm);
-				if constexpr (NoThrow)
-				{
-					if (!name)
-					{
-						insert_bad(d);
-						return {};
+						const auto line = strm.line, col = ch_index;
+						write_error(str);
+						throw parsing_error{ str.str(), line, col };
 					}
 				}
+			}
+			else if (newline(strm, ch))
+			{
+				strm.putback(ch);
+				break;
+			}
 
-				assert(name);
-				name = replace_escape_chars<NoThrow>(*name);
+			out.push_back(ch);
+		}
 
-				if (!name)
-				{
-					if constexpr (NoThrow)
-					{
-						insert_bad(d);
-						return {};
-					}
-				}
+		while (!empty(out) && (out.back() == '\t' || out.back() == ' '))
+			out.pop_back();
 
-				std::tie(ch, eof) = strm.get_char<NoThrow>();
-				if constexpr (NoThrow)
-				{
-					if (eof || ch != '\"')
-					{
-						std::cerr << "Unexpected end of quoted string: "s << name.value_or("\"\""s) << '\n';
-						insert_bad(d);
-						return {};
-					}
-				}
-				
-				continue;
+		if (empty(out))
+		{
+			const auto write_error = [&strm, ch_index](std::ostream& o) {
+				o << "A value was expected here.\n"s;
+				print_error_string(strm, ch_index, ch_index + 1, o);
+				return;
+			};
+
+			if constexpr (NoThrow)
+			{
+				write_error(report_error(strm, parse_error_kind::parsing_error));
+				insert_bad(toml_data);
+				return false;
 			}
-			else if(ch == '\'')
+			else
 			{
-				if (name)
+				auto str = std::ostringstream{};
+				const auto line = strm.line, col = ch_index;
+				write_error(str);
+				throw parsing_error{ str.str(), line, col };
+			}
+		}
+
+		try
+		{
+			auto [type, value, string] = get_value_type<NoThrow>(out, strm.lazy_values, *strm.errors);
+		
+			if constexpr (NoThrow)
+			{
+				if (type == value_type::bad)
 				{
-					// TODO: update error invalid/key/newline-5
-					if constexpr (NoThrow)
-					{
-						std::cerr << "Illigal character in name: \'\n";
-						insert_bad(d);
-						return {};
-					}
-					else
-						throw unexpected_character{ "Illigal character in name: \'" };
+					report_error(strm, parse_error_kind::parsing_error) << "Error parsing value.\n";
+					print_error_string(strm, ch_index, strm.col, *strm.errors);
+					insert_bad(toml_data);
+					return false;
 				}
-				name = get_quoted_str<NoThrow, false>(strm);
-				if constexpr (NoThrow)
+
+				if (type == value_type::out_of_range)
 				{
-					if(!name)
+					const auto write_error = [&strm, ch_index](std::ostream& o) {
+						o << "Value is outside the range this type can store.\n"s;
+						print_error_string(strm, ch_index, strm.col, o);
+						return;
+					};
+
+					if constexpr (NoThrow)
 					{
-						insert_bad(d);
-						return {};
+						write_error(report_error(strm, parse_error_kind::parsing_error));
+						insert_bad(toml_data);
+						return false;
 					}
 				}
+			}
+
+			// out was read directly from the input, but number values are stored reformatted
+			const auto input_str = strm.borrow(value_first, value_first + size(out), string);
+			if (strm.handler)
+			{
+				report_value(*strm.handler, data(input_str) ? input_str : std::string_view{ string }, value);
+				return true;
+			}
+
+			return insert_child<NoThrow>(toml_data, parent, 
+				internal_node{
+					data(input_str) ? input_str : std::string_view{ string }, node_type::value,
+					type, std::move(value)
+				}, &strm) != bad_index;
+
+		}
+		catch (parsing_error& e)
+		{
+			auto str = std::ostringstream{};
+			str << e.what();
+			const auto line = strm.line, col = ch_index;
+			print_error_string(strm, col, strm.col, str);
+			throw parsing_error{ str.str(), line, col };
+		}
+	}
+
+	// valid_utf8 is set to false if the string contains non-ASCII characters
+	// that haven't been checked, the caller must validate the string
+	template<bool NoThrow, bool DoubleQuote>
+	static std::optional<std::string> multiline_string(parser_state& strm, bool& valid_utf8)
+	{
+		constexpr char quote_char = DoubleQuote ? '\"' : '\'';
+
+		// opening quotes have already been collected
+		auto [ch, eof] = strm.get_char<NoThrow>();
+		if constexpr (NoThrow)
+		{
+			if (eof)
+				return {};
+		}
+
+		// consume the first newline after '''/"""
+		if (newline(strm, ch))
+			strm.nextline();
+		else
+			strm.putback(ch);
 
-				std::tie(ch, eof) = strm.get_char<NoThrow>();
-				if constexpr (NoThrow)
-				{
-					if (eof || ch!= '\'')
-					{
-						insert_bad(d);
-						return{};
-					}
-				}
-				
-				continue;
+		auto str = std::string{};
+
+		while (strm.strm.good())
+		{
+			// a run of quotes is checked for the end of the string by the character after it
+			if (empty(str) || str.back() != quote_char)
+				str.append(strm.read_ordinary_chars<quote_char, '\\'>());
+
+			std::tie(ch, eof) = strm.get_char<NoThrow>();
+			if constexpr (NoThrow)
+			{
+				if (eof)
+					return {};
 			}
-			else if (ch == '.')
+
+			// implements '\' behaviour for double quoted strings
+			if constexpr (DoubleQuote)
 			{
-				if (!name)
+				if(ch == '\\')
 				{
-					constexpr auto msg = "Missing name\n"sv;
-					const auto name_begin = strm.col < 2 ? 0 : strm.col - 2;
-					if constexpr (NoThrow)
-					{
-						insert_bad(d);
-						std::cerr << msg;
-						print_error_string(strm, name_begin, strm.col, std::cerr);
-						return {};
-					}
-					else
+					auto peek = strm.strm.peek();
+					if (peek == '\\')
 					{
-						auto string = std::ostringstream{};
-						string << msg;
-						print_error_string(strm, name_begin, strm.col, string);
-						throw unexpected_character{ string.str(), strm.line, strm.col };
+						strm.ignore();
+						str += "\\\\"s;
+						continue;
 					}
-				}
-				else
-				{
-					auto child = find_child(d, parent, *name);
-					
-					if (child == bad_index)
-						child = insert_child_table<NoThrow>(parent, std::move(*name), d, table_type_constant<Table>::value);
-					else if(auto& c = d.nodes[child]; 
-						c.type == node_type::array_tables)
+
+					if (peek == '\n' ||
+						peek == ' ' ||
+						peek == '\t')
 					{
-						if constexpr (!Table)
+						const auto line = strm.line;
+						while (strm.strm.good())
 						{
-							const auto write_error = [&strm, &c](std::ostream& o) {
-								const auto msg = "Cannot use a dotted name to add a key to a table array.\n";
-								const auto name_end = strm.col - 1;
-								const auto name_beg = name_end - size(c.name);
-								o << msg;
-								print_error_string(strm, name_beg, name_end, o);
-								return;
-							};
-
+							std::tie(ch, eof) = strm.get_char<NoThrow>();
 							if constexpr (NoThrow)
 							{
-								write_error(std::cerr);
-								insert_bad(d);
-								return {};
+								if (eof)
+									return {};
+							}
+
+							if (whitespace(ch, strm))
+							{
+								; // do nothing
 							}
+							else if (newline(strm, ch))
+								strm.nextline();
 							else
 							{
-								auto string = std::ostringstream{};
-								write_error(string);
-								throw parsing_error{ string.str(), strm.line, strm.col };
+								strm.putback(ch);
+								break;
 							}
 						}
 
-						child = c.child;
-						while (true)
-						{
-							auto* node = &d.nodes[child];
-							if (node->next == bad_index)
-								break;
-							child = node->next;
-						}
-					}
-					else if (c.closed && c.table_type == table_def_type::header)
-					{
-						if constexpr(!Table)
+						if (line == strm.line)
 						{
-							const auto write_error = [&strm, &c](std::ostream& o) {
-								const auto msg = "Attempted to add to a previously defined table: \"" + c.name +
-									"\" using dotted keys.\n"s;
-								const auto name_end = strm.col - 1;
-								const auto name_beg = name_end - size(c.name);
-								o << msg;
-								print_error_string(strm, name_beg, name_end, o);
-								return;
+							const auto print_error = [&strm, ch](std::ostream& o) {
+								o << "Illigal character following '\\' line break in multiline string: \'"s << ch << "\'.\n"s;
+								print_error_string(strm, strm.col - 1, strm.col, o);
 							};
 
 							if constexpr (NoThrow)
 							{
-								write_error(std::cerr);
-								insert_bad(d);
+								print_error(report_error(strm, parse_error_kind::unexpected_character));
 								return {};
 							}
 							else
 							{
-								auto string = std::ostringstream{};
-								write_error(string);
-								throw duplicate_element{ string.str(), strm.line, strm.col, c.name };
+								const auto line = strm.line,
+									col = strm.col;
+								auto str = std::ostringstream{};
+								print_error(str);
+								throw unexpected_character{ str.str(), line, col };
 							}
 						}
-						// fall out of if
+
+						continue;
 					}
-					else if (!(c.type == node_type::table || c.type == node_type::array_tables))
-					{
-						const auto write_error = [&strm, &c](std::ostream& o) {
-							const auto msg = "Attempted to redefine \""s + c.name +
-								"\" as a table using dotted keys. Was previously defined as: \""s +
-								to_string(c.type) + "\".\n"s;
-							const auto name_end = strm.col - 1;
-							const auto name_beg = name_end - size(c.name);
-							o << msg;
-							print_error_string(strm, name_beg, name_end, o);
-							return;
-						};
+				} // ! '\'
+			} // !doublequote
 
-						if constexpr (NoThrow)
-						{
-							write_error(std::cerr);
-							insert_bad(d);
-							return {};
-						}
-						else
-						{
-							auto string = std::ostringstream{};
-							write_error(string);
-							throw duplicate_element{ string.str(), strm.line, strm.col, c.name };
-						}
+			if (size(str) > 2)
+			{
+				auto rb = rbegin(str);
+				const auto re = rend(str);
+				while (rb != re && *rb == quote_char)
+				{
+					if constexpr (DoubleQuote)
+					{
+						auto next = std::next(rb);
+						if (next != re && *next == '\\')
+							break;
 					}
 
-					parent = child;
-					name = {};
-					key_char_begin = strm.col;
-					continue;
+					++rb;
 				}
-			}
 
-			const auto handle_character_error = [&strm, &d] {
-				// eof exception is given more context in the calling function.
-				const auto [ch, eof] = strm.get_char<NoThrow>();
-				if constexpr (NoThrow)
+				const auto dist = distance(rbegin(str), rb) + (ch == quote_char ? 1 : 0);
+				const auto end = dist > 2 && dist < 6;
+				if (end && ch != quote_char)
 				{
-					if (eof)
+					strm.putback(ch);
+					return std::string{ begin(str), next(begin(str), size(str) - 3) };
+				}
+				else if (dist > 5 && ch != quote_char)
+				{
+					auto seq_begin = strm.col - distance(rbegin(str), rb) - 1;
+					const auto print_error = [&strm, seq_begin](std::ostream& o) {
+						o << "Invalid sequence in multiline string.\n"s;
+						print_error_string(strm, seq_begin, error_current_col, o);
+					};
+
+					if constexpr (NoThrow)
 					{
-						std::cerr << "Unexpected end-of-file in table/key name.\n";
-						print_error_string(strm, strm.col - 1, strm.col, std::cerr);
-						insert_bad(d);
-						return;
+						print_error(report_error(strm, parse_error_kind::parsing_error));
+						return {};
+					}
+					else
+					{
+						const auto line = strm.line,
+							col = strm.col;
+						auto str = std::ostringstream{};
+						print_error(str);
+						throw parsing_error{ str.str(), line, col };
 					}
 				}
+			}
 
-				const auto ch_index = strm.col - 1;
-				const auto print_error = [&strm, ch_index](std::ostream& o) {
-					parse_line(strm);
-					const auto str = std::string_view{ &strm.toml_file[ch_index] };
-					auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
-					o << "Unexpected character found in table/key name: \'"s <<
-						block_control(*begin(graph_rng)) <<
-						"\'.\n"s;
-					print_error_string(strm, ch_index, ch_index + 1, o);
+			if (invalid_string_chars(ch) && ch != '\n')
+			{
+				const auto print_error = [&strm, ch](std::ostream& o) {
+					o << "Unexpected character in multiline string: \'"s;
+					print_invalid_chars(ch, o);
+					o << "\'.\n"s;
+					print_error_string(strm, strm.col - 1, strm.col, o);
 				};
 
 				if constexpr (NoThrow)
 				{
-					print_error(std::cerr);
-					insert_bad(d);
-					return;
+					print_error(report_error(strm, parse_error_kind::unexpected_character));
+					return {};
 				}
 				else
 				{
 					const auto line = strm.line,
-						col = ch_index;
+						col = strm.col;
 					auto str = std::ostringstream{};
 					print_error(str);
 					throw unexpected_character{ str.str(), line, col };
 				}
-			};
-
-			if (!name)
-			{
-				auto str = get_unquoted_name(strm, ch);
-				if (str)
-					name = str;
-				else
-				{
-					handle_character_error();
-					return {};
-				}
-			}
-			else
-			{
-				strm.putback();
-				strm.putback();
-				handle_character_error();
-				return {};
 			}
-		}
-
-		return { parent, name };
-	}
-
-	using get_value_type_ret = std::tuple<value_type, variant_t, std::string>;
-
-	// access func from string_util.cpp
-	std::string remove_underscores(std::string_view sv);
 
-	template<bool NoThrow>
-	extern std::variant<std::monostate, date, time, date_time, local_date_time> parse_date_time_ex(std::string_view str) noexcept(NoThrow);
+			if (is_unicode_byte(ch))
+				valid_utf8 = false;
+			str.push_back(ch);
+		}
 
-	template<bool NoThrow>
-	static get_value_type_ret get_value_type(std::string_view str) noexcept(NoThrow)
-	{
-		if (empty(str))
+		// TODO: This should be unexpected error while parsing multiline string
+		if constexpr (NoThrow)
 		{
-			if constexpr (NoThrow)
-			{
-				return { value_type::bad, {}, {} };
-			}
-			else
-				throw parsing_error{ "Error parsing value.\n" };
+			return {};
 		}
+		else
+			throw parsing_error{ "Error parsing multiline string"s };
+	}
 
-		//keywords
-		//	true, false
-		if (str == "true"sv)
-			return { value_type::boolean, true, std::string{ str } };
-		if (str == "false"sv)
-			return { value_type::boolean, false, std::string{ str } };
-		
-		const auto beg = begin(str);
-		const auto end = std::end(str);
-
-		// matches all valid integers with optional underscores after the first digit
-		//  -normal digits(with no leading 0)
-		//	-hex
-		//	-binary
-		//	-oct
-		// doesn't check for min/max value
-		constexpr auto int_reg =
-			R"(^[\+\-]?[1-9]+(_?([\d])+)*$|^0x[\dA-Fa-f]+(_?[\dA-Fa-f]+)*|0b[01]+(_?[01]+)*|0o[0-7]+(_?([0-7])+)*|^[\+\-]?0$)";
-
-		if (std::regex_match(beg, end, std::regex{ int_reg }))
+	template<bool NoThrow, bool DoubleQuote>
+	static bool parse_str_value(parser_state& strm, detail::toml_internal_data& toml_data)
+	{
+		constexpr char quote_char = DoubleQuote ? '\"' : '\'';
+		auto str = std::optional<std::string>{};
+		auto input_str = std::string_view{};
+		if (strm.strm.peek() == quote_char)
 		{
-			auto string = remove_underscores(str);
-			
-			auto base = 10;
-			auto base_en = int_base::dec;
-			if (size(string) > 1)
+			//quoted str was empty, or start of multiline string
+			strm.ignore();
+			if (strm.strm.peek() == quote_char)
 			{
-				const auto base_chars = std::string_view{ &*begin(string), 2 };
-				if (base_chars == "0x"sv)
+				const auto str_start = strm.col - 2;
+				strm.ignore();
+				const auto str_first = strm.strm.position();
+				auto valid_utf8 = true;
+				str = multiline_string<NoThrow, DoubleQuote>(strm, valid_utf8);
+				if (!str)
 				{
-					base = 16;
-					base_en = int_base::hex;
+					// error already reported in multiline_string
+					return false;
 				}
-				else if (base_chars == "0b"sv)
+				else if (!valid_utf8 && !uni::is_valid_utf8(*str))
 				{
-					base = 2;
-					base_en = int_base::bin;
+					constexpr auto msg = "Invalid unicode code points in multiline string.\n"sv;
+					if constexpr (NoThrow)
+					{
+						report_error(strm, parse_error_kind::unicode_error) << msg;
+						print_error_string(strm, str_start, strm.col, *strm.errors);
+						insert_bad(toml_data);
+						return false;
+					}
+					else
+					{
+						auto string = std::ostringstream{};
+						string << msg;
+						print_error_string(strm, str_start, strm.col, string);
+						throw unicode_error{ string.str(), strm.line, str_start };
+					}
 				}
-				else if (base_chars == "0o"sv)
+
+				if constexpr (DoubleQuote)
 				{
-					base = 8;
-					base_en = int_base::oct;
+					try
+					{
+						if (!replace_escape_chars<NoThrow>(*str, *strm.errors))
+						{
+							print_error_string(strm, str_start, strm.col, report_error(strm, parse_error_kind::unicode_error));
+							insert_bad(toml_data);
+							return false;
+						}
+					}
+					catch (const unicode_error& e)
+					{
+						auto string = std::ostringstream{};
+						string << e.what() << '\n';
+						print_error_string(strm, str_start, strm.col, string);
+						throw unicode_error{ string.str(), strm.line, strm.col };
+					}
 				}
 
-				if (base != 10)
-					string.erase(0, 2);
+				// the closing quotes have been consumed,
+				// the first newline may have been skipped
+				const auto str_last = strm.strm.position() - 3;
+				if (size(*str) <= static_cast<std::size_t>(str_last - str_first))
+					input_str = strm.borrow(str_last - size(*str), str_last, *str);
 			}
-			
-			//convert to int
-			auto int_val = std::int64_t{};
-			const auto string_end = &string[0] + size(string);
-			auto ret = std::from_chars(&string[0], string_end, int_val, base);
-
-			if (ret.ptr == string_end)
+			else
+				str = std::string{};
+		}
+		else
+		{
+			//start normal quote str
+			const auto str_start = strm.col - 1;
+			const auto str_first = strm.strm.position();
+			str = get_quoted_str<NoThrow, DoubleQuote>(strm);
+			if constexpr (NoThrow)
 			{
-				//str = std::to_string(int_val);
-				return { value_type::integer, detail::integral{int_val, base_en}, std::to_string(int_val) };
+				if (!str)
+				{
+					insert_bad(toml_data);
+					return false;
+				}
 			}
-			else if (ret.ec == std::errc::invalid_argument)
+
+			if constexpr (DoubleQuote)
 			{
-				if constexpr (NoThrow)
+				try
 				{
-					return { value_type::bad, {}, {} };
+					if (!replace_escape_chars<NoThrow>(*str, *strm.errors))
+					{
+						print_error_string(strm, str_start, strm.col + 1, report_error(strm, parse_error_kind::unicode_error));
+						insert_bad(toml_data);
+						return false;
+					}
 				}
-				else
+				catch (const unicode_error& e)
 				{
-					const auto pos = std::distance(data(str), ret.ptr);
-					assert(pos >= 0);
-					throw parsing_error{ "Failed to parse integer value\n"s, {}, static_cast<std::size_t>(pos) };
+					auto string = std::ostringstream{};
+					string << e.what() << '\n';
+					print_error_string(strm, str_start, strm.col + 1, string);
+					throw unicode_error{ string.str(), strm.line, strm.col};
 				}
 			}
-			else if (ret.ec == std::errc::result_out_of_range)
+
+			input_str = strm.borrow(str_first, strm.strm.position(), *str);
+
+			if (strm.strm.peek() == quote_char)
+				strm.ignore();
+			else
 			{
+				constexpr auto msg = "Unexpected error in quoted string.\n";
 				if constexpr (NoThrow)
 				{
-					return { value_type::out_of_range, {}, {} };
+					report_error(strm, parse_error_kind::unicode_error) << msg;
+					print_error_string(strm, str_start, strm.col + 1, *strm.errors);
+					return false;
 				}
 				else
-					throw parsing_error{ "Integer value out of storable range\n"s, };
-			}
-		}
-		
-		using error_t = parse_float_string_return::error_t;
-		const auto float_ret = parse_float_string(str);
-		if (float_ret.error == error_t::none)
-			return { value_type::floating_point, floating{ float_ret.value, float_ret.representation }, std::string{str} };
-		else if (float_ret.error == error_t::out_of_range)
-		{
-			if constexpr (NoThrow)
-			{
-				return { value_type::out_of_range, {}, {} };
+				{
+					auto string = std::ostringstream{};
+					print_error_string(strm, str_start, strm.col + 1, string);
+					throw unicode_error{ string.str(), strm.line, strm.col };
+				}
 			}
-			else
-				throw parsing_error{ "Foating point value outside storable range.\n"s };
 		}
 
-
-		const auto ret = parse_date_time_ex<NoThrow>(str);
-		return std::visit([str](auto&& val)->get_value_type_ret {
-			using T = std::decay_t<decltype(val)>;
-		if constexpr (std::is_same_v<date_time, T>)
-			return { value_type::date_time, val, std::string{str} };
-		else if constexpr (std::is_same_v<local_date_time, T>)
-			return { value_type::local_date_time, val, std::string{str} };
-		else if constexpr (std::is_same_v<date, T>)
-			return { value_type::local_date, val, std::string{str} };
-		else if constexpr (std::is_same_v<time, T>)
-			return { value_type::local_time, val, std::string{str} };
+		assert(!strm.stack.empty());
+		assert(str);
+		const auto value = data(input_str) ? input_str : std::string_view{ *str };
+		if (strm.handler)
+			report_value(*strm.handler, value, string_t{ !DoubleQuote });
 		else
-			return { value_type::bad, {}, {} };
-		}, ret);
-	}
+			insert_child<NoThrow>(toml_data, strm.stack.back(), internal_node{ value, node_type::value, value_type::string, string_t{ !DoubleQuote } }, &strm);
+		strm.last_token = token_type::value;
 
-	struct normal_tag_t {};
-	struct array_tag_t {};
-	struct inline_tag_t {};
+		return true;
+	}
 
-	// for parsing keywords, dates or numerical values
-	template<bool NoThrow, typename Tag>
-	static bool parse_unquoted_value(parser_state& strm, detail::toml_internal_data& toml_data)
+	// consumes the next endline if present
+	template<bool NoThrow>
+	static bool parse_comment(parser_state& strm) noexcept(NoThrow)
 	{
-		auto out = std::string{};
-		auto ch = char{};
-		auto ch_index = strm.col;
-		auto eof = bool{};
-		const auto parent = strm.stack.back();
-		const auto parent_type = toml_data.nodes[parent].type;
-		constexpr auto array = std::is_same_v<Tag, array_tag_t>;
-		constexpr auto inline_table = std::is_same_v<Tag, inline_tag_t>;
-		assert((parent_type == node_type::array) == array);
-
 		while (strm.strm.good())
 		{
-			std::tie(ch, eof) = strm.get_char<NoThrow>();
-			if constexpr (NoThrow)
-			{
-				if (eof)
-					break;
-			}
-
-			if (ch == '#')
-			{
-				strm.putback(ch);
+			strm.read_ordinary_chars();
+			auto [ch, eof] = strm.get_char<true>();
+			if (eof)
 				break;
-			}
 
-			if constexpr (array || inline_table)
+			if (newline(strm, ch))
 			{
-				if (ch == ',')
-				{
-					strm.putback(ch);
-					break;
-				}
+				strm.nextline();
+				break;
 			}
 
-			if constexpr (array)
+			if (comment_forbidden_char(ch))
 			{
-				if (ch == ']')
-				{
-					strm.putback(ch);
-					break;
-				}
-			}
+				const auto write_error = [&strm](std::ostream& o) {
+					o << "Forbidden character in comment: \'";
+					const auto ch_index = strm.col - 1;
+					parse_line(strm);
+					const auto str = strm.current_line().substr(ch_index);
+					auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
+					o << block_control(*begin(graph_rng)) << "\'.\n";
+					print_error_string(strm, ch_index, ch_index + 1, o);
+					return;
+				};
 
-			if constexpr (inline_table)
-			{
-				if (ch == '}')
+				if constexpr (NoThrow)
 				{
-					strm.putback(ch);
-					break;
+					write_error(report_error(strm, parse_error_kind::unexpected_character));
+					return false;
 				}
-
-				if (newline(strm, ch))
+				else
 				{
-					const auto write_error = [&strm, ch_index](std::ostream& o) {
-						o << "Unexpected newline in inline table value.\n"s;
-						print_error_string(strm, strm.col, strm.col, o);
-						return;
-						};
-
-					if constexpr (NoThrow)
-					{
-						write_error(std::cerr);
-						insert_bad(toml_data);
-						return false;
-					}
-					else
-					{
-						auto str = std::ostringstream{};
-						const auto line = strm.line, col = ch_index;
-						write_error(str);
-						throw parsing_error{ str.str(), line, col };
-					}
+					auto str = std::ostringstream{};
+					const auto line = strm.line, col = strm.col - 1;
+					write_error(str);
+					throw unexpected_character{ str.str(), line, col };
 				}
 			}
-			else if (newline(strm, ch))
-			{
-				strm.putback(ch);
-				break;
-			}
-
-			out.push_back(ch);
-		}
-
-		while (!empty(out) && (out.back() == '\t' || out.back() == ' '))
-			out.pop_back();
-
-		if (empty(out))
-		{
-			const auto write_error = [&strm, ch_index](std::ostream& o) {
-				o << "A value was expected here.\n"s;
-				print_error_string(strm, ch_index, ch_index + 1, o);
-				return;
-			};
-
-			if constexpr (NoThrow)
-			{
-				write_error(std::cerr);
-				insert_bad(toml_data);
-				return false;
-			}
-			else
-			{
-				auto str = std::ostringstream{};
-				const auto line = strm.line, col = ch_index;
-				write_error(str);
-				throw parsing_error{ str.str(), line, col };
-			}
-		}
 
-		try
-		{
-			auto [type, value, string] = get_value_type<NoThrow>(out);
-		
-			if constexpr (NoThrow)
+			if (is_unicode_byte(ch))
 			{
-				if (type == value_type::bad)
-				{
-					std::cerr << "Error parsing value.\n";
-					print_error_string(strm, ch_index, strm.col, std::cerr);
-					insert_bad(toml_data);
-					return false;
-				}
-
-				if (type == value_type::out_of_range)
+				const auto ch_index = strm.col - 1;
+				auto u_ch = parse_unicode_char(ch, strm);
+				if (u_ch == unicode_error_char)
 				{
+					// TODO: print escaped character
 					const auto write_error = [&strm, ch_index](std::ostream& o) {
-						o << "Value is outside the range this type can store.\n"s;
-						print_error_string(strm, ch_index, strm.col, o);
+						o << "Invalid unicode character(s) in stream: \'\uFFFD.\'\n";
+						print_error_string(strm, ch_index, error_current_col, o);
 						return;
 					};
 
 					if constexpr (NoThrow)
 					{
-						write_error(std::cerr);
-						insert_bad(toml_data);
+						write_error(report_error(strm, parse_error_kind::invalid_unicode_char));
 						return false;
 					}
+					else
+					{
+						auto str = std::ostringstream{};
+						const auto line = strm.line, col = strm.col - 1;
+						write_error(str);
+						throw invalid_unicode_char{ str.str(), line, col };
+					}
 				}
 			}
-
-			return insert_child<NoThrow>(toml_data, parent, 
-				internal_node{
-					std::move(string), node_type::value,
-					type, std::move(value)
-				}) != bad_index;
-
-		}
-		catch (parsing_error& e)
-		{
-			auto str = std::ostringstream{};
-			str << e.what();
-			const auto line = strm.line, col = ch_index;
-			print_error_string(strm, col, strm.col, str);
-			throw parsing_error{ str.str(), line, col };
 		}
-	}
 
-	template<bool NoThrow, bool DoubleQuote>
-	static std::optional<std::string> multiline_string(parser_state& strm)
-	{
-		constexpr char quote_char = DoubleQuote ? '\"' : '\'';
+		return true;
+	}
 
-		// opening quotes have already been collected
-		auto [ch, eof] = strm.get_char<NoThrow>();
-		if constexpr (NoThrow)
-		{
-			if (eof)
-				return {};
-		}
+	template<bool NoThrow, typename Tag>
+	static bool parse_value(parser_state&, detail::toml_internal_data&);
 
-		// consume the first newline after '''/"""
-		if (newline(strm, ch))
-			strm.nextline();
-		else
-			strm.putback(ch);
+	template<bool NoThrow>
+	static bool parse_array(parser_state& strm, detail::toml_internal_data& toml_data)
+	{
+		assert(!empty(strm.stack));
+		auto arr = insert_child<NoThrow>(toml_data, strm.stack.back(), internal_node{
+				{}, node_type::array
+			}, &strm);
 
-		auto str = std::string{};
+		strm.last_token = token_type::array;
+		strm.stack.emplace_back(arr);
+		if (strm.handler)
+			strm.handler->begin_array();
 
 		while (strm.strm.good())
 		{
-			std::tie(ch, eof) = strm.get_char<NoThrow>();
+			auto [ch, eof] = strm.get_char<NoThrow>();
 			if constexpr (NoThrow)
 			{
 				if (eof)
-					return {};
-			}
-
-			// implements '\' behaviour for double quoted strings
-			if constexpr (DoubleQuote)
-			{
-				if(ch == '\\')
 				{
-					auto peek = strm.strm.peek();
-					if (peek == '\\')
-					{
-						strm.ignore();
-						str += "\\\\"s;
-						continue;
-					}
-
-					if (peek == '\n' ||
-						peek == ' ' ||
-						peek == '\t')
-					{
-						const auto line = strm.line;
-						while (strm.strm.good())
-						{
-							std::tie(ch, eof) = strm.get_char<NoThrow>();
-							if constexpr (NoThrow)
-							{
-								if (eof)
-									return {};
-							}
-
-							if (whitespace(ch, strm))
-							{
-								; // do nothing
-							}
-							else if (newline(strm, ch))
-								strm.nextline();
-							else
-							{
-								strm.putback(ch);
-								break;
-							}
-						}
-
-						if (line == strm.line)
-						{
-							const auto print_error = [&strm, ch](std::ostream& o) {
-								o << "Illigal character following '\\' line break in multiline string: \'"s << ch << "\'.\n"s;
-								print_error_string(strm, strm.col - 1, strm.col, o);
-							};
-
-							if constexpr (NoThrow)
-							{
-								print_error(std::cerr);
-								return {};
-							}
-							else
-							{
-								const auto line = strm.line,
-									col = strm.col;
-								auto str = std::ostringstream{};
-								print_error(str);
-								throw unexpected_character{ str.str(), line, col };
-							}
-						}
+					report_error(strm, parse_error_kind::unexpected_eof) << "Encountered an unexpected eof.\n";
+					print_error_string(strm, strm.col, error_entire_line, *strm.errors);
+					return false;
+				}
+			}
 
-						continue;
-					}
-				} // ! '\'
-			} // !doublequote
+			if (whitespace(ch, strm))
+				continue;
 
-			if (size(str) > 2)
+			if (newline(strm, ch))
 			{
-				auto rb = rbegin(str);
-				const auto re = rend(str);
-				while (rb != re && *rb == quote_char)
-				{
-					if constexpr (DoubleQuote)
-					{
-						auto next = std::next(rb);
-						if (next != re && *next == '\\')
-							break;
-					}
-
-					++rb;
-				}
+				strm.nextline();
+				continue;
+			}
 
-				const auto dist = distance(rbegin(str), rb) + (ch == quote_char ? 1 : 0);
-				const auto end = dist > 2 && dist < 6;
-				if (end && ch != quote_char)
-				{
-					strm.putback(ch);
-					return std::string{ begin(str), next(begin(str), size(str) - 3) };
-				}
-				else if (dist > 5 && ch != quote_char)
+			if (ch == ']')
+			{
+				strm.last_token = token_type::array_end;
+				strm.stack.pop_back();
+				if (strm.handler)
+					strm.handler->end_array();
+				return true;
+			}
+			
+			if (ch == ',')
+			{
+				if (strm.last_token != token_type::value)
 				{
-					auto seq_begin = strm.col - distance(rbegin(str), rb) - 1;
-					const auto print_error = [&strm, seq_begin](std::ostream& o) {
-						o << "Invalid sequence in multiline string.\n"s;
-						print_error_string(strm, seq_begin, error_current_col, o);
-					};
-
 					if constexpr (NoThrow)
 					{
-						print_error(std::cerr);
-						return {};
+						report_error(strm, parse_error_kind::unexpected_character) << "Unexpected comma in array element.\n";
+						print_error_string(strm, strm.col, error_entire_line, *strm.errors);
+						return false;
 					}
 					else
 					{
-						const auto line = strm.line,
-							col = strm.col;
 						auto str = std::ostringstream{};
-						print_error(str);
-						throw parsing_error{ str.str(), line, col };
+						const auto line = strm.line, col = strm.col;
+						str << "Unexpected comma in array element.\n";
+						print_error_string(strm, col - 1, col, str);
+						throw unexpected_character{ str.str(), strm.line, strm.col};
 					}
 				}
+
+				strm.last_token = token_type::comma;
+				continue;
 			}
 
-			if (invalid_string_chars(ch) && ch != '\n')
+			if (ch == '#')
 			{
-				const auto print_error = [&strm, ch](std::ostream& o) {
-					o << "Unexpected character in multiline string: \'"s;
-					print_invalid_chars(ch, o);
-					o << "\'.\n"s;
-					print_error_string(strm, strm.col - 1, strm.col, o);
-				};
-
-				if constexpr (NoThrow)
-				{
-					print_error(std::cerr);
-					return {};
-				}
-				else
+				if (!parse_comment<NoThrow>(strm))
 				{
-					const auto line = strm.line,
-						col = strm.col;
-					auto str = std::ostringstream{};
-					print_error(str);
-					throw unexpected_character{ str.str(), line, col };
+					if constexpr (NoThrow)
+					{
+						insert_bad(toml_data);
+						return false;
+					}
 				}
+
+				continue;
 			}
 
-			str.push_back(ch);
+			//get value
+			strm.putback(ch);
+			if (!parse_value<NoThrow, array_tag_t>(strm, toml_data))
+				return false;
+			
+			continue;
 		}
 
-		// TODO: This should be unexpected error while parsing multiline string
 		if constexpr (NoThrow)
 		{
-			return {};
+			report_error(strm, parse_error_kind::toml_error) << "Stream error while parsing array\n";
+			return false;
 		}
-		else
-			throw parsing_error{ "Error parsing multiline string"s };
+		else 
+			throw toml_error{ "Stream error while parsing array"s };
 	}
 
-	template<bool NoThrow, bool DoubleQuote>
-	static bool parse_str_value(parser_state& strm, detail::toml_internal_data& toml_data)
+	template<bool NoThrow>
+	static bool parse_inline_table(parser_state& strm, toml_internal_data& toml_data)
 	{
-		constexpr char quote_char = DoubleQuote ? '\"' : '\'';
-		auto str = std::optional<std::string>{};
-		if (strm.strm.peek() == quote_char)
+		// push back an inline table
+		assert(!empty(strm.stack));
+		const auto parent = strm.stack.back();
+		assert(toml_data.tags[parent].type == node_type::key || toml_data.tags[parent].type == node_type::array);
+		const auto table = insert_child<NoThrow>(toml_data, parent, internal_node{ toml_data.names[parent], node_type::inline_table }, &strm);
+		strm.stack.emplace_back(table);
+		strm.last_token = token_type::inline_table;
+		if (strm.handler)
+			strm.handler->begin_inline_table();
+		while (strm.strm.good())
 		{
-			//quoted str was empty, or start of multiline string
-			strm.ignore();
-			if (strm.strm.peek() == quote_char)
+			auto [ch, eof] = strm.get_char<NoThrow>();
+			if constexpr (NoThrow)
 			{
-				const auto str_start = strm.col - 2;
-				strm.ignore();
-				str = multiline_string<NoThrow, DoubleQuote>(strm);
-				if (!str)
+				if (eof)
+					return false;
+			}
+
+			if (whitespace(ch, strm))
+				continue;
+
+			if (newline(strm, ch))
+			{
+				const auto write_error = [&strm](std::ostream& o) {
+					o << "Illigal newline in inline table.\n";
+					print_error_string(strm, strm.col, strm.col, o);
+					return;
+				};
+
+				if constexpr (NoThrow)
+				{
+					write_error(report_error(strm, parse_error_kind::unexpected_character));
+					insert_bad(toml_data);
+					return false;
+				}
+				else
 				{
-					// error already reported in multiline_string
-					return false;
+					auto str = std::ostringstream{};
+					const auto line = strm.line, col = strm.col;
+					write_error(str);
+					throw unexpected_character{ str.str(), line, col };
 				}
-				else if (!uni::is_valid_utf8(*str))
+			}
+
+			if (ch == '}')
+			{
+				if (strm.last_token == token_type::comma)
 				{
-					constexpr auto msg = "Invalid unicode code points in multiline string.\n"sv;
+					const auto write_error = [&strm](std::ostream& o) {
+						o << "Trailing comma is forbidden in inline tables.\n"s;
+						print_error_string(strm, strm.col, strm.col, o);
+						return;
+					};
+
 					if constexpr (NoThrow)
 					{
-						std::cerr << msg;
-						print_error_string(strm, str_start, strm.col, std::cerr);
+						write_error(report_error(strm, parse_error_kind::unexpected_character));
 						insert_bad(toml_data);
 						return false;
 					}
 					else
 					{
-						auto string = std::ostringstream{};
-						string << msg;
-						print_error_string(strm, str_start, strm.col, string);
-						throw unicode_error{ string.str(), strm.line, str_start };
+						auto str = std::ostringstream{};
+						const auto line = strm.line, col = strm.col;
+						write_error(str);
+						throw unexpected_character{ str.str(), line, col };
 					}
 				}
 
-				if constexpr (DoubleQuote)
-				{
-					try
-					{
-						str = replace_escape_chars<NoThrow>(*str);
-						if (!str)
-						{
-							print_error_string(strm, str_start, strm.col, std::cerr);
-							insert_bad(toml_data);
-							return false;
-						}
-					}
-					catch (const unicode_error& e)
-					{
-						auto string = std::ostringstream{};
-						string << e.what() << '\n';
-						print_error_string(strm, str_start, strm.col, string);
-						throw unicode_error{ string.str(), strm.line, strm.col };
-					}
-				}
+				toml_data.tags[table].closed = true;
+				assert(table == strm.stack.back());
+				strm.stack.pop_back();
+				if (strm.handler)
+					strm.handler->end_inline_table();
+				return true;
 			}
-			else
-				str = std::string{};
-		}
-		else
-		{
-			//start normal quote str
-			const auto str_start = strm.col - 1;
-			str = get_quoted_str<NoThrow, DoubleQuote>(strm);
-			if constexpr (NoThrow)
+
+			if (const auto back = strm.last_token;
+				!(back == token_type::inline_table || back == token_type::comma))
 			{
-				if (!str)
+				const auto write_error = [&strm](std::ostream& o) {
+					o << "Expected comma or end of inline table.\n"s;
+					print_error_string(strm, strm.col + 1, error_entire_line, o);
+					return;
+				};
+
+				if constexpr (NoThrow)
 				{
+					write_error(report_error(strm, parse_error_kind::unexpected_character));
 					insert_bad(toml_data);
 					return false;
 				}
+				else
+				{
+					auto str = std::ostringstream{};
+					const auto line = strm.line, col = strm.col;
+					write_error(str);
+					throw unexpected_character{ str.str(), line, col };
+				}
 			}
 
-			if constexpr (DoubleQuote)
+			strm.putback(ch);
+			if (!parse_key_value<NoThrow, inline_tag_t>(strm, toml_data))
+				return false;
+
+			std::tie(ch, eof) = strm.get_char<NoThrow>();
+			if constexpr (NoThrow)
 			{
-				try
-				{
-					str = replace_escape_chars<NoThrow>(*str);
-					if (!str)
-					{
-						print_error_string(strm, str_start, strm.col + 1, std::cerr);
-						insert_bad(toml_data);
-						return false;
-					}
-				}
-				catch (const unicode_error& e)
-				{
-					auto string = std::ostringstream{};
-					string << e.what() << '\n';
-					print_error_string(strm, str_start, strm.col + 1, string);
-					throw unicode_error{ string.str(), strm.line, strm.col};
-				}
+				if (eof)
+					return false;
 			}
 
-			if (strm.strm.peek() == quote_char)
-				strm.ignore();
-			else
+			if(whitespace(ch, strm))
 			{
-				constexpr auto msg = "Unexpected error in quoted string.\n";
+				std::tie(ch, eof) = strm.get_char<NoThrow>();
 				if constexpr (NoThrow)
 				{
-					std::cerr << msg;
-					print_error_string(strm, str_start, strm.col + 1, std::cerr);
-					return false;
-				}
-				else
-				{
-					auto string = std::ostringstream{};
-					print_error_string(strm, str_start, strm.col + 1, string);
-					throw unicode_error{ string.str(), strm.line, strm.col };
+					if (eof)
+						return false;
 				}
 			}
-		}
 
-		assert(!strm.stack.empty());
-		assert(str);
-		insert_child<NoThrow>(toml_data, strm.stack.back(), internal_node{ std::move(*str), node_type::value, value_type::string, string_t{ !DoubleQuote } });
-		strm.token_stream.emplace_back(token_type::value);
+			//next must be ',' or '}'
+			if (ch == ',')
+			{
+				strm.last_token = token_type::comma;
+				continue;
+			}
+			strm.putback(ch);
+		}
 
 		return true;
 	}
 
-	// consumes the next endline if present
-	template<bool NoThrow>
-	static bool parse_comment(parser_state& strm) noexcept(NoThrow)
+	template<bool NoThrow, typename Tag>
+	static bool parse_key_value(parser_state& strm, toml_internal_data& toml_data)
 	{
-		while (strm.strm.good())
+		static_assert(std::is_same_v<Tag, normal_tag_t> || std::is_same_v<Tag, inline_tag_t>);
+		auto key_name_begin = strm.col;
+		auto key_str = key_name{};
+		// any table at or above this index was created by this key name
+		const auto first_new_node = toml_data.node_count();
+
+		try 
 		{
-			auto [ch, eof] = strm.get_char<true>();
-			if (eof)
-				break;
+			key_str = parse_key_name<NoThrow>(strm, toml_data, key_name_begin);
+		}
+		catch (const unexpected_eof& err)
+		{
+			auto str = std::ostringstream{};
+			str << "Unexpected end-of-file in table/key name.\n";
+			print_error_string(strm, strm.col - 1, strm.col, str);
 
-			if (newline(strm, ch))
+			throw unexpected_eof{ str.str(), err.line(), err.column() };
+		}
+
+		if constexpr (NoThrow)
+		{
+			if (!key_str.name)
+				return false;
+		}
+
+		auto [ch, eof] = strm.get_char<NoThrow>();
+
+		if constexpr (NoThrow)
+		{
+			if (eof)
 			{
-				strm.nextline();
-				break;
+				insert_bad(toml_data);
+				report_error(strm, parse_error_kind::parsing_error) << "Error getting key name\n"s;
+				return false;
 			}
+		}
 
-			if (comment_forbidden_char(ch))
+		// NOTE: if the key name function created one or more dotted table names
+		//		eg. t1.t2.t3.key_name
+		//		then we need to add all the new dotted table names to the open_tables list
+		//		tables that existed before this key are already in the list, skip them
+		//		so open_tables doesn't grow with every key in the table
+		if (key_str.parent >= first_new_node && toml_data.tags[key_str.parent].closed == false)
+		{
+			strm.open_tables.emplace_back(key_str.parent);
+			auto parent = detail::find_parent(toml_data, key_str.parent);
+			while (parent != bad_index && parent >= first_new_node)
 			{
-				const auto write_error = [&strm](std::ostream& o) {
-					o << "Forbidden character in comment: \'";
-					const auto ch_index = strm.col - 1;
-					parse_line(strm);
-					const auto str = std::string_view{ &strm.toml_file[ch_index] };
-					auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
-					o << block_control(*begin(graph_rng)) << "\'.\n";
-					print_error_string(strm, ch_index, ch_index + 1, o);
-					return;
-				};
+				const auto& n = toml_data.tags[parent];
+				if (n.closed == true || n.table_type != table_def_type::dotted)
+					break;
+				strm.open_tables.emplace_back(parent);
+				parent = detail::find_parent(toml_data, parent);
+			}
+		}
 
-				if constexpr (NoThrow)
+		// NOTE: key_str.name has already been checked by this point in parse_key_name
+		//		or just above in the NoThrow constexpr block
+		assert(key_str.name.has_value());
+		auto key = detail::internal_node{ key_str.view(), node_type::key };
+		try
+		{
+			const auto key_index = insert_child<NoThrow>(toml_data, key_str.parent, std::move(key), &strm);
+
+			if constexpr (NoThrow)
+			{
+				if (key_index == bad_index)
 				{
-					write_error(std::cerr);
+					strm.putback();
+					print_error_string(strm, key_name_begin, error_current_col, report_error(strm, parse_error_kind::duplicate_element));
 					return false;
 				}
-				else
-				{
-					auto str = std::ostringstream{};
-					const auto line = strm.line, col = strm.col - 1;
-					write_error(str);
-					throw unexpected_character{ str.str(), line, col };
-				}
 			}
 
-			if (is_unicode_byte(ch))
+			strm.stack.emplace_back(key_index);
+			strm.last_token = token_type::key;
+			if (strm.handler)
+				strm.handler->key(key_path(strm, toml_data, key_index));
+		}
+		catch (duplicate_element& e)
+		{
+			auto str = std::ostringstream{};
+			str << e.what();
+			strm.putback();
+			print_error_string(strm, key_name_begin, error_current_col, str);
+			throw duplicate_element{ str.str(), strm.line, key_name_begin, e.name() };
+		}
+
+		if (whitespace(ch, strm))
+			std::tie(ch, eof) = strm.get_char<NoThrow>();
+
+		if constexpr (NoThrow)
+		{
+			if (eof)
 			{
-				const auto ch_index = strm.col - 1;
-				auto u_ch = parse_unicode_char(ch, strm);
-				if (u_ch == unicode_error_char)
-				{
-					// TODO: print escaped character
-					const auto write_error = [&strm, ch_index](std::ostream& o) {
-						o << "Invalid unicode character(s) in stream: \'\uFFFD.\'\n";
-						print_error_string(strm, ch_index, error_current_col, o);
-						return;
-					};
+				insert_bad(toml_data);
+				report_error(strm, parse_error_kind::unexpected_character) << "Error getting key name\n"s;
+				return false;
+			}
+		}
+
+		if (ch != '=')
+		{
+			if constexpr (NoThrow)
+			{
+				insert_bad(toml_data);
+				report_error(strm, parse_error_kind::unexpected_character) << "key names must be followed by '='"s;
+				return false;
+			}
+			else
+				throw unexpected_character{ "key names must be followed by '='"s };
+		}
+
+		std::tie(ch, eof) = strm.get_char<NoThrow>();
+		if constexpr (NoThrow)
+		{
+			if (eof)
+			{
+				insert_bad(toml_data);
+				report_error(strm, parse_error_kind::parsing_error) << "Error getting value\n"s;
+				return false;
+			}
+		}
+
+		if (!whitespace(ch, strm))
+			strm.putback(ch);
 
-					if constexpr (NoThrow)
-					{
-						write_error(std::cerr);
-						return false;
-					}
-					else
-					{
-						auto str = std::ostringstream{};
-						const auto line = strm.line, col = strm.col - 1;
-						write_error(str);
-						throw invalid_unicode_char{ str.str(), line, col };
-					}
-				}
+		const auto ret = parse_value<NoThrow, Tag>(strm, toml_data);
+		if constexpr (NoThrow)
+		{
+			if (!ret)
+			{
+				insert_bad(toml_data);
+				return false;
 			}
 		}
 
@@ -3446,880 +5475,1468 @@ namespace another_toml
 	}
 
 	template<bool NoThrow, typename Tag>
-	static bool parse_value(parser_state&, detail::toml_internal_data&);
-
-	template<bool NoThrow>
-	static bool parse_array(parser_state& strm, detail::toml_internal_data& toml_data)
+	static bool parse_value(parser_state& strm, detail::toml_internal_data& toml_data)
 	{
-		assert(!empty(strm.stack));
-		auto arr = insert_child<NoThrow>(toml_data, strm.stack.back(), internal_node{
-				{}, node_type::array
-			});
-
-		strm.token_stream.emplace_back(token_type::array);
-		strm.stack.emplace_back(arr);
+		//whitespace has already been consumed before here
+		auto [ch, eof] = strm.get_char<NoThrow>();
+		if constexpr (NoThrow)
+		{
+			if (eof)
+				return false;
+		}
 
-		while (strm.strm.good())
+		auto ret = false;
+		
+		if (ch == '[')
+			ret = parse_array<NoThrow>(strm, toml_data);
+		else if (ch == '{')
+			ret = parse_inline_table<NoThrow>(strm, toml_data);
+		else if (ch == '\"')
+			ret = parse_str_value<NoThrow, true>(strm, toml_data);
+		else if (ch == '\'')
+			ret = parse_str_value<NoThrow, false>(strm, toml_data);
+		else
 		{
-			auto [ch, eof] = strm.get_char<NoThrow>();
+			strm.putback(ch);
+			ret = parse_unquoted_value<NoThrow, Tag>(strm, toml_data);
 			if constexpr (NoThrow)
 			{
-				if (eof)
-				{
-					std::cerr << "Encountered an unexpected eof.\n";
-					print_error_string(strm, strm.col, error_entire_line, std::cerr);
+				if (!ret)
 					return false;
-				}
-			}
-
-			if (whitespace(ch, strm))
-				continue;
-
-			if (newline(strm, ch))
-			{
-				strm.nextline();
-				continue;
 			}
+		}
 
-			if (ch == ']')
-			{
-				strm.token_stream.emplace_back(token_type::array_end);
-				strm.stack.pop_back();
-				return true;
-			}
-			
-			if (ch == ',')
+		if(ret)
+		{
+			strm.last_token = token_type::value;
+			const auto parent = strm.stack.back();
+			if (toml_data.tags[parent].type == node_type::key)
 			{
-				if (strm.token_stream.back() != token_type::value)
+				// the handler has been given the value, only the key is needed now
+				// to check for duplicates
+				if (strm.handler)
 				{
-					if constexpr (NoThrow)
-					{
-						std::cerr << "Unexpected comma in array element.\n";
-						print_error_string(strm, strm.col, error_entire_line, std::cerr);
-						return false;
-					}
-					else
-					{
-						auto str = std::ostringstream{};
-						const auto line = strm.line, col = strm.col;
-						str << "Unexpected comma in array element.\n";
-						print_error_string(strm, col - 1, col, str);
-						throw unexpected_character{ str.str(), strm.line, strm.col};
-					}
+					while (strm.open_tables.back() > parent)
+						strm.open_tables.pop_back();
+					toml_data.erase_descendants(parent);
 				}
-
-				strm.token_stream.emplace_back(token_type::comma);
-				continue;
+				strm.stack.pop_back();
 			}
+		}
 
-			if (ch == '#')
-			{
-				if (!parse_comment<NoThrow>(strm))
-				{
-					if constexpr (NoThrow)
-					{
-						insert_bad(toml_data);
-						return false;
-					}
-				}
+		return ret;
+	}
 
-				continue;
-			}
+	template<bool NoThrow, bool Array>
+	static index_t parse_table_header(parser_state& strm, toml_internal_data& toml_data)
+	{
+		assert(toml_data.tags[strm.stack.back()].type == node_type::table ||
+			toml_data.tags[strm.stack.back()].type == node_type::root_table ||
+			toml_data.tags[strm.stack.back()].type == node_type::array_tables);
+		strm.stack.pop_back();
+		strm.close_tables(toml_data);
 
-			//get value
-			strm.putback(ch);
-			if (!parse_value<NoThrow, array_tag_t>(strm, toml_data))
-				return false;
-			
-			continue;
+		auto key_name_begin = strm.col;
+		auto name = key_name{};
+
+		try
+		{
+			name = parse_key_name<NoThrow, true>(strm, toml_data, key_name_begin);
+		}
+		catch (const unexpected_eof& err)
+		{
+			auto str = std::ostringstream{};
+			str << "Unexpected end-of-file in table name.\n";
+			print_error_string(strm, strm.col - 1, strm.col, str);
+
+			throw unexpected_eof{ str.str(), err.line(), err.column() };
 		}
 
 		if constexpr (NoThrow)
 		{
-			std::cerr << "Stream error while parsing array\n";
-			return false;
+			if (!name.name)
+				return bad_index;
+		}
+		
+		auto [ch, eof] = strm.get_char<NoThrow>();
+		if constexpr (NoThrow)
+		{
+			if (eof)
+				return bad_index;
 		}
-		else 
-			throw toml_error{ "Stream error while parsing array"s };
-	}
 
-	template<bool NoThrow>
-	static bool parse_inline_table(parser_state& strm, toml_internal_data& toml_data)
-	{
-		// push back an inline table
-		assert(!empty(strm.stack));
-		const auto parent = strm.stack.back();
-		const auto& p = toml_data.nodes[parent];
-		assert(p.type == node_type::key || p.type == node_type::array);
-		const auto table = insert_child<NoThrow>(toml_data, parent, internal_node{ p.name, node_type::inline_table });
-		strm.stack.emplace_back(table);
-		strm.token_stream.emplace_back(token_type::inline_table);
-		while (strm.strm.good())
+		if (whitespace(ch, strm))
 		{
-			auto [ch, eof] = strm.get_char<NoThrow>();
+			std::tie(ch, eof) = strm.get_char<NoThrow>();
 			if constexpr (NoThrow)
 			{
 				if (eof)
-					return false;
+					return bad_index;
 			}
+		}
 
-			if (whitespace(ch, strm))
-				continue;
+		if (ch != ']')
+		{
+			const auto ch_index = strm.col - 1;
+			parse_line(strm);
+			// TODO: convert to stream lambda
+			const auto str = strm.current_line().substr(ch_index);
+			auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
+			const auto msg = "Unexpected character following table name: \'"s +
+				std::string{ block_control(*begin(graph_rng)) } +
+				"\'; was expecting \']\'\n"s;
+			if constexpr (NoThrow)
+			{
+				report_error(strm, parse_error_kind::unexpected_character) << msg;
+				print_error_string(strm, ch_index, ch_index + 1, *strm.errors);
+				insert_bad(toml_data);
+				return bad_index;
+			}
+			else
+			{
+				auto string = std::ostringstream{};
+				string << msg;
+				print_error_string(strm, ch_index, ch_index + 1, string);
+				throw unexpected_character{ string.str(), strm.line, ch_index };
+			}
+		}
 
-			if (newline(strm, ch))
+		if constexpr (Array)
+		{
+			std::tie(ch, eof) = strm.get_char<NoThrow>();
+			if constexpr (NoThrow)
 			{
-				const auto write_error = [&strm](std::ostream& o) {
-					o << "Illigal newline in inline table.\n";
-					print_error_string(strm, strm.col, strm.col, o);
+				if (eof)
+					return bad_index;
+			}
+
+			if (ch != ']')
+			{
+				const auto ch_index = strm.col - 1;
+				const auto write_error = [&strm, ch_index](std::ostream& o) {
+					o << "Unexpected character while parsing array table header : \'"s;
+					// split the first grapheme off from the current location and draw it.
+					parse_line(strm);
+					const auto str = strm.current_line().substr(ch_index);
+					auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
+					o << block_control(*begin(graph_rng));
+					o << "\', was expecting ']'.\n";
+					print_error_string(strm, ch_index, ch_index + 1, o);
 					return;
 				};
 
 				if constexpr (NoThrow)
 				{
-					write_error(std::cerr);
+					write_error(report_error(strm, parse_error_kind::unexpected_character));
 					insert_bad(toml_data);
-					return false;
+					return bad_index;
 				}
 				else
 				{
 					auto str = std::ostringstream{};
-					const auto line = strm.line, col = strm.col;
+					const auto line = strm.line, col = ch_index;
 					write_error(str);
 					throw unexpected_character{ str.str(), line, col };
 				}
 			}
+		}
 
-			if (ch == '}')
+		if (!name.name)
+		{
+			if constexpr (NoThrow)
 			{
-				if (strm.token_stream.back() == token_type::comma)
-				{
-					const auto write_error = [&strm](std::ostream& o) {
-						o << "Trailing comma is forbidden in inline tables.\n"s;
-						print_error_string(strm, strm.col, strm.col, o);
-						return;
-					};
+				insert_bad(toml_data);
+				report_error(strm, parse_error_kind::toml_error) << "Error getting table name\n";
+				return bad_index;
+			}
+			else
+				throw toml_error{ "Error getting table name" };
+		}
 
+		auto& parent = name.parent;
+		auto table = bad_index;
+		try
+		{
+			if constexpr (Array)
+			{
+				// error is handled after the catch block
+				table = insert_child_table_array<NoThrow>(name.parent, name.view(), toml_data, &strm);
+				strm.last_token = token_type::array_table;
+			}
+			else
+			{
+				table = find_child(toml_data, name.parent, name.view());
+				if (table == bad_index)
+					table = insert_child_table<NoThrow>(name.parent, name.view(), toml_data, table_def_type::header, &strm);
+				const auto type = toml_data.tags[table].type;
+				if (type != node_type::table)
+				{
+					const auto msg = "Attempted to redefine \""s + *name.name +
+						"\" as a table; was previously defined as: "s + to_string(type) + ".\n"s;
+					// type redifinition
 					if constexpr (NoThrow)
 					{
-						write_error(std::cerr);
-						insert_bad(toml_data);
-						return false;
+						report_error(strm, parse_error_kind::duplicate_element) << msg;
+						print_error_string(strm, key_name_begin, error_current_col, *strm.errors);
+						return bad_index;
 					}
 					else
+						throw duplicate_element{ msg, {}, {}, *name.name };
+				}
+				else if (toml_data.tags[table].closed)
+				{
+					const auto msg = "Attempted to reopen table: \""s + std::string{ toml_data.names[table] } +
+						"\", but this table has already been defined.\n"s;
+
+					if constexpr (NoThrow)
 					{
-						auto str = std::ostringstream{};
-						const auto line = strm.line, col = strm.col;
-						write_error(str);
-						throw unexpected_character{ str.str(), line, col };
+						report_error(strm, parse_error_kind::duplicate_element) << msg;
+						print_error_string(strm, key_name_begin, error_current_col, *strm.errors);
+						insert_bad(toml_data);
+						return bad_index;
 					}
+					else
+						throw duplicate_element{ msg, {}, {}, *name.name };
 				}
 
-				toml_data.nodes[table].closed = true;
-				assert(table == strm.stack.back());
-				strm.stack.pop_back();
-				return true;
+				strm.last_token = token_type::table;
 			}
+		}
+		// NOTE: we have to catch this here becuase insert_child_table_array can throw 
+		// duplicate element, that function doesn't have line information, so we need
+		// to add it here, as a result, the other throws in the try block end up here, 
+		// even though they could otherwise have been able to go through to the calling
+		// func.
+		catch (duplicate_element& err)
+		{
+			// add missing line/column information to exception
+			auto str = std::ostringstream{};
+			const auto line = strm.line, col = strm.col;
+			constexpr auto end_offset = Array ? 2 : 1;
+			print_error_string(strm, key_name_begin, strm.col - end_offset, str);
+			throw duplicate_element{ err.what() + str.str(), line, col, err.name() };
+		}
 
-			if (const auto back = strm.token_stream.back();
-				!(back == token_type::inline_table || back == token_type::comma))
+		if constexpr (NoThrow)
+		{
+			if (table == bad_index)
 			{
-				const auto write_error = [&strm](std::ostream& o) {
-					o << "Expected comma or end of inline table.\n"s;
-					print_error_string(strm, strm.col + 1, error_entire_line, o);
-					return;
-				};
+				constexpr auto end_offset = Array ? 2 : 1;
+				print_error_string(strm, key_name_begin, strm.col - end_offset, report_error(strm, parse_error_kind::duplicate_element));
+				return bad_index;
+			}			
+		}
 
-				if constexpr (NoThrow)
-				{
-					write_error(std::cerr);
-					insert_bad(toml_data);
-					return false;
-				}
-				else
-				{
-					auto str = std::ostringstream{};
-					const auto line = strm.line, col = strm.col;
-					write_error(str);
-					throw unexpected_character{ str.str(), line, col };
-				}
-			}
+		if (strm.handler)
+		{
+			if constexpr (Array)
+				strm.handler->begin_array_table(table_path(strm, toml_data, toml_data.links[table].parent()));
+			else
+				strm.handler->begin_table(table_path(strm, toml_data, table));
+		}
 
-			strm.putback(ch);
-			if (!parse_key_value<NoThrow, inline_tag_t>(strm, toml_data))
-				return false;
+		strm.stack.emplace_back(table);
+		strm.open_tables.emplace_back(table);
+
+		std::tie(ch, eof) = strm.get_char<NoThrow>();
+		if constexpr (NoThrow)
+		{
+			if (eof)
+				return table;
+		}
 
+		if (whitespace(ch, strm))
+		{
 			std::tie(ch, eof) = strm.get_char<NoThrow>();
 			if constexpr (NoThrow)
 			{
 				if (eof)
-					return false;
+					return table;
 			}
+		}
 
-			if(whitespace(ch, strm))
+		if (ch == '#')
+		{
+			if (!parse_comment<NoThrow>(strm))
 			{
-				std::tie(ch, eof) = strm.get_char<NoThrow>();
 				if constexpr (NoThrow)
 				{
-					if (eof)
-						return false;
+					insert_bad(toml_data);
+					return bad_index;
 				}
 			}
+		}
+		else if (!newline(strm, ch))
+		{
+			auto str = std::ostringstream{};
+			str << "Unexpected character after table header.\n"s;
+			const auto line = strm.line, col = strm.col;
+			
+			// Subtract 2 from the current coloumn position to get back to 
+			// the first char after the header close ']' in the event of
+			//	[table] error
+			// only take 1 in the case of
+			//	[table]error
+			const auto error_begin = strm.current_line().back() == ' ' ? strm.col - 2 : strm.col - 1;
+			print_error_string(strm, error_begin, error_entire_line, str);
 
-			//next must be ',' or '}'
-			if (ch == ',')
+			if constexpr (NoThrow)
 			{
-				strm.token_stream.emplace_back(token_type::comma);
-				continue;
+				report_error(strm, parse_error_kind::unexpected_character) << str.str();
+				insert_bad(toml_data);
+				return bad_index;
 			}
-			strm.putback(ch);
+			else
+				throw unexpected_character{ str.str(), line, col };
 		}
+		else
+			strm.nextline();
 
-		return true;
+		return table;
 	}
 
-	template<bool NoThrow, typename Tag>
-	static bool parse_key_value(parser_state& strm, toml_internal_data& toml_data)
+	// Consumes the BOM and opens the root table
+	static void begin_document(parser_state& p_state)
 	{
-		static_assert(std::is_same_v<Tag, normal_tag_t> || std::is_same_v<Tag, inline_tag_t>);
-		auto key_name_begin = strm.col;
-		auto key_str = key_name{};
+		auto& strm = p_state.strm;
 
-		try 
-		{
-			key_str = parse_key_name<NoThrow>(strm, toml_data, key_name_begin);
-		}
-		catch (const unexpected_eof& err)
+		// consume the BOM if it is present
+		for (auto bom : utf8_bom)
 		{
-			auto str = std::ostringstream{};
-			str << "Unexpected end-of-file in table/key name.\n";
-			print_error_string(strm, strm.col - 1, strm.col, str);
-
-			throw unexpected_eof{ str.str(), err.line(), err.column() };
+			if (strm.peek() == bom)
+				strm.ignore();
+			else
+				break;
 		}
+		// the BOM isn't part of the first line
+		strm.begin_line();
 
-		if constexpr (NoThrow)
-		{
-			if (!key_str.name)
-				return false;
-		}
+		// implicit global table
+		// always stored at index 0
+		p_state.stack.emplace_back(root_table);
+		p_state.open_tables.emplace_back(root_table);
+		return;
+	}
 
-		auto [ch, eof] = strm.get_char<NoThrow>();
+	// Parses top level statements until the end of p_state's input
+	// returns false if the document was invalid
+	template<bool NoThrow>
+	static bool parse_statements(parser_state& p_state, detail::toml_internal_data& toml_data)
+	{
+		auto& strm = p_state.strm;
 
-		if constexpr (NoThrow)
+		//parse
+		//[tables]
+		//keys
+		//[[arrays of tables]]
+		//#comments
+		//
+		//	inline tables and their members are parsed under parse_value
+		while(strm.good())
 		{
+			auto [ch, eof] = p_state.get_char<true>();
 			if (eof)
+				break;
+
+			if (whitespace(ch, p_state))
+				continue;
+
+			if (newline(p_state, ch))
 			{
-				insert_bad(toml_data);
-				std::cerr << "Error getting key name\n"s;
-				return false;
+				p_state.nextline();
+				continue;
 			}
-		}
 
-		// NOTE: if the key name function created one or more dotted table names
-		//		eg. t1.t2.t3.key_name
-		//		then we need to add all the new dotted table names to the open_tables list
-		if (toml_data.nodes[key_str.parent].closed == false)
-		{
-			strm.open_tables.emplace_back(key_str.parent);
-			auto parent = detail::find_parent(toml_data, key_str.parent);
-			while (parent != bad_index)
+			if (ch == '[') // start table or array
 			{
-				auto& n = toml_data.nodes[parent];
-				if (n.closed == true || n.table_type != table_def_type::dotted)
-					break;
-				strm.open_tables.emplace_back(parent);
-				parent = detail::find_parent(toml_data, parent);
-			}
-		}
+				if (p_state.strm.peek() == '[') //array of tables
+				{
+					p_state.ignore();
+					auto table = parse_table_header<NoThrow, true>(p_state, toml_data);
+					if constexpr (NoThrow)
+					{
+						if (table == bad_index)
+						{
+							insert_bad(toml_data);
+							break;
+						}
+					}
 
-		// NOTE: key_str.name has already been checked by this point in parse_key_name
-		//		or just above in the NoThrow constexpr block
-		assert(key_str.name.has_value());
-		auto key = detail::internal_node{ std::move(*key_str.name), node_type::key };
-		try
-		{
-			const auto key_index = insert_child<NoThrow>(toml_data, key_str.parent, std::move(key));
+					continue;
+				}
+				else
+				{
+					// Errors handled in parse_table_header
+					auto table = parse_table_header<NoThrow, false>(p_state, toml_data);
+					if constexpr (NoThrow)
+					{
+						if (table == bad_index)
+						{
+							insert_bad(toml_data);
+							break;
+						}
+					}
 
-			if constexpr (NoThrow)
+					continue;
+				}
+			}
+
+			if (ch == '#')
 			{
-				if (key_index == bad_index)
+				if (parse_comment<NoThrow>(p_state))
+					continue;
+				else
 				{
-					strm.putback();
-					print_error_string(strm, key_name_begin, error_current_col, std::cerr);
-					return false;
+					if constexpr (NoThrow)
+					{
+						insert_bad(toml_data);
+						break;
+					}
 				}
 			}
 
-			strm.stack.emplace_back(key_index);
-			strm.token_stream.emplace_back(token_type::key);
-		}
-		catch (duplicate_element& e)
-		{
-			auto str = std::ostringstream{};
-			str << e.what();
-			strm.putback();
-			print_error_string(strm, key_name_begin, error_current_col, str);
-			throw duplicate_element{ str.str(), strm.line, key_name_begin, e.name() };
-		}
+			p_state.putback(ch);
+			if (parse_key_value<NoThrow, normal_tag_t>(p_state, toml_data))
+			{
+				std::tie(ch, eof) = p_state.get_char<true>();
+				if (eof)
+					break;
 
-		if (whitespace(ch, strm))
-			std::tie(ch, eof) = strm.get_char<NoThrow>();
+				if (whitespace(ch, p_state))
+				{
+					std::tie(ch, eof) = p_state.get_char<true>();
+					if (eof)
+						break;
+				}
+
+				if (ch == '#')
+				{
+					if (!parse_comment<NoThrow>(p_state))
+					{
+						if constexpr (NoThrow)
+						{
+							insert_bad(toml_data);
+							break;
+						}
+					}
+				}
+				else if (!newline(p_state, ch))
+				{
+					const auto ch_index = p_state.col - 1;
+					const auto print_error = [&p_state, ch_index](std::ostream& o) {
+						parse_line(p_state);
+						const auto str = p_state.current_line().substr(ch_index);
+						auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
+						o << "Unexpected character found: \'"s <<
+							block_control(*begin(graph_rng)) <<
+							"\', following value; expected newline.\n"s;
+						print_error_string(p_state, ch_index, ch_index + 1, o);
+					};
 
-		if constexpr (NoThrow)
-		{
-			if (eof)
-			{
-				insert_bad(toml_data);
-				std::cerr << "Error getting key name\n"s;
-				return false;
-			}
-		}
+					if constexpr (NoThrow)
+					{
+						print_error(report_error(p_state, parse_error_kind::unexpected_character));
+						insert_bad(toml_data);
+						break;
+					}
+					else
+					{
+						const auto line = p_state.line,
+							col = ch_index;
+						auto str = std::ostringstream{};
+						print_error(str);
+						throw unexpected_character{ str.str(), line, col };
+					}
+				}
 
-		if (ch != '=')
-		{
-			if constexpr (NoThrow)
-			{
-				insert_bad(toml_data);
-				std::cerr << "key names must be followed by '='"s;
-				return false;
+				p_state.nextline();
 			}
 			else
-				throw unexpected_character{ "key names must be followed by '='"s };
-		}
-
-		std::tie(ch, eof) = strm.get_char<NoThrow>();
-		if constexpr (NoThrow)
-		{
-			if (eof)
 			{
 				insert_bad(toml_data);
-				std::cerr << "Error getting value\n"s;
-				return false;
+				break;
 			}
 		}
 
-		if (!whitespace(ch, strm))
-			strm.putback(ch);
+		return toml_data.tags.back().type != node_type::end;
+	}
 
-		const auto ret = parse_value<NoThrow, Tag>(strm, toml_data);
-		if constexpr (NoThrow)
-		{
-			if (!ret)
-			{
-				insert_bad(toml_data);
-				return false;
-			}
-		}
+	// Parses the whole of p_state's input into toml_data
+	// returns false if the document was invalid
+	template<bool NoThrow>
+	static bool parse_document(parser_state& p_state, detail::toml_internal_data& toml_data,
+		diagnostics_handler* diagnostics = nullptr);
 
-		return true;
+	// The error that stopped a no_throw parse
+	static parser_state::error_info failed_parse_error(const parser_state& p_state) noexcept
+	{
+		// some errors stop the parse without a message, usually by running out of input
+		const auto kind = p_state.strm.good() ? parse_error_kind::parsing_error : parse_error_kind::unexpected_eof;
+		return p_state.first_error.value_or(parser_state::error_info{
+			kind, p_state.line, p_state.col, p_state.strm.offset() });
 	}
 
-	template<bool NoThrow, typename Tag>
-	static bool parse_value(parser_state& strm, detail::toml_internal_data& toml_data)
+	// parse_document for the no_throw parse functions, with errors passed to diagnostics.
+	// Errors are only detected, the message is written by parsing the document again
+	// if the handler asks for it.
+	static bool parse_document_diagnosed(parser_state& p_state, detail::toml_internal_data& toml_data,
+		diagnostics_handler& diagnostics)
 	{
-		//whitespace has already been consumed before here
-		auto [ch, eof] = strm.get_char<NoThrow>();
-		if constexpr (NoThrow)
-		{
-			if (eof)
-				return false;
-		}
+		auto discard = std::ostream{ nullptr };
+		p_state.errors = &discard;
+		p_state.render_errors = false;
+		if (parse_document<true>(p_state, toml_data))
+			return true;
 
-		auto ret = false;
-		
-		if (ch == '[')
-			ret = parse_array<NoThrow>(strm, toml_data);
-		else if (ch == '{')
-			ret = parse_inline_table<NoThrow>(strm, toml_data);
-		else if (ch == '\"')
-			ret = parse_str_value<NoThrow, true>(strm, toml_data);
-		else if (ch == '\'')
-			ret = parse_str_value<NoThrow, false>(strm, toml_data);
-		else
-		{
-			strm.putback(ch);
-			ret = parse_unquoted_value<NoThrow, Tag>(strm, toml_data);
-			if constexpr (NoThrow)
-			{
-				if (!ret)
-					return false;
-			}
-		}
+		const auto err = failed_parse_error(p_state);
+		const auto input = p_state.strm.buffer();
+		const auto handler = p_state.handler != nullptr;
+		diagnostics.error(diagnostic{ err.kind, err.line, err.col, err.offset, [input, handler]() {
+			auto data = detail::toml_internal_data{};
+			auto state = parser_state{ buffer_scanner{ input } };
+			// the document isn't passed to the caller's handler again
+			auto ignore = parse_handler{};
+			if (handler)
+				state.handler = &ignore;
+			auto message = std::ostringstream{};
+			state.errors = &message;
+			parse_document<true>(state, data);
+			return message.str();
+		} });
+		return false;
+	}
 
-		if(ret)
+	template<bool NoThrow>
+	static bool parse_document(parser_state& p_state, detail::toml_internal_data& toml_data,
+		diagnostics_handler* diagnostics)
+	{
+		if constexpr (NoThrow)
 		{
-			strm.token_stream.emplace_back(token_type::value);
-			const auto parent_type = toml_data.nodes[strm.stack.back()].type;
-			if (parent_type == node_type::key)
-				strm.stack.pop_back();
+			if (diagnostics)
+				return parse_document_diagnosed(p_state, toml_data, *diagnostics);
 		}
 
-		return ret;
+		begin_document(p_state);
+		return parse_statements<NoThrow>(p_state, toml_data);
 	}
 
-	template<bool NoThrow, bool Array>
-	static index_t parse_table_header(parser_state& strm, toml_internal_data& toml_data)
+	// Parses toml into toml_data, which must only hold the root table,
+	// using a p_state that is ready to read toml.
+	// Uses opts.borrow_input, opts.lazy_values and opts.diagnostics,
+	// the other options are handled by the caller
+	template<bool NoThrow>
+	static bool parse_toml_into(std::string_view toml, const parser_options& opts,
+		parser_state& p_state, detail::toml_internal_data& toml_data)
 	{
-		assert(toml_data.nodes[strm.stack.back()].type == node_type::table ||
-			toml_data.nodes[strm.stack.back()].type == node_type::root_table ||
-			toml_data.nodes[strm.stack.back()].type == node_type::array_tables);
-		strm.stack.pop_back();
-		strm.close_tables(toml_data);
+		p_state.lazy_values = opts.lazy_values;
+		p_state.borrow_input = opts.borrow_input;
+		if (opts.borrow_input)
+			toml_data.borrowed_input = toml;
 
-		auto key_name_begin = strm.col;
-		auto name = key_name{};
+		if (!parse_document<NoThrow>(p_state, toml_data, opts.diagnostics))
+			return false;
 
-		try
-		{
-			name = parse_key_name<NoThrow, true>(strm, toml_data, key_name_begin);
-		}
-		catch (const unexpected_eof& err)
-		{
-			auto str = std::ostringstream{};
-			str << "Unexpected end-of-file in table name.\n";
-			print_error_string(strm, strm.col - 1, strm.col, str);
+		finish_document(toml_data);
 
-			throw unexpected_eof{ str.str(), err.line(), err.column() };
-		}
+#ifndef NDEBUG
+		toml_data.input_log = std::string{ p_state.current_line() };
+#endif
 
-		if constexpr (NoThrow)
-		{
-			if (!name.name)
-				return bad_index;
-		}
-		
-		auto [ch, eof] = strm.get_char<NoThrow>();
-		if constexpr (NoThrow)
-		{
-			if (eof)
-				return bad_index;
-		}
+		return true;
+	}
 
-		if (whitespace(ch, strm))
-		{
-			std::tie(ch, eof) = strm.get_char<NoThrow>();
-			if constexpr (NoThrow)
-			{
-				if (eof)
-					return bad_index;
-			}
-		}
+	// See parse_toml_into above
+	template<bool NoThrow>
+	static root_node parse_toml(std::string_view toml, const parser_options& opts = {})
+	{
+		// NOTE: root_node::data_type is a unique_ptr with a correctly templated deleter
+		//		for toml_internal_data
+		auto toml_data = root_node::data_type{ new detail::toml_internal_data{} };
+		auto p_state = parser_state{ buffer_scanner{ toml } };
+		if (!parse_toml_into<NoThrow>(toml, opts, p_state, *toml_data))
+			return root_node{};
 
-		if (ch != ']')
-		{
-			const auto ch_index = strm.col - 1;
-			parse_line(strm);
-			// TODO: convert to stream lambda
-			const auto str = std::string_view{ &strm.toml_file[ch_index] };
-			auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
-			const auto msg = "Unexpected character following table name: \'"s +
-				std::string{ block_control(*begin(graph_rng)) } +
-				"\'; was expecting \']\'\n"s;
-			if constexpr (NoThrow)
-			{
-				std::cerr << msg;
-				print_error_string(strm, ch_index, ch_index + 1, std::cerr);
-				insert_bad(toml_data);
-				return bad_index;
-			}
-			else
-			{
-				auto string = std::ostringstream{};
-				string << msg;
-				print_error_string(strm, ch_index, ch_index + 1, string);
-				throw unexpected_character{ string.str(), strm.line, ch_index };
-			}
-		}
+		return root_node{ std::move(toml_data), {} };
+	}
 
-		if constexpr (Array)
-		{
-			std::tie(ch, eof) = strm.get_char<NoThrow>();
-			if constexpr (NoThrow)
-			{
-				if (eof)
-					return bad_index;
-			}
+	// Uses opts.diagnostics, see parse_toml above
+	template<bool NoThrow>
+	static bool parse_toml(std::string_view toml, parse_handler& handler, const parser_options& opts = {})
+	{
+		// toml_data only holds tables and keys for validation, and doesn't outlive toml,
+		// so names can always be borrowed
+		auto toml_data = detail::toml_internal_data{};
+		toml_data.borrowed_input = toml;
+		auto p_state = parser_state{ buffer_scanner{ toml } };
+		p_state.borrow_input = true;
+		p_state.handler = &handler;
+		return parse_document<NoThrow>(p_state, toml_data, opts.diagnostics);
+	}
 
-			if (ch != ']')
-			{
-				const auto ch_index = strm.col - 1;
-				const auto write_error = [&strm, ch_index](std::ostream& o) {
-					o << "Unexpected character while parsing array table header : \'"s;
-					// split the first grapheme off from the current location and draw it.
-					parse_line(strm);
-					const auto str = std::string_view{ &strm.toml_file[ch_index] };
-					auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
-					o << block_control(*begin(graph_rng));
-					o << "\', was expecting ']'.\n";
-					print_error_string(strm, ch_index, ch_index + 1, o);
-					return;
-				};
+	// Follows strings, comments and brackets through a document that's read in pieces,
+	// to find the newlines that end top level statements.
+	// Invalid documents may produce incorrect results, the parser reports the errors.
+	class statement_scanner
+	{
+	public:
+		// Continues scanning buffer from where the previous call stopped.
+		// Calls end_statement with the position following each newline that ended a statement.
+		template<typename EndStatement>
+		void scan(std::string_view buffer, EndStatement&& end_statement)
+		{
+			const auto sz = size(buffer);
+			const auto end_line = [&]() {
+				if (_depth == 0)
+					end_statement(_pos + 1);
+			};
 
-				if constexpr (NoThrow)
-				{
-					write_error(std::cerr);
-					insert_bad(toml_data);
-					return bad_index;
-				}
-				else
+			while (_pos < sz)
+			{
+				const auto ch = buffer[_pos];
+				// quotes and escapes need to see the characters after them,
+				// if they aren't available yet then stop and wait for them
+				const auto remaining = sz - _pos;
+				switch (_state)
 				{
-					auto str = std::ostringstream{};
-					const auto line = strm.line, col = ch_index;
-					write_error(str);
-					throw unexpected_character{ str.str(), line, col };
-				}
-			}
-		}
+				case state::normal:
+					if (ch == '#')
+						_state = state::comment;
+					else if (ch == '\"' || ch == '\'')
+					{
+						if (remaining < 3)
+							return;
 
-		if (!name.name)
-		{
-			if constexpr (NoThrow)
-			{
-				insert_bad(toml_data);
-				std::cerr << "Error getting table name\n";
-				return bad_index;
-			}
-			else
-				throw toml_error{ "Error getting table name" };
-		}
+						const auto multiline = buffer[_pos + 1] == ch && buffer[_pos + 2] == ch;
+						if (multiline)
+						{
+							_state = ch == '\"' ? state::multiline_basic : state::multiline_literal;
+							_pos += 3;
+							continue;
+						}
 
-		auto& parent = name.parent;
-		auto table = bad_index;
-		try
-		{
-			if constexpr (Array)
-			{
-				// error is handled after the catch block
-				table = insert_child_table_array<NoThrow>(name.parent, std::move(*name.name), toml_data);
-				strm.token_stream.emplace_back(token_type::array_table);
-			}
-			else
-			{
-				table = find_child(toml_data, name.parent, *name.name);
-				if (table == bad_index)
-					table = insert_child_table<NoThrow>(name.parent, std::move(*name.name), toml_data, table_def_type::header);
-				const auto type = toml_data.nodes[table].type;
-				if (type != node_type::table)
-				{
-					const auto msg = "Attempted to redefine \""s + *name.name +
-						"\" as a table; was previously defined as: "s + to_string(type) + ".\n"s;
-					// type redifinition
-					if constexpr (NoThrow)
+						_state = ch == '\"' ? state::basic : state::literal;
+					}
+					else if (ch == '[' || ch == '{')
+						++_depth;
+					else if ((ch == ']' || ch == '}') && _depth > 0)
+						--_depth;
+					else if (ch == '\n')
+						end_line();
+					break;
+				case state::comment:
+					if (ch == '\n')
 					{
-						std::cerr << msg;
-						print_error_string(strm, key_name_begin, error_current_col, std::cerr);
-						return bad_index;
+						_state = state::normal;
+						end_line();
 					}
-					else
-						throw duplicate_element{ msg, {}, {}, *name.name };
-				}
-				else if (toml_data.nodes[table].closed)
+					break;
+				case state::basic:
+				case state::literal:
+					if (_state == state::basic && ch == '\\')
+					{
+						if (remaining < 2)
+							return;
+						++_pos;
+					}
+					else if (ch == (_state == state::basic ? '\"' : '\''))
+						_state = state::normal;
+					// unterminated string
+					else if (ch == '\n')
+					{
+						_state = state::normal;
+						end_line();
+					}
+					break;
+				case state::multiline_basic:
+				case state::multiline_literal:
 				{
-					const auto msg = "Attempted to reopen table: \""s + toml_data.nodes[table].name +
-						"\", but this table has already been defined.\n"s;
-
-					if constexpr (NoThrow)
+					const auto quote = _state == state::multiline_basic ? '\"' : '\'';
+					if (_state == state::multiline_basic && ch == '\\')
 					{
-						std::cerr << msg;
-						print_error_string(strm, key_name_begin, error_current_col, std::cerr);
-						insert_bad(toml_data);
-						return bad_index;
+						if (remaining < 2)
+							return;
+						++_pos;
 					}
-					else
-						throw duplicate_element{ msg, {}, {}, *name.name };
+					else if (ch == quote)
+					{
+						if (remaining < 3)
+							return;
+
+						if (buffer[_pos + 1] == quote && buffer[_pos + 2] == quote)
+						{
+							_state = state::normal;
+							_pos += 3;
+							continue;
+						}
+					}
+					break;
+				}
 				}
 
-				strm.token_stream.emplace_back(token_type::table);
+				++_pos;
 			}
+
+			return;
 		}
-		// NOTE: we have to catch this here becuase insert_child_table_array can throw 
-		// duplicate element, that function doesn't have line information, so we need
-		// to add it here, as a result, the other throws in the try block end up here, 
-		// even though they could otherwise have been able to go through to the calling
-		// func.
-		catch (duplicate_element& err)
+
+		// The first n characters of the buffer have been removed
+		void consume(const std::size_t n) noexcept
 		{
-			// add missing line/column information to exception
-			auto str = std::ostringstream{};
-			const auto line = strm.line, col = strm.col;
-			constexpr auto end_offset = Array ? 2 : 1;
-			print_error_string(strm, key_name_begin, strm.col - end_offset, str);
-			throw duplicate_element{ err.what() + str.str(), line, col, err.name() };
+			assert(n <= _pos);
+			_pos -= n;
+			return;
 		}
 
-		if constexpr (NoThrow)
+	private:
+		enum class state : std::uint8_t
 		{
-			if (table == bad_index)
+			normal,
+			comment,
+			basic,
+			literal,
+			multiline_basic,
+			multiline_literal
+		};
+
+		std::size_t _pos = {};
+		std::size_t _depth = {};
+		state _state = state::normal;
+	};
+
+	namespace detail
+	{
+		struct incremental_state
+		{
+			explicit incremental_state(const parser_options& o)
+				: opts{ o }, toml_data{ new toml_internal_data{} }, p_state{ buffer_scanner{ {} } }
 			{
-				constexpr auto end_offset = Array ? 2 : 1;
-				print_error_string(strm, key_name_begin, strm.col - end_offset, std::cerr);
-				return bad_index;
-			}			
-		}
+				p_state.lazy_values = opts.lazy_values;
+				// the input is gone by the time the handler could ask for the message,
+				// so it's written as the error is found
+				if (opts.diagnostics)
+					p_state.errors = &messages;
+			}
 
-		strm.stack.emplace_back(table);
-		strm.open_tables.emplace_back(table);
+			parser_options opts;
+			root_node::data_type toml_data;
+			parser_state p_state;
+			statement_scanner scanner;
+			// input that hasn't been parsed yet
+			std::string buffer;
+			// the length of the input that has already been parsed
+			std::size_t parsed = {};
+			// no_throw errors for opts.diagnostics
+			std::ostringstream messages;
+			bool started = false;
+			bool failed = false;
+		};
 
-		std::tie(ch, eof) = strm.get_char<NoThrow>();
-		if constexpr (NoThrow)
+		void incremental_state_deleter::operator()(incremental_state* ptr) noexcept
 		{
-			if (eof)
-				return table;
+			delete ptr;
+		}
+	}
+
+	// Parses the first n characters of s.buffer
+	template<bool NoThrow>
+	static bool parse_buffered(detail::incremental_state& s, const std::size_t n)
+	{
+		// if parsing throws, the parser stays failed
+		s.failed = true;
+		auto& p_state = s.p_state;
+		p_state.strm = buffer_scanner{ std::string_view{ s.buffer }.substr(0, n) };
+		if (!s.started)
+		{
+			begin_document(p_state);
+			s.started = true;
 		}
 
-		if (whitespace(ch, strm))
+		const auto ret = parse_statements<NoThrow>(p_state, *s.toml_data);
+		if constexpr (NoThrow)
 		{
-			std::tie(ch, eof) = strm.get_char<NoThrow>();
-			if constexpr (NoThrow)
+			if (!ret && s.opts.diagnostics)
 			{
-				if (eof)
-					return table;
+				const auto err = failed_parse_error(p_state);
+				s.opts.diagnostics->error(diagnostic{ err.kind, err.line, err.col, s.parsed + err.offset,
+					[message = s.messages.str()]() {
+					return message;
+				} });
 			}
 		}
 
-		if (ch == '#')
+		s.buffer.erase(0, n);
+		s.parsed += n;
+		s.failed = !ret;
+		return ret;
+	}
+
+	template<bool NoThrow>
+	static bool feed(detail::incremental_state& s, std::string_view toml)
+	{
+		if (s.failed)
+			return false;
+
+		s.buffer.append(toml);
+		auto statements = std::size_t{};
+		s.scanner.scan(s.buffer, [&statements](const std::size_t end) noexcept {
+			statements = end;
+		});
+
+		if (statements == 0)
+			return true;
+
+		s.scanner.consume(statements);
+		return parse_buffered<NoThrow>(s, statements);
+	}
+
+	template<bool NoThrow>
+	static root_node finish(std::unique_ptr<detail::incremental_state, detail::incremental_state_deleter>& s)
+	{
+		// the parser is reset for the next document
+		auto state = std::move(s);
+		s.reset(new detail::incremental_state{ state->opts });
+		if (state->failed || !parse_buffered<NoThrow>(*state, size(state->buffer)))
+			return root_node{};
+
+		finish_document(*state->toml_data);
+
+#ifndef NDEBUG
+		state->toml_data->input_log = std::string{ state->p_state.current_line() };
+#endif
+
+		return root_node{ std::move(state->toml_data), {} };
+	}
+
+	incremental_parser::incremental_parser(const parser_options& opts)
+		: _state{ new detail::incremental_state{ opts } }
+	{}
+
+	void incremental_parser::feed(std::string_view toml)
+	{
+		another_toml::feed<false>(*_state, toml);
+		return;
+	}
+
+	bool incremental_parser::feed(std::string_view toml, no_throw_t)
+	{
+		return another_toml::feed<true>(*_state, toml);
+	}
+
+	root_node incremental_parser::finish()
+	{
+		return another_toml::finish<false>(_state);
+	}
+
+	root_node incremental_parser::finish(no_throw_t)
+	{
+		return another_toml::finish<true>(_state);
+	}
+
+	namespace detail
+	{
+		struct parser_cache
 		{
-			if (!parse_comment<NoThrow>(strm))
-			{
-				if constexpr (NoThrow)
-				{
-					insert_bad(toml_data);
-					return bad_index;
-				}
-			}
+			explicit parser_cache(const parser_options& o)
+				: opts{ o }, p_state{ buffer_scanner{ {} } }
+			{}
+
+			parser_options opts;
+			parser_state p_state;
+			// storage from a recycled or failed document
+			root_node::data_type spare_data;
+		};
+
+		void parser_cache_deleter::operator()(parser_cache* ptr) noexcept
+		{
+			delete ptr;
 		}
-		else if (!newline(strm, ch))
+	}
+
+	template<bool NoThrow>
+	static root_node parse_toml(detail::parser_cache& cache, std::string_view toml)
+	{
+		auto toml_data = std::move(cache.spare_data);
+		if (!toml_data)
+			toml_data.reset(new detail::toml_internal_data{});
+
+		cache.p_state.reset(toml);
+		if (!parse_toml_into<NoThrow>(toml, cache.opts, cache.p_state, *toml_data))
 		{
-			auto str = std::ostringstream{};
-			str << "Unexpected character after table header.\n"s;
-			const auto line = strm.line, col = strm.col;
-			
-			// Subtract 2 from the current coloumn position to get back to 
-			// the first char after the header close ']' in the event of
-			//	[table] error
-			// only take 1 in the case of
-			//	[table]error
-			const auto error_begin = *strm.toml_file.rbegin() == ' ' ? strm.col - 2 : strm.col - 1;
-			print_error_string(strm, error_begin, error_entire_line, str);
+			toml_data->clear();
+			cache.spare_data = std::move(toml_data);
+			return root_node{};
+		}
 
-			if constexpr (NoThrow)
+		return root_node{ std::move(toml_data), {} };
+	}
+
+	parser::parser(const parser_options& opts)
+		: _cache{ new detail::parser_cache{ opts } }
+	{}
+
+	root_node parser::parse(std::string_view toml)
+	{
+		return parse_toml<false>(*_cache, toml);
+	}
+
+	root_node parser::parse(std::string_view toml, no_throw_t)
+	{
+		return parse_toml<true>(*_cache, toml);
+	}
+
+	void parser::recycle(root_node&& document) noexcept
+	{
+		if (!document._data || _cache->spare_data)
+			return;
+
+		document._data->clear();
+		_cache->spare_data = std::move(document._data);
+		return;
+	}
+
+	void parser::reset()
+	{
+		_cache.reset(new detail::parser_cache{ _cache->opts });
+		return;
+	}
+
+	// Segments smaller than this aren't worth a thread of their own
+	constexpr auto min_segment_size = std::size_t{ 1024 * 1024 };
+
+	// The name of a [table] or [[array table]] header, see read_header
+	struct header_name
+	{
+		bool array = false;
+		// each part of the name followed by '\n', which can't appear in the names read_header accepts
+		std::string path;
+		std::size_t parts = {};
+	};
+
+	// Reads the header at the start of line into header, reusing its path buffer.
+	// Returns false if the line doesn't start with a [table] or [[array table]] header
+	// whose name parts are all unquoted or quoted without escapes.
+	// Segments starting with these headers can be parsed without knowing what came before them,
+	// as long as the tables their name passes through aren't array tables, see split_at_headers.
+	static bool read_header(std::string_view line, header_name& header)
+	{
+		constexpr auto whitespace = " \t"sv;
+		const auto skip_whitespace = [&line, whitespace]() noexcept {
+			line.remove_prefix(std::min(line.find_first_not_of(whitespace), size(line)));
+		};
+
+		header.path.clear();
+		header.parts = {};
+		skip_whitespace();
+		if (empty(line) || line.front() != '[')
+			return false;
+		line.remove_prefix(1);
+		header.array = !empty(line) && line.front() == '[';
+		if (header.array)
+			line.remove_prefix(1);
+
+		while (true)
+		{
+			skip_whitespace();
+			if (empty(line))
+				return false;
+
+			if (const auto quote = line.front(); quote == '"' || quote == '\'')
 			{
-				std::cerr << str.str();
-				insert_bad(toml_data);
-				return bad_index;
+				const auto last = line.find_first_of("\"'\\\n"sv, 1);
+				if (last == std::string_view::npos || line[last] != quote)
+					return false;
+				header.path.append(line.substr(1, last - 1));
+				line.remove_prefix(last + 1);
 			}
 			else
-				throw unexpected_character{ str.str(), line, col };
+			{
+				const auto last = std::find_if_not(begin(line), end(line), [](const char ch) noexcept {
+					return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+						(ch >= '0' && ch <= '9') || ch == '_' || ch == '-';
+				});
+
+				const auto length = static_cast<std::size_t>(std::distance(begin(line), last));
+				if (length == 0)
+					return false;
+				header.path.append(line.substr(0, length));
+				line.remove_prefix(length);
+			}
+
+			header.path.push_back('\n');
+			++header.parts;
+			skip_whitespace();
+			if (empty(line) || line.front() != '.')
+				break;
+			line.remove_prefix(1);
 		}
-		else
-			strm.nextline();
 
-		return table;
+		return header.array ? line.substr(0, 2) == "]]"sv : line.substr(0, 1) == "]"sv;
 	}
 
-	template<bool NoThrow>
-	static root_node parse_toml(std::istream& strm)
+	// Splits toml into at most count segments of similar size.
+	// Every segment after the first starts with a table or array table header.
+	// A segment can start with a dotted header like [a.b] unless [[a]] appears anywhere
+	// in the document. The segment would create "a" as an implicit table, and fail to
+	// parse if [[a]] followed it, even though [a.b] was inside the last table of "a".
+	static std::vector<std::string_view> split_at_headers(const std::string_view toml, const std::size_t count)
 	{
-		// NOTE: root_node::data_type is a unique_ptr with a correctly templated deleter
-		//		for toml_internal_data
-		auto toml_data = root_node::data_type{ new detail::toml_internal_data{} };
-		auto& t = toml_data->nodes;
-		auto p_state = parser_state{ strm };
+		auto headers = std::vector<std::size_t>{};
+		auto array_paths = std::unordered_set<std::string>{};
+		// an array table's name couldn't be read, so it could be a prefix of any dotted header
+		auto unread_array = false;
+		auto header = header_name{};
+		auto scanner = statement_scanner{};
+		scanner.scan(toml, [&](const std::size_t line_begin) {
+			const auto line = toml.substr(line_begin);
+			if (read_header(line, header))
+			{
+				headers.emplace_back(line_begin);
+				// most documents repeat the same few array tables
+				if (header.array && array_paths.count(header.path) == 0)
+					array_paths.emplace(header.path);
+			}
+			else if (const auto first = line.find_first_not_of(" \t"sv);
+				first != std::string_view::npos && line.substr(first, 2) == "[["sv)
+				unread_array = true;
+			return;
+		});
 
-		// consume the BOM if it is present
-		for (auto bom : utf8_bom)
+		// true if a table that header's name passes through is an array table
+		const auto passes_array = [&array_paths, &header]() {
+			auto prefix_end = std::size_t{};
+			for (auto part = std::size_t{ 1 }; part < header.parts; ++part)
+			{
+				prefix_end = header.path.find('\n', prefix_end) + 1;
+				if (array_paths.count(header.path.substr(0, prefix_end)) != 0)
+					return true;
+			}
+			return false;
+		};
+
+		auto segments = std::vector<std::string_view>{};
+		const auto target_size = size(toml) / count;
+		auto segment_begin = std::size_t{};
+		for (const auto line_begin : headers)
 		{
-			if (strm.peek() == bom)
-				strm.ignore();
-			else
+			if (size(segments) + 1 == count)
 				break;
+			if (line_begin - segment_begin < target_size)
+				continue;
+
+			read_header(toml.substr(line_begin), header);
+			if (header.parts > 1 && (unread_array || passes_array()))
+				continue;
+
+			segments.emplace_back(toml.substr(segment_begin, line_begin - segment_begin));
+			segment_begin = line_begin;
 		}
 
-		// implicit global table
-		// always stored at index 0
-		p_state.stack.emplace_back(root_table);
-		p_state.open_tables.emplace_back(root_table);
-		
-		//parse
-		//[tables]
-		//keys
-		//[[arrays of tables]]
-		//#comments
-		//
-		//	inline tables and their members are parsed under parse_value
-		while(strm.good())
+		segments.emplace_back(toml.substr(segment_begin));
+		return segments;
+	}
+
+	// Links an existing node in as the last child of parent
+	static void append_child(toml_internal_data& d, const index_t parent, const index_t child)
+	{
+		d.links[child].set_next(bad_index);
+		link_last_child(d, parent, child);
+
+		if (!has_named_children(d.tags[parent].type))
+			return;
+
+		if (const auto index = get_child_index(d, parent); index)
+			index->names.emplace(normalised_name(d, child), child);
+		else if (d.links[parent].child_count() >= child_index_threshold)
+			make_child_index(d, parent);
+
+		return;
+	}
+
+	// True if dotted keys added to table, which a segment left open because it was only named
+	// as part of another table's name. parse_key_name only allows that while the table is open,
+	// so the table can't be merged into one that was defined by a header, or into an array table.
+	static bool has_dotted_children(const toml_internal_data& d, const index_t table) noexcept
+	{
+		for (auto child = d.links[table].child(); child != bad_index; child = d.links[child].next())
 		{
-			auto [ch, eof] = p_state.get_char<true>();
-			if (eof)
-				break;
+			const auto& c = d.tags[child];
+			if (c.type == node_type::key ||
+				(c.type == node_type::table && c.table_type == table_def_type::dotted))
+				return true;
+		}
 
-			if (whitespace(ch, p_state))
-				continue;
+		return false;
+	}
 
-			if (newline(p_state, ch))
+	// Links child and its siblings into parent.
+	// Tables that are already in parent are merged following the same rules as parse_table_header
+	// and parse_key_name. A table in a segment is closed if it was defined there, or open if it
+	// was only named as part of another table's name.
+	// Returns false if a child redefines something in parent.
+	static bool merge_children(toml_internal_data& d, const index_t parent, index_t child)
+	{
+		while (child != bad_index)
+		{
+			const auto next = d.links[child].next();
+			const auto existing = find_child(d, parent, normalised_name(d, child));
+			if (existing == bad_index)
 			{
-				p_state.nextline();
+				append_child(d, parent, child);
+				child = next;
 				continue;
 			}
 
-			if (ch == '[') // start table or array
-			{
-				if (p_state.strm.peek() == '[') //array of tables
-				{
-					p_state.ignore();
-					auto table = parse_table_header<NoThrow, true>(p_state, *toml_data);
-					if constexpr (NoThrow)
-					{
-						if (table == bad_index)
-						{
-							insert_bad(*toml_data);
-							break;
-						}
-					}
-
-					continue;
-				}
-				else
+			const auto& moved = d.tags[child];
+			auto& found = d.tags[existing];
+			if (moved.type == node_type::table && found.type == node_type::table)
+			{
+				if (moved.closed)
 				{
-					// Errors handled in parse_table_header
-					auto table = parse_table_header<NoThrow, false>(p_state, *toml_data);
-					if constexpr (NoThrow)
-					{
-						if (table == bad_index)
-						{
-							insert_bad(*toml_data);
-							break;
-						}
-					}
-
-					continue;
+					if (found.closed)
+						return false;
+					found.closed = true;
 				}
-			}
+				else if (found.closed && found.table_type == table_def_type::header &&
+					has_dotted_children(d, child))
+					return false;
 
-			if (ch == '#')
+				if (!merge_children(d, existing, d.links[child].child()))
+					return false;
+			}
+			// a table name that passes through an array table refers to its last table
+			else if (moved.type == node_type::table && found.type == node_type::array_tables)
 			{
-				if (parse_comment<NoThrow>(p_state))
-					continue;
-				else
+				if (moved.closed || has_dotted_children(d, child) ||
+					!merge_children(d, d.links[existing].last_child(), d.links[child].child()))
+					return false;
+			}
+			else if (moved.type == node_type::array_tables && found.type == node_type::array_tables)
+			{
+				auto table = d.links[child].child();
+				while (table != bad_index)
 				{
-					if constexpr (NoThrow)
-					{
-						insert_bad(*toml_data);
-						break;
-					}
+					const auto next_table = d.links[table].next();
+					append_child(d, existing, table);
+					table = next_table;
 				}
 			}
+			else
+				return false;
 
-			p_state.putback(ch);
-			if (parse_key_value<NoThrow, normal_tag_t>(p_state, *toml_data))
+			// child has been merged into existing and is no longer part of the tree
+			d.child_indexes.erase(child);
+			d.links[child].set_child(bad_index);
+			d.links[child].set_last_child(bad_index);
+			d.links[child].set_child_count(0);
+			child = next;
+		}
+
+		return true;
+	}
+
+	// Index of a segment's node once it has been moved into the document at base.
+	// The segment's root table is dropped, everything else is moved up by base - 1
+	constexpr index_t relocated_index(const index_t i, const index_t base) noexcept
+	{
+		if (i == bad_index || i == root_table)
+			return i;
+		return base + i - 1;
+	}
+
+	// Moves the nodes from a separately parsed segment of the document into d starting at base.
+	// d must already have room for them, segments can be relocated concurrently.
+	static void relocate_segment(toml_internal_data& d, toml_internal_data& seg, const index_t base) noexcept
+	{
+		for (auto i = index_t{ 1 }; i < seg.node_count(); ++i)
+		{
+			const auto& l = seg.links[i];
+			auto& moved = d.links[relocated_index(i, base)];
+			moved.set_next(relocated_index(l.next(), base));
+			moved.set_child(relocated_index(l.child(), base));
+			moved.set_last_child(relocated_index(l.last_child(), base));
+			moved.set_parent(relocated_index(l.parent(), base));
+			moved.set_child_count(l.child_count());
+		}
+
+		std::copy(next(begin(seg.tags)), end(seg.tags), next(begin(d.tags), base));
+		std::copy(next(begin(seg.names)), end(seg.names), next(begin(d.names), base));
+		std::move(next(begin(seg.values)), end(seg.values), next(begin(d.values), base));
+		return;
+	}
+
+	// Takes the remaining data from a relocated segment,
+	// then links the segment's root table children into d's root table.
+	// Returns false if the segment redefined anything in d.
+	static bool stitch_segment(toml_internal_data& d, toml_internal_data& seg, const index_t base)
+	{
+		d.strings.adopt(std::move(seg.strings));
+
+		for (const auto& [i, name] : seg.nfc_names)
+			d.nfc_names.emplace(relocated_index(i, base), name);
+
+		for (const auto& [i, index] : seg.child_indexes)
+		{
+			if (i == root_table)
+				continue;
+
+			auto& moved = d.child_indexes[relocated_index(i, base)];
+			for (const auto& [name, child] : index.names)
+				moved.names.emplace(name, relocated_index(child, base));
+		}
+
+		return merge_children(d, root_table, relocated_index(seg.links[root_table].child(), base));
+	}
+
+	// Calls f(i) for every i in [0, count), using a thread for each call after the first
+	template<typename Func>
+	static void run_concurrently(const std::size_t count, Func&& f)
+	{
+		auto workers = std::vector<std::thread>{};
+		for (auto i = std::size_t{ 1 }; i < count; ++i)
+		{
+			try
 			{
-				std::tie(ch, eof) = p_state.get_char<true>();
-				if (eof)
-					break;
+				workers.emplace_back(f, i);
+			}
+			catch (const std::system_error&)
+			{
+				// out of threads, run it here instead
+				f(i);
+			}
+		}
 
-				if (whitespace(ch, p_state))
-				{
-					std::tie(ch, eof) = p_state.get_char<true>();
-					if (eof)
-						break;
-				}
+		f(std::size_t{});
+		for (auto& w : workers)
+			w.join();
+		return;
+	}
 
-				if (ch == '#')
-				{
-					if (!parse_comment<NoThrow>(p_state))
-					{
-						if constexpr (NoThrow)
-						{
-							insert_bad(*toml_data);
-							break;
-						}
-					}
-				}
-				else if (!newline(p_state, ch))
+	// Splits the document at top level table headers and parses the segments concurrently.
+	// Falls back to parse_toml for small documents, and for invalid documents
+	// so that errors are reported the same way.
+	template<bool NoThrow>
+	static root_node parse_toml_parallel(std::string_view toml, const parser_options& opts)
+	{
+		auto threads = opts.threads;
+		if (threads == 0)
+			threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		const auto segments = split_at_headers(toml,
+			std::clamp(size(toml) / min_segment_size, std::size_t{ 1 }, threads));
+		if (size(segments) < 2)
+			return parse_toml<NoThrow>(toml, opts);
+
+		auto segment_data = std::vector<root_node::data_type>{};
+		for (auto i = std::size_t{}; i < size(segments); ++i)
+			segment_data.emplace_back(new detail::toml_internal_data{});
+
+		// segments are parsed with exceptions enabled, the serial parse reports any errors
+		auto failed = std::vector<char>(size(segments), false);
+		run_concurrently(size(segments), [&](const std::size_t i) noexcept {
+			try
+			{
+				auto& data = *segment_data[i];
+				auto p_state = parser_state{ buffer_scanner{ segments[i] } };
+				p_state.lazy_values = opts.lazy_values;
+				p_state.render_errors = false;
+				if (opts.borrow_input)
 				{
-					const auto ch_index = p_state.col - 1;
-					const auto print_error = [&p_state, ch_index](std::ostream& o) {
-						parse_line(p_state);
-						const auto str = std::string_view{ &p_state.toml_file[ch_index] };
-						auto graph_rng = uni::ranges::grapheme::utf8_view{ str };
-						o << "Unexpected character found: \'"s <<
-							block_control(*begin(graph_rng)) <<
-							"\', following value; expected newline.\n"s;
-						print_error_string(p_state, ch_index, ch_index + 1, o);
-					};
-
-					if constexpr (NoThrow)
-					{
-						print_error(std::cerr);
-						insert_bad(*toml_data);
-						break;
-					}
-					else
-					{
-						const auto line = p_state.line,
-							col = ch_index;
-						auto str = std::ostringstream{};
-						print_error(str);
-						throw unexpected_character{ str.str(), line, col };
-					}
+					p_state.borrow_input = true;
+					data.borrowed_input = toml;
 				}
 
-				p_state.nextline();
+				begin_document(p_state);
+				failed[i] = !parse_statements<false>(p_state, data);
+				// every table defined in the segment is closed,
+				// tables that are still open have only been named by other table headers
+				p_state.close_tables(data);
 			}
-			else
+			catch (...)
 			{
-				insert_bad(*toml_data);
-				break;
+				failed[i] = true;
 			}
+			return;
+		});
+
+		if (std::find(begin(failed), end(failed), true) != end(failed))
+			return parse_toml<NoThrow>(toml, opts);
+
+		// every segment after the first is moved to the end of the first segment's nodes
+		auto& toml_data = *segment_data.front();
+		auto bases = std::vector<index_t>{ toml_data.node_count() };
+		auto node_count = std::size_t{ toml_data.node_count() };
+		for (auto i = std::size_t{ 1 }; i < size(segment_data); ++i)
+		{
+			bases.emplace_back(static_cast<index_t>(node_count));
+			node_count += segment_data[i]->node_count() - 1;
 		}
 
-		if (toml_data->nodes.back().type == node_type::end)
-			return root_node{};
+		if (node_count > max_nodes)
+			throw std::length_error{ "TOML document contains too many nodes" };
 
-#ifndef NDEBUG
-		toml_data->input_log = std::move(p_state.toml_file);
-#endif
+		toml_data.resize(node_count);
+		run_concurrently(size(segments) - 1, [&](const std::size_t i) noexcept {
+			relocate_segment(toml_data, *segment_data[i + 1], bases[i + 1]);
+			return;
+		});
 
-		return root_node{ std::move(toml_data), {} };
+		for (auto i = std::size_t{ 1 }; i < size(segment_data); ++i)
+		{
+			if (!stitch_segment(toml_data, *segment_data[i], bases[i]))
+				return parse_toml<NoThrow>(toml, opts);
+			segment_data[i].reset();
+		}
+
+		finish_document(toml_data);
+		return root_node{ std::move(segment_data.front()), {} };
 	}
 
 	template<bool NoThrow>
-	root_node parse(std::istream& strm)
+	root_node parse(std::string_view toml, const parser_options& opts)
+	{
+		if (opts.threads != 1)
+			return parse_toml_parallel<NoThrow>(toml, opts);
+		return parse_toml<NoThrow>(toml, opts);
+	}
+
+	template<bool NoThrow>
+	root_node parse(std::istream& strm, const parser_options& opts)
 	{
 		if (!strm.good())
 			return root_node{};
 
-		return parse_toml<NoThrow>(strm);
+		// the parser reads from a contiguous buffer, so collect the stream contents first
+		const auto toml = std::string{ std::istreambuf_iterator<char>{ strm }, {} };
+		// which doesn't outlive the parse, so it can't be borrowed
+		auto stream_opts = opts;
+		stream_opts.borrow_input = false;
+		return parse<NoThrow>(std::string_view{ toml }, stream_opts);
 	}
 
-	template<bool NoThrow>
-	root_node parse(std::string_view toml)
+	// Read only memory mapping of an entire file.
+	// good() is false if the file couldn't be mapped (or memory mapping isn't available),
+	// in which case the file should be read normally instead.
+	class mapped_file
 	{
-		auto strstream = std::stringstream{ std::string{ toml }, std::ios_base::in };
-		return parse<NoThrow>(strstream);
-	}
+	public:
+		explicit mapped_file(const std::filesystem::path& path) noexcept
+		{
+#ifdef ANOTHER_TOML_HAS_MMAP
+			const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd == -1)
+				return;
 
-	template<bool NoThrow>
-	root_node parse(const std::filesystem::path& path)
+			// only regular files can be mapped, pipes, sockets and
+			// procfs files (which report a size of 0) have to be read
+			struct stat st = {};
+			if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+			{
+				const auto sz = static_cast<std::size_t>(st.st_size);
+				if (const auto addr = ::mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+					addr != MAP_FAILED)
+				{
+					::madvise(addr, sz, MADV_SEQUENTIAL);
+					_data = static_cast<const char*>(addr);
+					_size = sz;
+				}
+			}
+
+			::close(fd);
+#endif
+			return;
+		}
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		~mapped_file() noexcept
+		{
+#ifdef ANOTHER_TOML_HAS_MMAP
+			if (_data)
+				::munmap(const_cast<char*>(_data), _size);
+#endif
+		}
+
+		bool good() const noexcept
+		{
+			return _data != nullptr;
+		}
+
+		std::string_view view() const noexcept
+		{
+			return { _data, _size };
+		}
+
+	private:
+		const char* _data = nullptr;
+		std::size_t _size = {};
+	};
+
+	// Reads or maps the file at path into a contiguous buffer and passes it to parse_buffer.
+	// Returns a default constructed result if the file can't be read.
+	template<bool NoThrow, typename ParseBuffer>
+	static auto parse_file(const std::filesystem::path& path, const parser_options& opts, ParseBuffer&& parse_buffer)
 	{
+		using return_type = decltype(parse_buffer(std::string_view{}));
 		if constexpr (NoThrow)
 		{
 			auto ec = std::error_code{};
 			if (!std::filesystem::exists(path, ec) ||
 				std::filesystem::is_directory(path, ec))
 			{
-				std::cerr << ec << ": "s << ec.message();
-				return root_node{};
+				if (opts.diagnostics)
+				{
+					opts.diagnostics->error(diagnostic{ parse_error_kind::file_error, {}, {}, {}, [ec, &path]() {
+						return ec ? ec.message() : "Unable to read file: "s + path.string();
+					} });
+				}
+				else
+					std::cerr << ec << ": "s << ec.message();
+				return return_type{};
 			}
 		}
 
+		if (opts.memory_map)
+		{
+			// the parse result copies everything it needs,
+			// so the mapping only has to outlive parse_buffer
+			const auto file = mapped_file{ path };
+			if (file.good())
+				return parse_buffer(file.view());
+		}
+
 		auto strm = std::ifstream{ path };
-		return parse<NoThrow>(strm);
+		if (!strm.good())
+			return return_type{};
+
+		const auto toml = std::string{ std::istreambuf_iterator<char>{ strm }, {} };
+		return parse_buffer(toml);
+	}
+
+	template<bool NoThrow>
+	root_node parse(const std::filesystem::path& path, const parser_options& opts)
+	{
+		// the file contents don't outlive the parse, so they can't be borrowed
+		auto file_opts = opts;
+		file_opts.borrow_input = false;
+		return parse_file<NoThrow>(path, opts, [&file_opts](std::string_view toml) {
+			if (file_opts.threads != 1)
+				return parse_toml_parallel<NoThrow>(toml, file_opts);
+			return parse_toml<NoThrow>(toml, file_opts);
+		});
+	}
+
+	template<bool NoThrow>
+	bool parse(const std::filesystem::path& path, const parser_options& opts, parse_handler& handler)
+	{
+		return parse_file<NoThrow>(path, opts, [&opts, &handler](std::string_view toml) {
+			return parse_toml<NoThrow>(toml, handler, opts);
+		});
 	}
 
 	root_node parse(std::string_view toml)
 	{
-		return parse<false>(toml);
+		return parse<false>(toml, parser_options{});
 	}
 
 	root_node parse(const std::string& toml)
@@ -4332,38 +6949,168 @@ namespace another_toml
 		return parse(std::string_view{ toml });
 	}
 
+	root_node parse(std::string_view toml, const parser_options& opts)
+	{
+		return parse<false>(toml, opts);
+	}
+
+	root_node parse(const std::string& toml, const parser_options& opts)
+	{
+		return parse(std::string_view{ toml }, opts);
+	}
+
+	root_node parse(const char* toml, const parser_options& opts)
+	{
+		return parse(std::string_view{ toml }, opts);
+	}
+
 	root_node parse(std::istream& strm)
 	{
-		return parse<false>(strm);
+		return parse<false>(strm, parser_options{});
+	}
+
+	root_node parse(std::istream& strm, const parser_options& opts)
+	{
+		return parse<false>(strm, opts);
 	}
 
 	root_node parse(const std::filesystem::path& path)
 	{
-		return parse<false>(path);
+		return parse<false>(path, parser_options{});
+	}
+
+	root_node parse(const std::filesystem::path& path, const parser_options& opts)
+	{
+		return parse<false>(path, opts);
 	}
 
 	root_node parse(std::string_view toml, no_throw_t)
 	{
-		return parse<true>(toml);
+		return parse<true>(toml, parser_options{});
 	}
 
 	root_node parse(const std::string& toml, no_throw_t)
 	{
-		return parse<true>(std::string_view{ toml });
+		return parse<true>(std::string_view{ toml }, parser_options{});
 	}
 
 	root_node parse(const char* toml, no_throw_t)
 	{
-		return parse<true>(std::string_view{ toml });
+		return parse<true>(std::string_view{ toml }, parser_options{});
+	}
+
+	root_node parse(std::string_view toml, const parser_options& opts, no_throw_t)
+	{
+		return parse<true>(toml, opts);
+	}
+
+	root_node parse(const std::string& toml, const parser_options& opts, no_throw_t)
+	{
+		return parse<true>(std::string_view{ toml }, opts);
+	}
+
+	root_node parse(const char* toml, const parser_options& opts, no_throw_t)
+	{
+		return parse<true>(std::string_view{ toml }, opts);
 	}
 
 	root_node parse(std::istream& strm, no_throw_t)
 	{
-		return parse<true>(strm);
+		return parse<true>(strm, parser_options{});
+	}
+
+	root_node parse(std::istream& strm, const parser_options& opts, no_throw_t)
+	{
+		return parse<true>(strm, opts);
 	}
 
 	root_node parse(const std::filesystem::path& filename, no_throw_t)
 	{
-		return parse<true>(filename);
+		return parse<true>(filename, parser_options{});
+	}
+
+	root_node parse(const std::filesystem::path& filename, const parser_options& opts, no_throw_t)
+	{
+		return parse<true>(filename, opts);
+	}
+
+	bool parse(std::string_view toml, parse_handler& handler)
+	{
+		return parse_toml<false>(toml, handler);
+	}
+
+	bool parse(const std::string& toml, parse_handler& handler)
+	{
+		return parse(std::string_view{ toml }, handler);
+	}
+
+	bool parse(const char* toml, parse_handler& handler)
+	{
+		return parse(std::string_view{ toml }, handler);
+	}
+
+	bool parse(std::string_view toml, const parser_options& opts, parse_handler& handler)
+	{
+		return parse_toml<false>(toml, handler, opts);
+	}
+
+	bool parse(const std::string& toml, const parser_options& opts, parse_handler& handler)
+	{
+		return parse(std::string_view{ toml }, opts, handler);
+	}
+
+	bool parse(const char* toml, const parser_options& opts, parse_handler& handler)
+	{
+		return parse(std::string_view{ toml }, opts, handler);
+	}
+
+	bool parse(const std::filesystem::path& filename, parse_handler& handler)
+	{
+		return parse<false>(filename, parser_options{}, handler);
+	}
+
+	bool parse(const std::filesystem::path& filename, const parser_options& opts, parse_handler& handler)
+	{
+		return parse<false>(filename, opts, handler);
+	}
+
+	bool parse(std::string_view toml, parse_handler& handler, no_throw_t)
+	{
+		return parse_toml<true>(toml, handler);
+	}
+
+	bool parse(const std::string& toml, parse_handler& handler, no_throw_t)
+	{
+		return parse_toml<true>(std::string_view{ toml }, handler);
+	}
+
+	bool parse(const char* toml, parse_handler& handler, no_throw_t)
+	{
+		return parse_toml<true>(std::string_view{ toml }, handler);
+	}
+
+	bool parse(std::string_view toml, const parser_options& opts, parse_handler& handler, no_throw_t)
+	{
+		return parse_toml<true>(toml, handler, opts);
+	}
+
+	bool parse(const std::string& toml, const parser_options& opts, parse_handler& handler, no_throw_t)
+	{
+		return parse_toml<true>(std::string_view{ toml }, handler, opts);
+	}
+
+	bool parse(const char* toml, const parser_options& opts, parse_handler& handler, no_throw_t)
+	{
+		return parse_toml<true>(std::string_view{ toml }, handler, opts);
+	}
+
+	bool parse(const std::filesystem::path& filename, parse_handler& handler, no_throw_t)
+	{
+		return parse<true>(filename, parser_options{}, handler);
+	}
+
+	bool parse(const std::filesystem::path& filename, const parser_options& opts, parse_handler& handler, no_throw_t)
+	{
+		return parse<true>(filename, opts, handler);
 	}
 }
@@ -27,8 +27,8 @@
 #include <charconv>
 #include <iostream>
 #include <locale>
+#include <new>
 #include <optional>
-#include <regex>
 #include <sstream>
 
 #include "uni_algo/conv.h"
@@ -67,10 +67,119 @@ namespace another_toml
 			off_minues
 		};
 	}
-	using reg_matches = std::match_results<std::string_view::iterator>;
+	// A sub string matched by match_date_time.
+	// Mirrors the parts of std::sub_match used by fill_date and fill_time.
+	struct date_time_part
+	{
+		const char* first = {};
+		const char* second = {};
+		bool matched = false;
+
+		std::size_t length() const noexcept
+		{
+			return static_cast<std::size_t>(second - first);
+		}
+	};
+
+	// Parts of a date/time string, indexed by match_index
+	using date_time_matches = std::array<date_time_part,
+		static_cast<std::size_t>(match_index::off_minues) + 1>;
+
+	static constexpr bool is_digit(char c) noexcept
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// Returns true if str contains 'count' digits starting at 'pos'
+	static bool digits_at(std::string_view str, std::size_t pos, std::size_t count) noexcept
+	{
+		if (pos + count > size(str))
+			return false;
+
+		for (auto i = pos; i < pos + count; ++i)
+		{
+			if (!is_digit(str[i]))
+				return false;
+		}
+		return true;
+	}
+
+	static void set_part(date_time_matches& matches, match_index i, std::string_view str,
+		std::size_t first, std::size_t last) noexcept
+	{
+		auto& part = matches[static_cast<std::size_t>(i)];
+		part.first = data(str) + first;
+		part.second = data(str) + last;
+		part.matched = true;
+		return;
+	}
+
+	// Splits an RFC 3339 date/time string into its parts, all parts are optional:
+	//	((YYYY)-(MM)-(DD))?([Tt ])?((hh):(mm):(ss)(.frac)?)?(([zZ])|(([+-])(hh):(mm)))?
+	// Returns false if str contains anything else.
+	static bool match_date_time(std::string_view str, date_time_matches& matches) noexcept
+	{
+		const auto sz = size(str);
+		auto pos = std::size_t{};
+
+		if (sz >= 10 && digits_at(str, 0, 4) && str[4] == '-' &&
+			digits_at(str, 5, 2) && str[7] == '-' && digits_at(str, 8, 2))
+		{
+			set_part(matches, match_index::date, str, 0, 10);
+			set_part(matches, match_index::year, str, 0, 4);
+			set_part(matches, match_index::month, str, 5, 7);
+			set_part(matches, match_index::day, str, 8, 10);
+			pos = 10;
+		}
+
+		if (pos < sz && (str[pos] == 'T' || str[pos] == 't' || str[pos] == ' '))
+		{
+			set_part(matches, match_index::date_time_seperator, str, pos, pos + 1);
+			++pos;
+		}
+
+		if (pos + 8 <= sz && digits_at(str, pos, 2) && str[pos + 2] == ':' &&
+			digits_at(str, pos + 3, 2) && str[pos + 5] == ':' && digits_at(str, pos + 6, 2))
+		{
+			const auto time_begin = pos;
+			set_part(matches, match_index::hours, str, pos, pos + 2);
+			set_part(matches, match_index::minues, str, pos + 3, pos + 5);
+			set_part(matches, match_index::seconds, str, pos + 6, pos + 8);
+			pos += 8;
+
+			if (pos + 1 < sz && str[pos] == '.' && is_digit(str[pos + 1]))
+			{
+				const auto frac_begin = pos++;
+				while (pos < sz && is_digit(str[pos]))
+					++pos;
+				set_part(matches, match_index::seconds_frac, str, frac_begin, pos);
+			}
+
+			set_part(matches, match_index::time, str, time_begin, pos);
+		}
+
+		if (pos < sz && (str[pos] == 'Z' || str[pos] == 'z'))
+		{
+			set_part(matches, match_index::offset, str, pos, pos + 1);
+			set_part(matches, match_index::off_z, str, pos, pos + 1);
+			++pos;
+		}
+		else if (pos + 6 <= sz && (str[pos] == '+' || str[pos] == '-') &&
+			digits_at(str, pos + 1, 2) && str[pos + 3] == ':' && digits_at(str, pos + 4, 2))
+		{
+			set_part(matches, match_index::offset, str, pos, pos + 6);
+			set_part(matches, match_index::off_unused, str, pos, pos + 6);
+			set_part(matches, match_index::off_sign, str, pos, pos + 1);
+			set_part(matches, match_index::off_hours, str, pos + 1, pos + 3);
+			set_part(matches, match_index::off_minues, str, pos + 4, pos + 6);
+			pos += 6;
+		}
+
+		return pos == sz;
+	}
 
 	template<bool NoThrow>
-	static std::optional<date> fill_date(const reg_matches& matches) noexcept(NoThrow)
+	static std::optional<date> fill_date(const date_time_matches& matches, std::ostream& errors) noexcept(NoThrow)
 	{
 		auto out = date{};
 		assert(matches[static_cast<std::size_t>(match_index::date)].matched);
@@ -84,7 +193,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << years_range;
+				errors << years_range;
 				return {};
 			}
 			else throw parsing_error{ years_range };
@@ -95,7 +204,7 @@ namespace another_toml
 			constexpr auto year_error = "Error parsing year.\n";
 			if constexpr (NoThrow)
 			{
-				std::cerr << year_error;
+				errors << year_error;
 				return {};
 			}
 			else throw parsing_error{ year_error };
@@ -111,7 +220,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << month_range;
+				errors << month_range;
 				return {};
 			}
 			else throw parsing_error{ month_range };
@@ -122,7 +231,7 @@ namespace another_toml
 			constexpr auto month_error = "Error parsing month.\n";
 			if constexpr (NoThrow)
 			{
-				std::cerr << month_error;
+				errors << month_error;
 				return {};
 			}
 			else throw parsing_error{ month_error };
@@ -132,7 +241,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << month_range;
+				errors << month_range;
 				return {};
 			}
 			else throw parsing_error{ month_range };
@@ -149,7 +258,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << day_range;
+				errors << day_range;
 				return {};
 			}
 			else throw parsing_error{ day_range };
@@ -160,7 +269,7 @@ namespace another_toml
 			constexpr auto day_error = "Error parsing day value.\n";
 			if constexpr (NoThrow)
 			{
-				std::cerr << day_error;
+				errors << day_error;
 				return {};
 			}
 			else throw parsing_error{ day_error };
@@ -189,7 +298,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << day_range;
+				errors << day_range;
 				return {};
 			}
 			else throw parsing_error{ day_range };
@@ -199,7 +308,7 @@ namespace another_toml
 	}
 
 	template<bool NoThrow>
-	static std::optional<time> fill_time(const reg_matches& matches) noexcept(NoThrow)
+	static std::optional<time> fill_time(const date_time_matches& matches, std::ostream& errors) noexcept(NoThrow)
 	{
 		auto out = time{};
 		assert(matches[static_cast<std::size_t>(match_index::time)].matched);
@@ -212,7 +321,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << hour_error;
+				errors << hour_error;
 				return {};
 			}
 			else throw parsing_error{ hour_error };
@@ -222,7 +331,7 @@ namespace another_toml
 			constexpr auto hours_error2 = "Error while parsing hours.\n";
 			if constexpr (NoThrow)
 			{
-				std::cerr << hours_error2;
+				errors << hours_error2;
 				return {};
 			}
 			else throw parsing_error{ hours_error2 };
@@ -232,7 +341,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << hour_error;
+				errors << hour_error;
 				return {};
 			}
 			else throw parsing_error{ hour_error };
@@ -247,7 +356,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << minutes_range;
+				errors << minutes_range;
 				return {};
 			}
 			else throw parsing_error{ minutes_range };
@@ -258,7 +367,7 @@ namespace another_toml
 			constexpr auto minutes_error2 = "Error parsing minutes.\n";
 			if constexpr (NoThrow)
 			{
-				std::cerr << minutes_error2;
+				errors << minutes_error2;
 				return{};
 			}
 			else throw parsing_error{ minutes_error2 };
@@ -268,7 +377,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << minutes_range;
+				errors << minutes_range;
 				return {};
 			}
 			else throw parsing_error{ minutes_range };
@@ -285,7 +394,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << seconds_error;
+				errors << seconds_error;
 				return {};
 			}
 			else throw parsing_error{ seconds_error };
@@ -296,7 +405,7 @@ namespace another_toml
 			constexpr auto seconds_error2 = "Error parsing seconds.\n";
 			if constexpr (NoThrow)
 			{
-				std::cerr << seconds_error2;
+				errors << seconds_error2;
 				return{};
 			}
 			else throw parsing_error{ seconds_error2 };
@@ -306,7 +415,7 @@ namespace another_toml
 		{
 			if constexpr (NoThrow)
 			{
-				std::cerr << seconds_error;
+				errors << seconds_error;
 				return {};
 			}
 			else throw parsing_error{ seconds_error };
@@ -328,7 +437,7 @@ namespace another_toml
 				constexpr auto seconds_frac_error = "Error parsing seconds fractional component.\n";
 				if constexpr (NoThrow)
 				{
-					std::cerr << seconds_frac_error;
+					errors << seconds_frac_error;
 					return{};
 				}
 				else throw parsing_error{ seconds_frac_error };
@@ -339,10 +448,10 @@ namespace another_toml
 	}
 
 	template<bool NoThrow>
-	static std::optional<local_date_time> fill_date_time(const reg_matches& matches) noexcept(NoThrow)
+	static std::optional<local_date_time> fill_date_time(const date_time_matches& matches, std::ostream& errors) noexcept(NoThrow)
 	{
-		const auto date = fill_date<NoThrow>(matches);
-		const auto time = fill_time<NoThrow>(matches);
+		const auto date = fill_date<NoThrow>(matches, errors);
+		const auto time = fill_time<NoThrow>(matches, errors);
 
 		if (!date || !time)
 			return {};
@@ -351,12 +460,10 @@ namespace another_toml
 	}
 
 	template<bool NoThrow>
-	std::variant<std::monostate, date, time, date_time, local_date_time> parse_date_time_ex(std::string_view str) noexcept(NoThrow)
+	std::variant<std::monostate, date, time, date_time, local_date_time> parse_date_time_ex(std::string_view str, std::ostream& errors) noexcept(NoThrow)
 	{
-		constexpr auto date_time_reg =
-			R"(^((\d{4})-(\d{2})-(\d{2}))?([Tt ])?((\d{2}):(\d{2}):(\d{2})(\.\d+)?)?(([zZ])|(([\+\-])(\d{2}):(\d{2})))?)";
-		if (auto matches = std::match_results<std::string_view::iterator>{};
-			std::regex_match(begin(str), end(str), matches, std::regex{ date_time_reg }))
+		if (auto matches = date_time_matches{};
+			match_date_time(str, matches))
 		{
 			//date
 			const auto& date = matches[static_cast<std::size_t>(match_index::date)];
@@ -385,7 +492,7 @@ namespace another_toml
 
 			if (offset_date_time)
 			{
-				const auto dt = fill_date_time<NoThrow>(matches);
+				const auto dt = fill_date_time<NoThrow>(matches, errors);
 				if (dt)
 				{
 					auto odt = date_time{ *dt, false };
@@ -414,7 +521,7 @@ namespace another_toml
 					{
 						if constexpr (NoThrow)
 						{
-							std::cerr << hours_range;
+							errors << hours_range;
 							return {};
 						}
 						else throw parsing_error{ hours_range };
@@ -426,7 +533,7 @@ namespace another_toml
 						{
 							if constexpr (NoThrow)
 							{
-								std::cerr << hours_range;
+								errors << hours_range;
 								return {};
 							}
 							else throw parsing_error{ hours_range };
@@ -442,7 +549,7 @@ namespace another_toml
 						{
 							if constexpr (NoThrow)
 							{
-								std::cerr << minutes_range;
+								errors << minutes_range;
 								return {};
 							}
 							else throw parsing_error{ minutes_range };
@@ -456,7 +563,7 @@ namespace another_toml
 							{
 								if constexpr (NoThrow)
 								{
-									std::cerr << minutes_range;
+									errors << minutes_range;
 									return {};
 								}
 								else throw parsing_error{ minutes_range };
@@ -467,19 +574,19 @@ namespace another_toml
 			}
 			else if (local_date_time)
 			{
-				auto dt = fill_date_time<NoThrow>(matches);
+				auto dt = fill_date_time<NoThrow>(matches, errors);
 				if (dt)
 					return *dt;
 			}
 			else if (local_date)
 			{
-				auto d = fill_date<NoThrow>(matches);
+				auto d = fill_date<NoThrow>(matches, errors);
 				if (d)
 					return *d;
 			}
 			else if (local_time)
 			{
-				auto t = fill_time<NoThrow>(matches);
+				auto t = fill_time<NoThrow>(matches, errors);
 				if (t)
 					return *t;
 			}
@@ -493,28 +600,87 @@ namespace another_toml
 			throw parsing_error{ "Error parsing value.\n"s };
 	}
 
-	template std::variant<std::monostate, date, time, date_time, local_date_time> parse_date_time_ex<false>(std::string_view str);
+	template std::variant<std::monostate, date, time, date_time, local_date_time> parse_date_time_ex<true>(std::string_view, std::ostream&);
+	template std::variant<std::monostate, date, time, date_time, local_date_time> parse_date_time_ex<false>(std::string_view, std::ostream&);
 
 	std::variant<std::monostate, date, time, date_time, local_date_time> parse_date_time(std::string_view str) noexcept
 	{
-		return parse_date_time_ex<true>(str);
+		return parse_date_time_ex<true>(str, std::cerr);
 	}
 
-	// removes underscores and leading positive signs from sv
-	std::string remove_underscores(std::string_view sv)
+	// Skips a run of digits starting at 'pos', single underscores are allowed between digits.
+	// Returns the position after the run, or npos if the run was empty or contained
+	// a misplaced underscore.
+	template<typename IsDigit>
+	static std::size_t skip_digits(std::string_view str, std::size_t pos, IsDigit is_digit_char) noexcept
 	{
-		auto str = std::string{ sv };
-		for (auto iter = begin(str); iter != std::end(str); ++iter)
+		const auto sz = size(str);
+		if (pos >= sz || !is_digit_char(str[pos]))
+			return std::string_view::npos;
+
+		++pos;
+		while (pos < sz)
 		{
-			if (*iter == '_')
-				iter = str.erase(iter);
+			if (str[pos] == '_')
+			{
+				if (pos + 1 >= sz || !is_digit_char(str[pos + 1]))
+					return std::string_view::npos;
+				pos += 2;
+			}
+			else if (is_digit_char(str[pos]))
+				++pos;
+			else
+				break;
 		}
-		if (!empty(str) && str.front() == '+')
-			str.erase(begin(str));
-		return str;
+
+		return pos;
 	}
 
-	parse_float_string_return parse_float_string(std::string_view str)
+	// Tests for the TOML float syntax (excluding inf and nan)
+	//	[+-]?(0|[1-9](_?[0-9])*)(.[0-9](_?[0-9])*)?([eE][+-]?[0-9]+(_[0-9]+)?)?
+	// 'exponent' is set if the exponent part was present.
+	static bool valid_float_string(std::string_view str, bool& exponent) noexcept
+	{
+		const auto sz = size(str);
+		auto pos = std::size_t{};
+		if (pos < sz && (str[pos] == '+' || str[pos] == '-'))
+			++pos;
+
+		if (pos >= sz)
+			return false;
+
+		if (str[pos] == '0')
+			++pos;
+		else if (str[pos] != '_')
+			pos = skip_digits(str, pos, is_digit);
+		else
+			return false;
+
+		if (pos < sz && str[pos] == '.')
+			pos = skip_digits(str, pos + 1, is_digit);
+
+		if (pos < sz && (str[pos] == 'e' || str[pos] == 'E'))
+		{
+			++pos;
+			if (pos < sz && (str[pos] == '+' || str[pos] == '-'))
+				++pos;
+
+			const auto exp_begin = pos;
+			pos = skip_digits(str, pos, is_digit);
+			// only a single underscore is accepted in the exponent
+			if (pos == std::string_view::npos ||
+				std::count(begin(str) + exp_begin, begin(str) + pos, '_') > 1)
+				return false;
+			exponent = true;
+		}
+
+		return pos == sz;
+	}
+
+	// Float strings up to this length are converted without a heap allocation
+	constexpr auto float_buffer_size = std::size_t{ 64 };
+
+	parse_float_string_return parse_float_string(std::string_view str) noexcept
 	{
 		using error_t = parse_float_string_return::error_t;
 
@@ -527,29 +693,177 @@ namespace another_toml
 		if (str == "nan"sv || str == "+nan"sv || str == "-nan"sv)
 			return parse_float_string_return{ std::numeric_limits<double>::quiet_NaN() };
 
-		constexpr auto float_reg = R"(^[\+\-]?([1-9]+(_?([\d])+)*|0)(\.[\d]+(_?[\d])*)?([eE][\+\-]?[\d]+(_?[\d]+)?)?$)";
-		if (auto matches = std::match_results<std::string_view::iterator>{};
-			std::regex_match(begin(str), end(str), matches, std::regex{float_reg}))
+		auto exponent = false;
+		if (!valid_float_string(str, exponent))
+			return parse_float_string_return{ {}, {}, error_t::bad };
+
+		// copy str without underscores or a leading '+' for from_chars
+		// only very long values need a heap allocation
+		auto buffer = std::array<char, float_buffer_size>{};
+		auto long_buffer = std::string{};
+		auto first = buffer.data();
+		if (size(str) > float_buffer_size)
+		{
+			try
+			{
+				long_buffer.resize(size(str));
+			}
+			catch (const std::bad_alloc&)
+			{
+				return parse_float_string_return{ {}, {}, error_t::bad };
+			}
+			first = long_buffer.data();
+		}
+
+		auto last = first;
+		for (auto i = std::size_t{}; i < size(str); ++i)
+		{
+			if (str[i] == '_' || (i == 0 && str[i] == '+'))
+				continue;
+			*last++ = str[i];
+		}
+
+		auto floating_val = double{};
+		const auto ret = std::from_chars(first, last, floating_val);
+		if (ret.ec == std::errc::result_out_of_range)
+			return parse_float_string_return{ {}, {}, error_t::out_of_range };
+		else if (ret.ec != std::errc{} || ret.ptr != last)
+			return parse_float_string_return{ {}, {}, error_t::bad };
+
+		const auto rep = exponent ? float_rep::scientific : float_rep::default;
+		return parse_float_string_return{ floating_val, rep };
+	}
+
+	bool float_string_in_range(std::string_view str) noexcept
+	{
+		// longer strings would need parse_float_string to allocate
+		if (size(str) > float_buffer_size)
+			return false;
+
+		if (str == "inf"sv || str == "+inf"sv || str == "-inf"sv ||
+			str == "nan"sv || str == "+nan"sv || str == "-nan"sv)
+			return true;
+
+		auto exponent = false;
+		if (!valid_float_string(str, exponent))
+			return false;
+
+		// a non-zero value with 'digits' digits and exponent 'exp' lies between
+		// 10^-(digits + |exp|) and 10^(digits + |exp|), well within the range of double
+		constexpr auto max_magnitude = 300;
+		auto digits = 0;
+		auto pos = std::size_t{};
+		for (; pos < size(str) && str[pos] != 'e' && str[pos] != 'E'; ++pos)
+		{
+			if (is_digit(str[pos]) && ++digits >= max_magnitude)
+				return false;
+		}
+
+		auto exp = 0;
+		for (; pos < size(str); ++pos)
+		{
+			if (!is_digit(str[pos]))
+				continue;
+			exp = exp * 10 + (str[pos] - '0');
+			if (exp >= max_magnitude)
+				return false;
+		}
+
+		return digits + exp < max_magnitude;
+	}
+
+	parse_integer_string_return parse_integer_string(std::string_view str) noexcept
+	{
+		using error_t = parse_integer_string_return::error_t;
+		constexpr auto bad = parse_integer_string_return{ {}, {}, error_t::bad };
+
+		const auto sz = size(str);
+		auto pos = std::size_t{};
+		auto base = int_base::dec;
+		auto radix = std::uint64_t{ 10 };
+		auto negative = false;
+
+		// prefixed values: 0x, 0o, 0b (these can't have a sign)
+		if (sz > 2 && str[0] == '0')
 		{
-			const auto string = remove_underscores(str);
-			auto floating_val = double{};
-			auto rep = float_rep::default;
-			const auto string_end = &string[0] + size(string);
-			const auto ret = std::from_chars(&string[0], string_end, floating_val);
-			if (ret.ec == std::errc::result_out_of_range)
-				return parse_float_string_return{ {}, {}, error_t::out_of_range };
-			else if (ret.ptr == string_end)
+			switch (str[1])
 			{
-				// The sub match that contains the scientific notation portion
-				// of a float
-				constexpr auto scientific_e = 6;
-				if (matches[scientific_e].matched)
-					rep = float_rep::scientific;
-				return parse_float_string_return{ floating_val, rep };
+			case 'x':
+				base = int_base::hex;
+				radix = 16;
+				break;
+			case 'o':
+				base = int_base::oct;
+				radix = 8;
+				break;
+			case 'b':
+				base = int_base::bin;
+				radix = 2;
+				break;
+			}
+
+			if (base != int_base::dec)
+				pos = 2;
+		}
+
+		if (base == int_base::dec)
+		{
+			if (pos < sz && (str[pos] == '+' || str[pos] == '-'))
+			{
+				negative = str[pos] == '-';
+				++pos;
+			}
+
+			// no leading zeros
+			if (pos < sz && str[pos] == '0')
+			{
+				if (pos + 1 == sz)
+					return parse_integer_string_return{ {}, base };
+				return bad;
+			}
+		}
+
+		const auto is_base_digit = [radix](char c) noexcept {
+			switch (radix)
+			{
+			case 2:
+				return c == '0' || c == '1';
+			case 8:
+				return c >= '0' && c <= '7';
+			case 16:
+				return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+			default:
+				return is_digit(c);
 			}
+		};
+
+		if (skip_digits(str, pos, is_base_digit) != sz)
+			return bad;
+
+		// convert, checking against the storable range as we go
+		constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+		const auto limit = negative ? max + 1 : max;
+		auto value = std::uint64_t{};
+		for (; pos < sz; ++pos)
+		{
+			const auto c = str[pos];
+			if (c == '_')
+				continue;
+
+			const auto digit = static_cast<std::uint64_t>(is_digit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+			if (value > (limit - digit) / radix)
+				return parse_integer_string_return{ {}, base, error_t::out_of_range };
+			value = value * radix + digit;
 		}
 
-		return parse_float_string_return{ {}, {}, error_t::bad };
+		if (negative)
+		{
+			if (value == limit)
+				return parse_integer_string_return{ std::numeric_limits<std::int64_t>::min(), base };
+			return parse_integer_string_return{ -static_cast<std::int64_t>(value), base };
+		}
+
+		return parse_integer_string_return{ static_cast<std::int64_t>(value), base };
 	}
 
 	namespace
@@ -675,16 +989,58 @@ namespace another_toml
 	// defined in another_toml.cpp
 	std::string_view block_control(std::string_view s) noexcept;
 
-	// replace string chars with proper escape codes
+	// Writes the UTF-8 encoding of a valid code point to out.
+	// Returns the number of chars written.
+	static std::size_t encode_utf8(const char32_t ch, char* out) noexcept
+	{
+		if (ch < 0x80)
+		{
+			out[0] = static_cast<char>(ch);
+			return 1;
+		}
+		else if (ch < 0x800)
+		{
+			out[0] = static_cast<char>(0xC0 | (ch >> 6));
+			out[1] = static_cast<char>(0x80 | (ch & 0x3F));
+			return 2;
+		}
+		else if (ch < 0x10000)
+		{
+			out[0] = static_cast<char>(0xE0 | (ch >> 12));
+			out[1] = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+			out[2] = static_cast<char>(0x80 | (ch & 0x3F));
+			return 3;
+		}
+
+		out[0] = static_cast<char>(0xF0 | (ch >> 18));
+		out[1] = static_cast<char>(0x80 | ((ch >> 12) & 0x3F));
+		out[2] = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+		out[3] = static_cast<char>(0x80 | (ch & 0x3F));
+		return 4;
+	}
+
+	// replace escape codes in s with the chars they represent.
+	// Every escape code is longer than its replacement, so s is rewritten in place,
+	// strings without any escape codes aren't modified at all.
+	// NoThrow errors are written to errors
 	// TODO: better error messages whereever this is called
 	template<bool NoThrow, bool Pairs = false>
-	std::optional<std::string> replace_escape_chars(std::string_view str)
+	bool replace_escape_chars(std::string& s, std::ostream& errors)
 	{
-		auto s = std::string{ str };
-		auto pos = std::size_t{};
-		while (pos < size(s))
+		auto read = s.find('\\');
+		if (read == std::string::npos)
+			return true;
+
+		// read is always ahead of write, so the unread part of s is unchanged
+		auto write = read;
+		while (read < size(s))
 		{
-			const auto code_beg = s.find("\\", pos);
+			// move the chars before the next escape code in one go
+			const auto code_beg = s.find('\\', read);
+			const auto run_end = code_beg == std::string::npos ? size(s) : code_beg;
+			if (write != read)
+				std::copy(next(begin(s), read), next(begin(s), run_end), next(begin(s), write));
+			write += run_end - read;
 			if (code_beg == std::string::npos)
 				break; //we're done
 
@@ -693,45 +1049,38 @@ namespace another_toml
 			{
 				if constexpr (NoThrow)
 				{
-					std::cerr << "Invalid escape code: unmatched '\'\n"s;
-					return {};
+					errors << "Invalid escape code: unmatched '\'\n"s;
+					return false;
 				}
 				else
 					throw unicode_error{ "Invalid escape code: unmatched '\'\n"s };
 			}
 
 			auto code_end = code_mid + 1;
-			
+			auto simple_escape = char{};
 			switch (s[code_mid])
 			{
 			case 'b':
-				s.replace(code_beg, 2, 1, '\b');
-				pos = code_beg + 1;
-				continue;
+				simple_escape = '\b';
+				break;
 			case 'n':
-				s.replace(code_beg, 2, 1, '\n');
-				pos = code_beg + 1;
-				continue;
+				simple_escape = '\n';
+				break;
 			case 'f':
-				s.replace(code_beg, 2, 1, '\f');
-				pos = code_beg + 1;
-				continue;
+				simple_escape = '\f';
+				break;
 			case 'r':
-				s.replace(code_beg, 2, 1, '\r');
-				pos = code_beg + 1;
-				continue;
+				simple_escape = '\r';
+				break;
 			case '\"':
-				s.replace(code_beg, 2, 1, '\"');
-				pos = code_beg + 1;
-				continue;
+				simple_escape = '\"';
+				break;
 			case '\\':
-				s.replace(code_beg, 2, 1, '\\');
-				pos = code_beg + 1;
-				continue;
+				simple_escape = '\\';
+				break;
 			case 't':
-				s.replace(code_beg, 2, 1, '\t');
-				pos = code_beg + 1;
-				continue;
+				simple_escape = '\t';
+				break;
 			case 'u': // unicode \uHHHH
 				code_end = code_mid + 5;
 				break;
@@ -744,8 +1093,8 @@ namespace another_toml
 			//	break;
 			default:
 			{
-				const auto write_error = [str, code_mid](std::ostream& o) {
-					const auto string = std::string_view{ &str[code_mid] };
+				const auto write_error = [&s, code_mid](std::ostream& o) {
+					const auto string = std::string_view{ s }.substr(code_mid);
 					auto graph_rng = uni::ranges::grapheme::utf8_view{ string };
 					o << "Illigal escape code in quoted string: \"\\"s <<
 						block_control(*begin(graph_rng)) <<
@@ -754,8 +1103,8 @@ namespace another_toml
 
 				if constexpr (NoThrow)
 				{
-					write_error(std::cerr);
-					return {};
+					write_error(errors);
+					return false;
 				}
 				else
 				{
@@ -766,46 +1115,57 @@ namespace another_toml
 			}
 			}
 
-			// Unicode chars are 1-4 bytes, the escape code is at least 6 chars
-			// so the resulting string will always be shorter, string won't have
-			// to alloc.
+			if (simple_escape != char{})
+			{
+				s[write++] = simple_escape;
+				read = code_end;
+				continue;
+			}
+
 			const auto escape_size = code_end - code_beg;
+			const auto write_unicode_error = [&s, code_beg, escape_size](std::ostream& o) {
+				o << "Invalid unicode escape code: "s << std::string_view{ s }.substr(code_beg, escape_size);
+			};
 
 			if (size(s) < code_end)
 			{
 				if constexpr (NoThrow)
 				{
-					std::cerr << "Invalid unicode escape code: "s << std::string_view{ &s[code_beg], escape_size } << '\n';
-					return {};
+					write_unicode_error(errors);
+					errors << '\n';
+					return false;
 				}
 				else
-					throw unicode_error{ "Invalid unicode escape code: "s + std::string{ &s[code_beg], escape_size} };
+				{
+					auto string = std::ostringstream{};
+					write_unicode_error(string);
+					throw unicode_error{ string.str() };
+				}
 			}
 
 			auto int_val = std::uint_least32_t{};
 			const auto result = std::from_chars(&s[code_mid + 1], &s[code_end], int_val, 16);
 			static_assert(sizeof(std::uint_least32_t) <= sizeof(char32_t));
-				
+
 			// parse surragate pairs
 			if constexpr (Pairs)
 			{
-				if (int_val >= 0xD800 && int_val <= 0xDFFF)
+				if (result.ptr == &s[code_end] &&
+					int_val >= 0xD800 && int_val <= 0xDBFF &&
+					code_end + 5 < size(s) &&
+					s[code_end] == '\\' &&
+					s[code_end + 1] == 'u')
 				{
-					auto str = std::u16string{ { static_cast<char16_t>(int_val), {} } };
-					if (code_end + 5 < size(s) && 
-						s[code_end] == '\\' &&
-						s[code_end+1] == 'u')
+					//second part of JSON surrogate pair
+					auto low = std::uint_least32_t{};
+					const auto low_result = std::from_chars(&s[code_end + 2], &s[code_end + 6], low, 16);
+					if (low_result.ptr == &s[code_end + 6] &&
+						low >= 0xDC00 && low <= 0xDFFF)
 					{
-						//second part of JSON surrogate pair
-						std::from_chars(&s[code_end + 2], &s[code_end + 6], int_val, 16);
-						str[1] = static_cast<char16_t>(int_val);
-						if (uni::is_valid_utf16(str))
-						{
-							const auto u8 = uni::utf16to8(str);
-							s.replace(code_beg, escape_size * 2, u8);
-							pos = code_beg + size(u8);
-							continue;
-						}
+						const auto unicode_char = static_cast<char32_t>(0x10000 + ((int_val - 0xD800) << 10) + (low - 0xDC00));
+						write += encode_utf8(unicode_char, &s[write]);
+						read = code_end + escape_size;
+						continue;
 					}
 				}
 			}
@@ -817,29 +1177,37 @@ namespace another_toml
 			{
 				if constexpr (NoThrow)
 				{
-					std::cerr << "Invalid unicode escape code: "s << std::string_view{ &s[code_beg], escape_size } << '\n';
-					return {};
+					write_unicode_error(errors);
+					errors << '\n';
+					return false;
 				}
 				else
-					throw unicode_error{ "Invalid unicode escape code: "s + std::string{ &s[code_beg], escape_size} };
+				{
+					auto string = std::ostringstream{};
+					write_unicode_error(string);
+					throw unicode_error{ string.str() };
+				}
 			}
 
-			const auto u8 = unicode_u32_to_u8(unicode_char);
-			s.replace(code_beg, escape_size, u8);
-			pos = code_beg + size(u8);
+			write += encode_utf8(unicode_char, &s[write]);
+			read = code_end;
 		}
 
-		return s;
+		s.resize(write);
+		return true;
 	}
 
-	// instantiate with true for another_toml.cpp to use
-	template std::optional<std::string> replace_escape_chars<true>(std::string_view);
+	// instantiate for another_toml.cpp to use
+	template bool replace_escape_chars<true>(std::string&, std::ostream&);
+	template bool replace_escape_chars<false>(std::string&, std::ostream&);
 
 	constexpr auto no_throw_flag = false;
 
 	std::string to_unescaped_string(std::string_view str)
 	{
-		return *replace_escape_chars<no_throw_flag>(str);
+		auto s = std::string{ str };
+		replace_escape_chars<no_throw_flag>(s, std::cerr);
+		return s;
 	}
 
 	// same as above, except it also matches surrogate pair escape codes, 
@@ -848,7 +1216,9 @@ namespace another_toml
 	std::string to_unescaped_string2(std::string_view str)
 	{
 		constexpr auto surrogate_pairs = true;
-		return *replace_escape_chars<no_throw_flag, surrogate_pairs>(str);
+		auto s = std::string{ str };
+		replace_escape_chars<no_throw_flag, surrogate_pairs>(s, std::cerr);
+		return s;
 	}
 
 	std::string to_escaped_multiline(std::string_view str)
@@ -862,7 +1232,7 @@ namespace another_toml
 	}
 
 	// based on uni_algo/examples/cpp_ranges.h
-	bool unicode_string_equal(std::string_view lhs, std::string_view rhs)
+	bool unicode_string_equal(std::string_view lhs, std::string_view rhs) noexcept
 	{
 		// UTF-8 -> NFC for both strings
 		auto view1 = uni::ranges::norm::nfc_view{ uni::ranges::utf8_view{ lhs } };
@@ -885,6 +1255,31 @@ namespace another_toml
 		return false;
 	}
 
+	std::string to_nfc_string(std::string_view str)
+	{
+		if (!contains_unicode(str))
+			return std::string{ str };
+		return uni::norm::to_nfc_utf8(str);
+	}
+
+	std::optional<std::string_view> to_nfc_string(std::string_view str, span<char> buffer) noexcept
+	{
+		auto view = uni::ranges::norm::nfc_view{ uni::ranges::utf8_view{ str } };
+		auto size = std::size_t{};
+		for (auto it = view.begin(); it != uni::sentinel; ++it)
+		{
+			auto encoded = std::array<char, 4>{};
+			const auto count = encode_utf8(*it, data(encoded));
+			if (buffer.size() - size < count)
+				return {};
+
+			std::copy_n(begin(encoded), count, buffer.data() + size);
+			size += count;
+		}
+
+		return std::string_view{ buffer.data(), size };
+	}
+
 	bool contains_unicode(std::string_view s) noexcept
 	{
 		return std::any_of(begin(s), end(s), is_unicode_byte);
@@ -0,0 +1,150 @@
+// Checks that children(), get_child and operator[] return the same children, in the same order,
+// as walking them with get_first_child and get_next_sibling.
+// Covers containers that store their children contiguously, containers that look their
+// children up in child_offsets, and containers with too few children for that, which walk them.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "another_toml/another_toml.hpp"
+
+namespace toml = another_toml;
+
+// Returns the name or value of n followed by that of its first child and grandchild,
+// which is enough to tell apart the children of every container in the document below
+static std::string identity(const toml::node& n, const int depth = 2)
+{
+	auto out = n.as_string();
+	if (depth > 0 && n.has_children())
+		out += "(" + identity(n.get_first_child(), depth - 1) + ")";
+	return out;
+}
+
+template<typename Node>
+static bool check(std::string_view name, const Node& container, const std::size_t expected_size)
+{
+	auto expected = std::vector<std::string>{};
+	if (container.has_children())
+	{
+		for (auto child = container.get_first_child(); child.good(); child = child.get_next_sibling())
+		{
+			expected.push_back(identity(child));
+			if (!child.has_sibling())
+				break;
+		}
+	}
+
+	const auto children = container.children();
+	if (size(expected) != expected_size || container.size() != expected_size ||
+		children.size() != expected_size ||
+		static_cast<std::size_t>(children.end() - children.begin()) != expected_size)
+	{
+		std::cerr << name << ": expected " << expected_size << " children, found " << size(expected)
+			<< " siblings, size() " << container.size() << " and children().size() " << children.size() << '\n';
+		return false;
+	}
+
+	auto n = std::size_t{};
+	for (const auto child : children)
+	{
+		if (identity(child) != expected[n])
+		{
+			std::cerr << name << ": iterating children() gave " << identity(child)
+				<< " at " << n << ", expected " << expected[n] << '\n';
+			return false;
+		}
+		++n;
+	}
+
+	// random access from the end, so it doesn't follow the order children were visited in
+	for (auto i = expected_size; i-- > 0;)
+	{
+		const auto it = children.begin() + static_cast<std::ptrdiff_t>(i);
+		if (identity(children[i]) != expected[i] || identity(container.get_child(i)) != expected[i] ||
+			identity(container[i]) != expected[i] || identity(*it) != expected[i])
+		{
+			std::cerr << name << ": child " << i << " is " << identity(children[i])
+				<< ", expected " << expected[i] << '\n';
+			return false;
+		}
+	}
+
+	try
+	{
+		container.get_child(expected_size);
+		std::cerr << name << ": get_child(" << expected_size << ") didn't throw\n";
+		return false;
+	}
+	catch (const toml::node_not_found&)
+	{}
+
+	return true;
+}
+
+int main()
+{
+	constexpr auto large_count = 100'000;
+	// containers with at least this many children that aren't stored contiguously
+	// are indexed through child_offsets, smaller ones are walked
+	constexpr auto offsets_count = 16;
+	constexpr auto walked_count = 5;
+
+	auto doc = std::string{};
+	for (auto i = 0; i < offsets_count; ++i)
+		doc += "r" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+
+	doc += "inline = {";
+	for (auto i = 0; i < offsets_count; ++i)
+		doc += (i ? ", i" : " i") + std::to_string(i) + " = " + std::to_string(i);
+	doc += " }\n";
+
+	doc += "ints = [";
+	for (auto i = 0; i < large_count; ++i)
+		doc += std::to_string(i) + ",";
+	doc += "]\n";
+
+	doc += "inline_tables = [";
+	for (auto i = 0; i < offsets_count; ++i)
+		doc += "{ e" + std::to_string(i) + " = " + std::to_string(i) + " },";
+	doc += "]\n";
+
+	doc += "few_inline_tables = [";
+	for (auto i = 0; i < walked_count; ++i)
+		doc += "{ f" + std::to_string(i) + " = " + std::to_string(i) + " },";
+	doc += "]\n";
+
+	doc += "[small]\n";
+	for (auto i = 0; i < walked_count; ++i)
+		doc += "s" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+
+	doc += "[large]\n";
+	for (auto i = 0; i < large_count; ++i)
+		doc += "k" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+
+	for (auto i = 0; i < offsets_count; ++i)
+		doc += "[[arr]]\nid" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+
+	for (auto i = 0; i < walked_count; ++i)
+		doc += "[[few]]\nid" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+
+	const auto root = toml::parse(doc);
+
+	// the root table holds the r keys, 4 arrays and inline tables, and 4 tables and array tables
+	const auto root_size = static_cast<std::size_t>(offsets_count + 8);
+
+	auto failed = false;
+	failed |= !check("root table", root, root_size);
+	failed |= !check("inline table", root.find_child("inline"), offsets_count);
+	failed |= !check("integer array", root.find_child("ints"), large_count);
+	failed |= !check("array of inline tables", root.find_child("inline_tables"), offsets_count);
+	failed |= !check("small array of inline tables", root.find_child("few_inline_tables"), walked_count);
+	failed |= !check("small table", root.find_child("small"), walked_count);
+	failed |= !check("large table", root.find_child("large"), large_count);
+	failed |= !check("array of tables", root.find_child("arr"), offsets_count);
+	failed |= !check("small array of tables", root.find_child("few"), walked_count);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+// Checks that nodes parsed with parser_options::lazy_values can be read from
+// several threads at once, and that they read the same as eagerly converted values.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "another_toml/another_toml.hpp"
+
+namespace toml = another_toml;
+
+int main()
+{
+	constexpr auto key_count = 20'000;
+	auto doc = std::string{ "[t]\n" };
+	for (auto i = 0; i < key_count; ++i)
+		doc += "k" + std::to_string(i) + " = " + std::to_string(i) + ".0" + std::to_string(i % 7) + "e-3\n";
+
+	const auto eager = toml::parse(doc);
+	const auto expected = eager.find_child("t");
+
+	auto opts = toml::parser_options{};
+	opts.lazy_values = true;
+	const auto root = toml::parse(doc, opts);
+	const auto table = root.find_child("t");
+
+	constexpr auto thread_count = 8;
+	auto mismatches = std::vector<int>(thread_count);
+	auto threads = std::vector<std::thread>{};
+	for (auto t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&, t] {
+			// each thread starts at a different key, so some values are converted
+			// by one thread while another is waiting for them
+			for (auto n = 0; n < key_count; ++n)
+			{
+				const auto i = (n + t * key_count / thread_count) % key_count;
+				if (table[i].get_first_child().as_floating() != expected[i].get_first_child().as_floating())
+					++mismatches[t];
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	for (auto t = 0; t < thread_count; ++t)
+	{
+		if (mismatches[t] != 0)
+		{
+			std::cerr << "thread " << t << " read " << mismatches[t] << " wrong values\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
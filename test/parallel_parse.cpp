@@ -0,0 +1,160 @@
+// Checks that parsing a document on several threads gives the same tree as parsing it serially,
+// and that tables and keys redefined in a different segment of the document are still rejected.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "another_toml/another_toml.hpp"
+
+namespace toml = another_toml;
+
+// Documents are only split into segments of at least 1MB.
+// Each section below is padded to this size, so with threads = 4 a document
+// of three sections is split at the header that starts each section,
+// unless the header is dotted and passes through an array table.
+constexpr auto section_size = std::size_t{ 1'500'000 };
+constexpr auto thread_count = std::size_t{ 4 };
+
+// Returns header followed by prefix0 = 0, prefix1 = 1, ... up to section_size, then body.
+// The document may be split before headers in body, but not before headers in header.
+static std::string section(std::string_view header, std::string_view prefix, std::string_view body = {})
+{
+	auto out = std::string{ header } + '\n';
+	for (auto i = 0; size(out) < section_size; ++i)
+		out += std::string{ prefix } + std::to_string(i) + " = " + std::to_string(i) + '\n';
+	out += body;
+	return out;
+}
+
+// Returns an empty string if lhs and rhs are the same tree, or the path to the first difference
+template<typename Node, typename OtherNode>
+static std::string compare(const Node& lhs, const OtherNode& rhs, const std::string& path)
+{
+	if (lhs.table() != rhs.table() || lhs.array() != rhs.array() ||
+		lhs.array_table() != rhs.array_table() || lhs.key() != rhs.key() ||
+		lhs.value() != rhs.value() || lhs.inline_table() != rhs.inline_table())
+		return path + ": node types differ";
+
+	if (lhs.value() && lhs.type() != rhs.type())
+		return path + ": value types differ";
+
+	// the root table has no name
+	if (!empty(path) && lhs.as_string() != rhs.as_string())
+		return path + ": \"" + lhs.as_string() + "\" and \"" + rhs.as_string() + "\" differ";
+
+	if (lhs.size() != rhs.size())
+		return path + ": " + std::to_string(lhs.size()) + " and " + std::to_string(rhs.size()) + " children";
+
+	for (auto i = std::size_t{}; i < lhs.size(); ++i)
+	{
+		const auto child_path = path + '/' + lhs[i].as_string();
+		if (const auto diff = compare(lhs[i], rhs[i], child_path); !empty(diff))
+			return diff;
+	}
+
+	return {};
+}
+
+static bool parses_the_same(std::string_view name, const std::string& doc)
+{
+	auto opts = toml::parser_options{};
+	opts.threads = thread_count;
+	try
+	{
+		const auto serial = toml::parse(doc);
+		const auto parallel = toml::parse(doc, opts);
+		const auto diff = compare(serial, parallel, {});
+		if (!empty(diff))
+		{
+			std::cerr << name << ": parallel parse differs at " << diff << '\n';
+			return false;
+		}
+	}
+	catch (const toml::toml_error& e)
+	{
+		std::cerr << name << ": " << e.what() << '\n';
+		return false;
+	}
+
+	return true;
+}
+
+static bool fails_to_parse(std::string_view name, const std::string& doc)
+{
+	auto opts = toml::parser_options{};
+	opts.threads = thread_count;
+	try
+	{
+		toml::parse(doc, opts);
+	}
+	catch (const toml::toml_error&)
+	{
+		return true;
+	}
+
+	std::cerr << name << ": parallel parse accepted an invalid document\n";
+	return false;
+}
+
+int main()
+{
+	auto failed = false;
+
+	// [[arr]] spanning segments, with subtables of its elements
+	failed |= !parses_the_same("array tables", "root = 0\n" +
+		section("[[arr]]", "a", "[arr.sub]\nv = 0\n") +
+		section("[[arr]]", "b", "[[arr]]\nid = 2\n[arr.sub]\nv = 2\n") +
+		section("[[arr]]", "c", "[arr.sub.deep]\nv = 3\n"));
+
+	// [a.b] after [a] in another segment, implicit tables defined later
+	// in another segment, and implicit tables extended in several segments
+	failed |= !parses_the_same("tables", "root = 0\n" +
+		section("[a]", "a", "[x.y.z]\nv = 1\n") +
+		section("[c]", "c", "[a.b]\nv = 2\n[x.y.w]\nv = 3\n") +
+		section("[x]", "x", "[x.y]\nv = 4\n[a.b.c]\nv = 5\n"));
+
+	// documents split before dotted headers, with the tables they name defined in other segments
+	failed |= !parses_the_same("dotted headers", "root = 0\n" +
+		section("[section.0]", "a") + section("[section.1]", "b") + section("[section.2]", "c"));
+
+	failed |= !parses_the_same("implicit tables", "root = 0\n" +
+		section("[x.a]", "a", "[y]\nv = 0\n") + section("[x.b.c]", "b", "[x.b.d]\nv = 1\n") +
+		section("[x]", "x", "[y.z]\nv = 2\n"));
+
+	// dotted keys can extend a table that was only named by headers in the same segment
+	failed |= !parses_the_same("dotted keys in an implicit table", "root = 0\n" +
+		section("[u]", "a") + section("[x.y.z]\n[x]\ny.v = 1", "b") + section("[x.y.w]", "c"));
+
+	// [records.meta] refers to the last table of records, the document isn't split before it
+	failed |= !parses_the_same("dotted header in an array table", "root = 0\n" +
+		section("[[records]]", "a") + section("[records.meta]", "b") + section("[[records]]", "c"));
+
+	failed |= !fails_to_parse("duplicate table", "root = 0\n" +
+		section("[x]", "a") + section("[y]", "b") + section("[x]", "c"));
+
+	failed |= !fails_to_parse("key redefined as a table", "root = 0\n" +
+		section("[t]", "a", "k = 1\n") + section("[u]", "b", "[t.k]\nv = 1\n") + section("[v]", "c"));
+
+	failed |= !fails_to_parse("table redefined as an array table", "root = 0\n" +
+		section("[t]", "a") + section("[u]", "b") + section("[[t]]", "c"));
+
+	failed |= !fails_to_parse("array table redefined as a table", "root = 0\n" +
+		section("[[t]]", "a") + section("[u]", "b") + section("[t]", "c"));
+
+	failed |= !fails_to_parse("implicit table defined twice", "root = 0\n" +
+		section("[a]", "a", "[x.y]\nv = 1\n") + section("[x]", "b") + section("[x]", "c"));
+
+	failed |= !fails_to_parse("implicit table defined in two segments", "root = 0\n" +
+		section("[x]", "a") + section("[x.a]", "b", "[x]\n") + section("[u]", "c"));
+
+	failed |= !fails_to_parse("dotted key added to a defined table", "root = 0\n" +
+		section("[a.b]", "a") + section("[a.b.c]\n[a]\nb.z = 4", "b") + section("[u]", "c"));
+
+	failed |= !fails_to_parse("dotted key table redefined by a header", "root = 0\n" +
+		section("[t]", "a", "u.v = 1\n") + section("[t.u]", "b") + section("[v]", "c"));
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+// Checks that the parser's scratch memory is bounded by nesting depth,
+// rather than growing with the number of elements in the document.
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+
+#include "another_toml/another_toml.hpp"
+
+namespace
+{
+	// Counts the bytes held by every allocation made through operator new.
+	// The size is stored in front of each block so delete can subtract it.
+	constexpr auto header_size = alignof(std::max_align_t);
+
+	std::size_t live_bytes = {};
+	std::size_t peak_bytes = {};
+
+	void* counted_alloc(std::size_t n)
+	{
+		auto ptr = static_cast<char*>(std::malloc(n + header_size));
+		if (!ptr)
+			throw std::bad_alloc{};
+
+		*reinterpret_cast<std::size_t*>(ptr) = n;
+		live_bytes += n;
+		if (live_bytes > peak_bytes)
+			peak_bytes = live_bytes;
+		return ptr + header_size;
+	}
+
+	void counted_free(void* p) noexcept
+	{
+		if (!p)
+			return;
+
+		auto ptr = static_cast<char*>(p) - header_size;
+		live_bytes -= *reinterpret_cast<std::size_t*>(ptr);
+		std::free(ptr);
+		return;
+	}
+}
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::size_t) noexcept { counted_free(p); }
+
+namespace toml = another_toml;
+
+// The most scratch memory a parse may use, regardless of document size
+constexpr auto max_scratch_bytes = std::size_t{ 64 * 1024 };
+
+// Returns the peak memory used while parsing doc, minus the memory held by the finished document.
+// The parser is given the storage of an identical document first,
+// so the node buffers don't grow (and reallocate) during the measured parse.
+static std::size_t scratch_bytes(std::string_view doc)
+{
+	auto root = toml::root_node{};
+	{
+		auto p = toml::parser{};
+		p.recycle(toml::parse(doc));
+		peak_bytes = live_bytes;
+		root = p.parse(doc);
+	}
+
+	return peak_bytes - live_bytes;
+}
+
+static bool check(const char* name, std::string_view doc)
+{
+	const auto scratch = scratch_bytes(doc);
+	std::cout << name << ": " << scratch << " bytes of scratch memory\n";
+	if (scratch <= max_scratch_bytes)
+		return true;
+
+	std::cerr << name << ": scratch memory exceeds " << max_scratch_bytes << " bytes\n";
+	return false;
+}
+
+int main()
+{
+	constexpr auto element_count = 1'000'000;
+	auto flat_array = std::string{ "a = [\n" };
+	auto one_line_array = std::string{ "a = [" };
+	for (auto i = 0; i < element_count; ++i)
+	{
+		flat_array += std::to_string(i % 10);
+		flat_array += ",\n";
+		one_line_array += std::to_string(i % 10);
+		one_line_array += ',';
+	}
+	flat_array += "]\n";
+	one_line_array += "]\n";
+
+	constexpr auto key_count = 100'000;
+	auto table = std::string{ "[t]\n" };
+	auto dotted_table = std::string{ "[t]\n" };
+	for (auto i = 0; i < key_count; ++i)
+	{
+		const auto key = "k" + std::to_string(i) + " = 1\n";
+		table += key;
+		dotted_table += "d." + key;
+	}
+
+	auto good = check("flat array", flat_array);
+	good = check("flat array on one line", one_line_array) && good;
+	good = check("table keys", table) && good;
+	good = check("dotted keys", dotted_table) && good;
+	return good ? EXIT_SUCCESS : EXIT_FAILURE;
+}